@@ -4,7 +4,8 @@ message(STATUS "Setup CXX")
 # Architecture
 #
 
-set(CMAKE_CXX_STANDARD 17)
+set(CMAKE_CXX_STANDARD 20)
+set(CMAKE_CXX_STANDARD_REQUIRED ON)
 
 if(MSVC)
   #use 64bit toolchain
@@ -0,0 +1,393 @@
+#include "core/allocator_libc.h"
+#include "core/allocator_linear_pushpop.h"
+#include "core/allocator_ptr.h"
+#include "core/allocator_reuse.h"
+#include "core/allocator_stack.h"
+#include "core/allocator_traced.h"
+#include "core/container_flat_map.h"
+#include "core/container_small_vector.h"
+#include "core/coroutine_task.h"
+#include "core/memory_trace.h"
+#include "core/tests.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+
+// Sweep allocator configurations over one allocation trace -- either
+// recorded here from a workload in tests.h, or recorded elsewhere with
+// the traced allocator -- and report which are worth having: the Pareto
+// front of replay time against peak memory. The configurations are all
+// built with runtime sizes, so nothing needs to be recompiled to try
+// them; the recommended ones are then written out as a header of
+// aliases with the sizes fixed again
+
+
+namespace alloc = gaos::allocators;
+
+using traced_t = alloc::traced<alloc::libc<std::byte>>;
+
+
+// One configuration to try, and what it measured
+struct candidate
+{
+    std::string                    name;
+    std::string                    backing_type;
+    std::string                    type;
+    std::function<std::uint64_t()> replay_once;
+
+    std::uint64_t time_ns      = std::numeric_limits<std::uint64_t>::max();
+    std::size_t   peak_bytes   = 0;
+    std::size_t   malloc_count = 0;
+    bool          on_front     = false;
+};
+
+
+// Spell a size the way we would write it as a template argument
+auto size_text(std::size_t size) -> std::string
+{
+    if (size >= 256 && (size & (size - 1)) == 0) {
+        int shift = 0;
+        while ((std::size_t(1) << shift) != size)
+          ++shift;
+        return "1 << " + std::to_string(shift);
+    }
+    return std::to_string(size);
+}
+
+
+auto record_workload(char const *workload, gaos::memory::allocation_trace &trace) -> bool
+{
+    traced_t traced(&trace);
+
+    bool all = std::strcmp(workload, "all") == 0;
+    bool any = false;
+
+    if (all || std::strcmp(workload, "vector") == 0) {
+        alloc::ptr<int, traced_t> alloc_int(&traced);
+        gaos::tests::test_vector(alloc_int);
+        any = true;
+    }
+    if (all || std::strcmp(workload, "small_vector") == 0) {
+        alloc::ptr<std::byte, traced_t> alloc_byte(&traced);
+        gaos::tests::test_small_vector(alloc_byte);
+        any = true;
+    }
+    if (all || std::strcmp(workload, "map") == 0) {
+        alloc::ptr<std::pair<const int, int>, traced_t> alloc_pair_int_int(&traced);
+        gaos::tests::test_map(alloc_pair_int_int);
+        any = true;
+    }
+    if (all || std::strcmp(workload, "flat_map") == 0) {
+        alloc::ptr<std::byte, traced_t> alloc_byte(&traced);
+        gaos::tests::test_flat_map(alloc_byte);
+        any = true;
+    }
+
+    return any;
+}
+
+
+// The sizes most often asked for, as candidates for a reuse list
+auto frequent_sizes(gaos::memory::allocation_trace const &trace, std::size_t count) -> std::vector<std::size_t>
+{
+    std::map<std::size_t, std::size_t> histogram;
+    for (auto const &e : trace.events) {
+        if (e.op == gaos::memory::allocation_trace::operation::allocate && e.size >= sizeof(void*) && e.size <= 4096)
+          histogram[e.size] += 1;
+    }
+
+    std::vector<std::pair<std::size_t, std::size_t>> by_count(histogram.begin(), histogram.end());
+    std::sort(by_count.begin(), by_count.end(), [](auto const &lh, auto const &rh) { return lh.second > rh.second; });
+
+    std::vector<std::size_t> sizes;
+    for (std::size_t i = 0; i < by_count.size() && i < count; ++i)
+      sizes.push_back(by_count[i].first);
+    return sizes;
+}
+
+
+auto make_candidates(gaos::memory::allocation_trace const &trace) -> std::vector<candidate>
+{
+    using libc = alloc::libc<std::byte>;
+
+    std::string const libc_type = "gaos::allocators::libc<std::byte>";
+
+    std::vector<candidate> candidates;
+
+    candidates.push_back({ "libc", "", libc_type, [&trace] {
+        libc allocator;
+        return (std::uint64_t)gaos::memory::replay(trace, allocator).count();
+    }});
+
+    for (std::size_t shift = 10; shift <= 20; shift += 2) {
+        std::size_t blob_size = std::size_t(1) << shift;
+        candidates.push_back({
+          "linear_pushpop " + size_text(blob_size), "",
+          "gaos::allocators::linear_pushpop<" + size_text(blob_size) + ", " + libc_type + ">",
+          [&trace, blob_size] {
+              alloc::linear_pushpop<alloc::runtime_size, libc> allocator(blob_size);
+              return (std::uint64_t)gaos::memory::replay(trace, allocator).count();
+          }
+        });
+    }
+
+    for (std::size_t shift = 8; shift <= 16; shift += 2) {
+        std::size_t stack_size = std::size_t(1) << shift;
+        candidates.push_back({
+          "stack " + size_text(stack_size), "",
+          "gaos::allocators::stack<" + size_text(stack_size) + ", " + libc_type + ">",
+          [&trace, stack_size] {
+              alloc::stack<alloc::runtime_size, libc> allocator(stack_size);
+              return (std::uint64_t)gaos::memory::replay(trace, allocator).count();
+          }
+        });
+    }
+
+    for (std::size_t reuse_size : frequent_sizes(trace, 4)) {
+        candidates.push_back({
+          "reuse " + size_text(reuse_size), "",
+          "gaos::allocators::reuse<" + size_text(reuse_size) + ", " + libc_type + ">",
+          [&trace, reuse_size] {
+              alloc::reuse<alloc::runtime_size, libc> allocator(reuse_size);
+              return (std::uint64_t)gaos::memory::replay(trace, allocator).count();
+          }
+        });
+
+        for (std::size_t shift = 12; shift <= 16; shift += 2) {
+            std::size_t blob_size = std::size_t(1) << shift;
+
+            using backing_t = alloc::linear_pushpop<alloc::runtime_size, libc>;
+            using reuse_t   = alloc::reuse<alloc::runtime_size, alloc::ptr<std::byte, backing_t>>;
+
+            candidates.push_back({
+              "reuse " + size_text(reuse_size) + " on linear_pushpop " + size_text(blob_size),
+              "gaos::allocators::linear_pushpop<" + size_text(blob_size) + ", " + libc_type + ">",
+              "gaos::allocators::reuse<" + size_text(reuse_size) + ", gaos::allocators::ptr<std::byte, %backing%>>",
+              [&trace, reuse_size, blob_size] {
+                  backing_t backing(blob_size);
+                  reuse_t   allocator(reuse_size, alloc::ptr<std::byte, backing_t>(&backing));
+                  return (std::uint64_t)gaos::memory::replay(trace, allocator).count();
+              }
+            });
+        }
+    }
+
+    return candidates;
+}
+
+
+// Keep the best time over all runs; the peak is the same every run
+void measure(candidate &c, int repeat_count)
+{
+    for (int i = 0; i < repeat_count; ++i) {
+        gaos::memory::reset_meta_stats();
+
+        c.time_ns      = std::min(c.time_ns, c.replay_once());
+        c.peak_bytes   = std::max(c.peak_bytes, gaos::memory::size_malloc_peak.load());
+        c.malloc_count = gaos::memory::count_malloc;
+    }
+}
+
+
+// A candidate is on the front when nothing is both at least as fast
+// and uses at most as much memory (and is better in one of the two)
+void mark_front(std::vector<candidate> &candidates)
+{
+    std::sort(candidates.begin(), candidates.end(), [](candidate const &lh, candidate const &rh) {
+        return lh.time_ns != rh.time_ns ? lh.time_ns < rh.time_ns : lh.peak_bytes < rh.peak_bytes;
+    });
+
+    std::size_t lowest_peak = std::numeric_limits<std::size_t>::max();
+    for (candidate &c : candidates) {
+        c.on_front = c.peak_bytes < lowest_peak;
+        if (c.on_front)
+          lowest_peak = c.peak_bytes;
+    }
+}
+
+
+// On the front, the candidate with the lowest product of time and peak,
+// both relative to the best on the front -- the knee of the curve
+auto pick_recommended(std::vector<candidate> const &candidates) -> candidate const &
+{
+    std::uint64_t best_time = std::numeric_limits<std::uint64_t>::max();
+    std::size_t   best_peak = std::numeric_limits<std::size_t>::max();
+    for (candidate const &c : candidates) {
+        if (c.on_front) {
+            best_time = std::min(best_time, c.time_ns);
+            best_peak = std::min(best_peak, c.peak_bytes);
+        }
+    }
+
+    candidate const *recommended = nullptr;
+    double           best_score  = std::numeric_limits<double>::max();
+    for (candidate const &c : candidates) {
+        double score = ((double)c.time_ns / (double)std::max<std::uint64_t>(best_time, 1))
+                     * ((double)c.peak_bytes / (double)std::max<std::size_t>(best_peak, 1));
+        if (c.on_front && score < best_score) {
+            best_score  = score;
+            recommended = &c;
+        }
+    }
+    return *recommended;
+}
+
+
+void write_alias(std::ofstream &out, char const *alias, candidate const &c)
+{
+    out << "    // " << c.name << ": " << (c.time_ns / 1000) << "us, peak " << c.peak_bytes << "B" << std::endl;
+
+    if (c.backing_type.empty()) {
+        out << "    using " << alias << " = " << c.type << ";" << std::endl << std::endl;
+        return;
+    }
+
+    // Layered candidates reference an instance of their backing allocator
+    std::string backing = std::string(alias) + "_backing";
+    std::string type    = c.type;
+    type.replace(type.find("%backing%"), 9, backing);
+
+    out << "    using " << backing << " = " << c.backing_type << ";" << std::endl;
+    out << "    using " << alias << " = " << type << ";" << std::endl << std::endl;
+}
+
+
+auto write_header(char const *path, char const *source, std::vector<candidate> const &candidates) -> bool
+{
+    std::ofstream out(path);
+    if (!out)
+      return false;
+
+    candidate const *fastest  = &candidates.front();
+    candidate const *smallest = &candidates.front();
+    for (candidate const &c : candidates) {
+        if (c.on_front && c.peak_bytes < smallest->peak_bytes)
+          smallest = &c;
+    }
+
+    out << "#pragma once" << std::endl
+        << std::endl
+        << "// Generated by autotune from " << source << std::endl
+        << "// Pareto front of replay time against peak memory:" << std::endl;
+    for (candidate const &c : candidates) {
+        if (c.on_front)
+          out << "//   " << std::left << std::setw(40) << c.name << std::right << std::setw(8) << (c.time_ns / 1000) << "us " << std::setw(10) << c.peak_bytes << "B" << std::endl;
+    }
+    out << std::endl
+        << "#include \"core/allocator_libc.h\"" << std::endl
+        << "#include \"core/allocator_linear_pushpop.h\"" << std::endl
+        << "#include \"core/allocator_ptr.h\"" << std::endl
+        << "#include \"core/allocator_reuse.h\"" << std::endl
+        << "#include \"core/allocator_stack.h\"" << std::endl
+        << std::endl
+        << std::endl
+        << "namespace gaos::tuned {" << std::endl
+        << std::endl;
+
+    write_alias(out, "fastest", *fastest);
+    write_alias(out, "smallest", *smallest);
+    write_alias(out, "recommended", pick_recommended(candidates));
+
+    out << "}";
+    return (bool)out;
+}
+
+
+void print_usage()
+{
+    std::cout
+      << "autotune [--workload vector|small_vector|map|flat_map|all] [--trace file]" << std::endl
+      << "         [--record file] [--repeat count] [--header file]" << std::endl;
+}
+
+
+int main(int argc, char **argv)
+{
+    gaos::memory::enable_logging = false;
+
+    char const *workload    = "all";
+    char const *trace_path  = nullptr;
+    char const *record_path = nullptr;
+    char const *header_path = "tuned_allocators.h";
+    int         repeat      = 20;
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (has_value && std::strcmp(argv[i], "--workload") == 0)
+          workload = argv[++i];
+        else if (has_value && std::strcmp(argv[i], "--trace") == 0)
+          trace_path = argv[++i];
+        else if (has_value && std::strcmp(argv[i], "--record") == 0)
+          record_path = argv[++i];
+        else if (has_value && std::strcmp(argv[i], "--repeat") == 0)
+          repeat = std::max(1, std::atoi(argv[++i]));
+        else if (has_value && std::strcmp(argv[i], "--header") == 0)
+          header_path = argv[++i];
+        else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    gaos::memory::allocation_trace trace;
+    std::string                    source;
+
+    if (trace_path != nullptr) {
+        if (!trace.read(trace_path)) {
+            std::cerr << "could not read trace " << trace_path << std::endl;
+            return 1;
+        }
+        source = std::string("trace ") + trace_path;
+    }
+    else {
+        if (!record_workload(workload, trace)) {
+            print_usage();
+            return 1;
+        }
+        source = std::string("workload ") + workload;
+    }
+
+    if (record_path != nullptr && !trace.write(record_path)) {
+        std::cerr << "could not write trace " << record_path << std::endl;
+        return 1;
+    }
+
+    std::cout
+      << "replaying " << source << " (" << trace.events.size() << " events) "
+      << repeat << " times per configuration..." << std::endl << std::endl;
+
+    std::vector<candidate> candidates = make_candidates(trace);
+    for (candidate &c : candidates)
+      measure(c, repeat);
+    mark_front(candidates);
+
+    for (candidate const &c : candidates) {
+        std::cout
+          << (c.on_front ? "* " : "  ")
+          << std::left << std::setw(40) << c.name << std::right
+          << " | " << std::setw(8) << (c.time_ns / 1000) << "us"
+          << " | peak " << std::setw(10) << c.peak_bytes << "B"
+          << " | malloc " << std::setw(6) << c.malloc_count << "x"
+          << std::endl;
+    }
+
+    if (!write_header(header_path, source.c_str(), candidates)) {
+        std::cerr << "could not write " << header_path << std::endl;
+        return 1;
+    }
+
+    std::cout
+      << std::endl
+      << "* on the Pareto front; aliases written to " << header_path << std::endl;
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "core/allocator_traits.h"
+#include "core/memory_budget.h"
+#include "core/memory_zeroed.h"
+
+#include <algorithm>
+
+
+namespace gaos::allocators {
+
+
+    // Charge everything taken from the internal allocator to a budget,
+    // failing (returning nullptr) when the budget, or one above it, would
+    // go past its hard limit; put it under an arena to limit the arena
+    // To keep the shared atomics out of the way, bytes are charged in
+    // batches of batch_size and handed out from that credit, and only
+    // released once more than two batches have come back: so like any
+    // allocator here use one per thread (or wrap it in a locked), and
+    // expect a budget to be up to two batches high for each of them
+    // Note that this expects to get an allocator which allocates bytes
+    template<typename allocator_t = std::allocator<std::byte>>
+    class budgeted
+    {
+      public:
+      // -- Members
+
+        allocator_t           internal_allocator;
+        gaos::memory::budget *account;
+        std::size_t           batch_size;
+        std::size_t           credit = 0;
+
+      // -- Construction
+
+        budgeted(gaos::memory::budget *account, std::size_t batch_size = 64 << 10, allocator_t allocator = {}) noexcept
+        : internal_allocator(allocator), account(account), batch_size(batch_size) {}
+
+        budgeted(budgeted const&) = delete;
+        auto operator=(budgeted const&) -> budgeted& = delete;
+
+        ~budgeted() noexcept {
+            flush();
+        }
+
+      // -- Allocation
+
+        auto allocate(std::size_t alloc_size) noexcept -> std::byte * {
+            if (!take(alloc_size))
+              return nullptr;
+
+            std::byte *ptr = (std::byte*)internal_allocator.allocate(alloc_size);
+            if (ptr == nullptr)
+              give(alloc_size);
+            return ptr;
+        }
+
+
+        auto allocate_zeroed(std::size_t alloc_size) noexcept -> std::byte * {
+            if (!take(alloc_size))
+              return nullptr;
+
+            std::byte *ptr = gaos::allocators::allocate_zeroed(internal_allocator, alloc_size);
+            if (ptr == nullptr)
+              give(alloc_size);
+            return ptr;
+        }
+
+
+        void deallocate(void * ptr, std::size_t alloc_size) noexcept {
+            internal_allocator.deallocate((std::byte*)ptr, alloc_size);
+            give(alloc_size);
+        }
+
+
+        // Hand the unused credit back to the budget, and pass the trim on
+        // when the internal allocator caches memory itself
+        auto trim(std::size_t target_bytes) noexcept -> std::size_t {
+            flush();
+            if constexpr (has_trim_v<allocator_t>)
+              return internal_allocator.trim(target_bytes);
+            else
+              return 0;
+        }
+
+
+        // Release all credit we hold, so the budget is exact again
+        void flush() noexcept {
+            account->release(credit);
+            credit = 0;
+        }
+
+
+        // Some allocators in this project can be scoped;
+        // We pass this scoped pushpop request through too
+        auto get_scoped_pushpop() noexcept {
+            return internal_allocator.get_scoped_pushpop();
+        }
+
+      protected:
+        // Take from our credit, charging another batch when it runs out;
+        // close to a hard limit a whole batch may not fit when the
+        // allocation itself does, so then we charge just what is missing
+        auto take(std::size_t alloc_size) noexcept -> bool {
+            if (credit < alloc_size) {
+                std::size_t missing = alloc_size - credit;
+                std::size_t batch   = std::max(missing, batch_size);
+
+                if (account->charge(batch))
+                  credit += batch;
+                else if (batch != missing && account->charge(missing))
+                  credit += missing;
+                else
+                  return false;
+            }
+
+            credit -= alloc_size;
+            return true;
+        }
+
+
+        void give(std::size_t alloc_size) noexcept {
+            credit += alloc_size;
+            if (credit > 2 * batch_size) {
+                account->release(credit - batch_size);
+                credit = batch_size;
+            }
+        }
+    };
+
+}
\ No newline at end of file
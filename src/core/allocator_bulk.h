@@ -0,0 +1,156 @@
+#pragma once
+
+#include "core/memory_batch.h"
+
+#include <cstddef>
+
+
+namespace gaos::allocators {
+
+
+    // A stock of nodes of one size, taken from an allocator batch_count
+    // at a time with allocate_batch, and handed back to it batch_count at
+    // a time with deallocate_batch -- for node containers (lists, maps)
+    // being loaded or torn down in bulk, which otherwise go to the
+    // allocator once for every node
+    // The node size is the size of the first single allocation; anything
+    // else is passed through. Blocks given back are only held until there
+    // are batch_count of them, and flush gives them back right away
+    // Note this expects an allocator which allocates bytes
+    template<typename internal_allocator_t, std::size_t batch_count = 256>
+    class bulk_stock
+    {
+      public:
+      // -- Members
+
+        internal_allocator_t *internal_allocator;
+        std::size_t           node_size      = 0;
+        void                 *taken[batch_count];
+        std::size_t           taken_next     = 0;
+        std::size_t           taken_count    = 0;
+        void                 *returned[batch_count];
+        std::size_t           returned_count = 0;
+
+      // -- Construction
+
+        bulk_stock(internal_allocator_t *allocator) noexcept
+        : internal_allocator(allocator) {}
+
+        bulk_stock(bulk_stock const&) = delete;
+        auto operator=(bulk_stock const&) -> bulk_stock& = delete;
+
+        ~bulk_stock() noexcept {
+            flush();
+            if (taken_next < taken_count)
+              gaos::allocators::deallocate_batch(*internal_allocator, taken + taken_next, taken_count - taken_next, node_size);
+        }
+
+      // -- Allocation
+
+        auto allocate(std::size_t alloc_size) noexcept -> void * {
+            if (node_size == 0)
+              node_size = alloc_size;
+            if (alloc_size != node_size)
+              return (void*)internal_allocator->allocate(alloc_size);
+
+            // Hand out what we gave back before what we have not used yet
+            if (returned_count != 0)
+              return returned[--returned_count];
+
+            if (taken_next == taken_count) {
+                taken_next  = 0;
+                taken_count = gaos::allocators::allocate_batch(*internal_allocator, node_size, batch_count, taken);
+                if (taken_count == 0)
+                  return nullptr;
+            }
+            return taken[taken_next++];
+        }
+
+
+        void deallocate(void *ptr, std::size_t alloc_size) noexcept {
+            if (alloc_size != node_size) {
+                internal_allocator->deallocate((decltype(internal_allocator->allocate(alloc_size)))ptr, alloc_size);
+                return;
+            }
+
+            if (returned_count == batch_count)
+              flush();
+            returned[returned_count++] = ptr;
+        }
+
+
+        // Give every block given back to us back to the internal allocator
+        void flush() noexcept {
+            gaos::allocators::deallocate_batch(*internal_allocator, returned, returned_count, node_size);
+            returned_count = 0;
+        }
+
+
+        auto get_scoped_pushpop() noexcept {
+            return internal_allocator->get_scoped_pushpop();
+        }
+    };
+
+
+    // Use a bulk_stock referenced by pointer, as ptr does an allocator:
+    // single elements (nodes) come from the stock, arrays (like the
+    // buckets of an unordered_map) straight from the allocator under it
+    template <class T, class stock_t>
+    class bulk
+    {
+    public:
+      // -- Types
+
+        using value_type = T;
+        static constexpr std::size_t value_size = sizeof(value_type);
+
+      // -- Members
+
+        stock_t *stock;
+
+      // -- Construction
+
+        bulk(stock_t *stock) noexcept
+        : stock(stock) {}
+
+        template <class U> bulk(bulk<U, stock_t> const &rh) noexcept
+        : stock(rh.stock) {}
+
+      // -- Allocation
+
+        auto allocate(std::size_t count) noexcept -> value_type * {
+            if (count == 1)
+              return (value_type*)stock->allocate(value_size);
+            return (value_type*)stock->internal_allocator->allocate(count * value_size);
+        }
+
+
+        void deallocate(value_type * p, std::size_t count) noexcept {
+            if (count == 1)
+              stock->deallocate(p, value_size);
+            else
+              stock->internal_allocator->deallocate((decltype(stock->internal_allocator->allocate(0)))p, count * value_size);
+        }
+
+
+        // Some allocators in this project can be scoped;
+        // We pass this scoped pushpop request through too
+        auto get_scoped_pushpop() noexcept {
+            return stock->get_scoped_pushpop();
+        }
+    };
+
+  // -- Operators
+
+    template <class T, class U, class stock_t>
+    bool operator==(bulk<T, stock_t> const& lh, bulk<U, stock_t> const& rh) noexcept {
+        return lh.stock == rh.stock;
+    }
+
+
+    template <class T, class U, class stock_t>
+    bool operator!=(bulk<T, stock_t> const& lh, bulk<U, stock_t> const& rh) noexcept {
+        return !(lh == rh);
+    }
+
+}
\ No newline at end of file
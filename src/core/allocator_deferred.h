@@ -0,0 +1,104 @@
+#pragma once
+
+#include "core/memory_reclaimer.h"
+#include "core/memory_zeroed.h"
+
+#include <cstddef>
+#include <new>
+
+
+namespace gaos::allocators {
+
+
+    // Hand deallocations to a reclaimer instead of doing them: they are
+    // collected in batches of batch_size, and each full batch is freed
+    // into the internal allocator on the reclaimer thread, so destroying
+    // a large container only costs the walk over its nodes
+    // The internal allocator is then used from two threads at once, so
+    // it has to be thread-safe itself (libc with logging off, or anything
+    // under a locked); like any allocator here, use one of these per thread
+    // Note that this expects to get an allocator which allocates bytes
+    template<typename allocator_t = std::allocator<std::byte>, std::size_t batch_size = 256>
+    class deferred
+    {
+      public:
+      // -- Types
+
+        struct batch {
+            std::size_t  count;
+            void        *ptrs[batch_size];
+            std::size_t  sizes[batch_size];
+        };
+
+      // -- Members
+
+        allocator_t                internal_allocator;
+        gaos::memory::reclaimer   *later;
+        batch                     *filling = nullptr;
+
+      // -- Construction
+
+        deferred(gaos::memory::reclaimer *later, allocator_t allocator = {}) noexcept
+        : internal_allocator(allocator), later(later) {}
+
+        deferred(deferred const&) = delete;
+        auto operator=(deferred const&) -> deferred& = delete;
+
+        // Batches we sent still free into our internal allocator
+        ~deferred() noexcept {
+            flush();
+            later->drain();
+        }
+
+      // -- Allocation
+
+        auto allocate(std::size_t alloc_size) noexcept -> std::byte * {
+            return (std::byte*)internal_allocator.allocate(alloc_size);
+        }
+
+
+        auto allocate_zeroed(std::size_t alloc_size) noexcept -> std::byte * {
+            return gaos::allocators::allocate_zeroed(internal_allocator, alloc_size);
+        }
+
+
+        // When no batch can be allocated we just free right away
+        void deallocate(void * ptr, std::size_t alloc_size) noexcept {
+            if (filling == nullptr) {
+                filling = new (std::nothrow) batch;
+                if (filling == nullptr) {
+                    internal_allocator.deallocate((std::byte*)ptr, alloc_size);
+                    return;
+                }
+                filling->count = 0;
+            }
+
+            filling->ptrs[filling->count]  = ptr;
+            filling->sizes[filling->count] = alloc_size;
+            if (++filling->count == batch_size)
+              flush();
+        }
+
+
+        // Send the batch we are filling to the reclaimer, full or not
+        void flush() noexcept {
+            if (filling == nullptr)
+              return;
+
+            later->defer([this, sent = filling]() {
+                for (std::size_t i = 0; i < sent->count; ++i)
+                  internal_allocator.deallocate((std::byte*)sent->ptrs[i], sent->sizes[i]);
+                delete sent;
+            });
+            filling = nullptr;
+        }
+
+
+        // Some allocators in this project can be scoped;
+        // We pass this scoped pushpop request through too
+        auto get_scoped_pushpop() noexcept {
+            return internal_allocator.get_scoped_pushpop();
+        }
+    };
+
+}
\ No newline at end of file
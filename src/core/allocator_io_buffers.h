@@ -0,0 +1,191 @@
+#pragma once
+
+#include "core/memory_logging.h"
+#include "core/memory_resident.h"
+
+#include <cstddef>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/mman.h>
+  #include <unistd.h>
+#elif defined(_WIN32)
+  #include <malloc.h>
+#else
+  #include <cstdlib>
+#endif
+
+
+namespace gaos::allocators {
+
+
+    // Buffers for I/O: every buffer is its own mapping, so it starts on a
+    // page boundary, which is aligned enough for O_DIRECT on any device,
+    // and its size is rounded up to a power of two number of pages, so
+    // whole sectors always fit
+    // Buffers which come back are kept in a list per size, up to
+    // max_pooled_bytes, so a loader reading chunk after chunk does not
+    // map and unmap every time; with residency::lock they are also
+    // locked in memory, so a read never waits on a page being swapped in
+    // Sizes past the largest class are mapped and unmapped every time
+    template<std::size_t class_count = 12>
+    class io_buffers
+    {
+      public:
+      // -- Types
+
+        struct free_buffer {
+            free_buffer *next;
+        };
+
+      // -- Members
+
+        free_buffer             *pools[class_count] = {};
+        std::size_t              pooled_bytes       = 0;
+        std::size_t              max_pooled_bytes;
+        gaos::memory::residency  residency;
+        std::size_t              hit_count          = 0;
+        std::size_t              miss_count         = 0;
+
+      // -- Construction
+
+        io_buffers(std::size_t max_pooled_bytes = std::size_t(64) << 20, gaos::memory::residency residency = gaos::memory::residency::lazy) noexcept
+        : max_pooled_bytes(max_pooled_bytes), residency(residency) {}
+
+        io_buffers(io_buffers const&) = delete;
+        auto operator=(io_buffers const&) -> io_buffers& = delete;
+
+        ~io_buffers() noexcept {
+            trim(pooled_bytes);
+        }
+
+
+        static auto page_size() noexcept -> std::size_t {
+          #if defined(__unix__) || defined(__APPLE__)
+            static const std::size_t size = (std::size_t)sysconf(_SC_PAGESIZE);
+            return size;
+          #else
+            return 4096;
+          #endif
+        }
+
+
+        // The size a buffer of alloc_size bytes really has; all of it can
+        // be read into
+        static auto buffer_size(std::size_t alloc_size) noexcept -> std::size_t {
+            std::size_t size_class = class_of(alloc_size);
+            return size_class < class_count ? class_size(size_class) : (alloc_size + page_size() - 1) / page_size() * page_size();
+        }
+
+      // -- Allocation
+
+        auto allocate(std::size_t alloc_size) noexcept -> std::byte * {
+            std::size_t size_class = class_of(alloc_size);
+            if (size_class < class_count && pools[size_class] != nullptr) {
+                free_buffer *taken = pools[size_class];
+                pools[size_class]  = taken->next;
+                pooled_bytes      -= class_size(size_class);
+                hit_count         += 1;
+                return (std::byte*)taken;
+            }
+
+            miss_count += 1;
+            return map(buffer_size(alloc_size));
+        }
+
+
+        void deallocate(void *ptr, std::size_t alloc_size) noexcept {
+            std::size_t size_class = class_of(alloc_size);
+            if (size_class >= class_count || pooled_bytes + class_size(size_class) > max_pooled_bytes) {
+                unmap(ptr, buffer_size(alloc_size));
+                return;
+            }
+
+            free_buffer *returned = (free_buffer*)ptr;
+            returned->next        = pools[size_class];
+            pools[size_class]     = returned;
+            pooled_bytes         += class_size(size_class);
+        }
+
+
+        // Unmap pooled buffers, the largest first, until at least
+        // target_bytes are gone; returns how many bytes were unmapped
+        auto trim(std::size_t target_bytes) noexcept -> std::size_t {
+            std::size_t released = 0;
+            for (std::size_t size_class = class_count; size_class-- > 0 && released < target_bytes;) {
+                while (pools[size_class] != nullptr && released < target_bytes) {
+                    free_buffer *taken = pools[size_class];
+                    pools[size_class]  = taken->next;
+                    pooled_bytes      -= class_size(size_class);
+                    released          += class_size(size_class);
+                    unmap(taken, class_size(size_class));
+                }
+            }
+            return released;
+        }
+
+
+        // Some allocators in this project can be scoped and
+        // will return something sensible; this allocator does
+        // not, and so just returns a dummy int
+        auto get_scoped_pushpop() noexcept -> int {
+            return 0;
+        }
+
+      protected:
+        static auto class_size(std::size_t size_class) noexcept -> std::size_t {
+            return page_size() << size_class;
+        }
+
+
+        // class_count when it is too large for any class
+        static auto class_of(std::size_t alloc_size) noexcept -> std::size_t {
+            std::size_t size_class = 0;
+            while (size_class < class_count && class_size(size_class) < alloc_size)
+              ++size_class;
+            return size_class;
+        }
+
+
+        auto map(std::size_t size) noexcept -> std::byte * {
+          #if defined(__unix__) || defined(__APPLE__)
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+          #if defined(MAP_POPULATE)
+            if (residency != gaos::memory::residency::lazy)
+              flags |= MAP_POPULATE;
+          #endif
+
+            void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (ptr == MAP_FAILED)
+              return nullptr;
+
+            if (residency == gaos::memory::residency::lock)
+              mlock(ptr, size);
+          #elif defined(_WIN32)
+            // MSVC has no std::aligned_alloc, as its free cannot take it
+            void *ptr = _aligned_malloc(size, page_size());
+            if (ptr == nullptr)
+              return nullptr;
+          #else
+            void *ptr = std::aligned_alloc(page_size(), size);
+            if (ptr == nullptr)
+              return nullptr;
+          #endif
+
+            gaos::memory::log_malloc(ptr, size);
+            return (std::byte*)ptr;
+        }
+
+
+        void unmap(void *ptr, std::size_t size) noexcept {
+            gaos::memory::log_free(ptr, size);
+          #if defined(__unix__) || defined(__APPLE__)
+            munmap(ptr, size);
+          #elif defined(_WIN32)
+            _aligned_free(ptr);
+          #else
+            std::free(ptr);
+          #endif
+        }
+    };
+
+}
\ No newline at end of file
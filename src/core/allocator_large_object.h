@@ -0,0 +1,166 @@
+#pragma once
+
+#include "core/allocator_traits.h"
+#include "core/memory_logging.h"
+#include "core/memory_resident.h"
+#include "core/memory_zeroed.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+
+namespace gaos::allocators {
+
+
+    // Serve allocations of at least large_threshold bytes directly
+    // from the OS as their own mapping, and everything smaller from
+    // the internal allocator -- large allocations can then grow with
+    // mremap, which moves pages around instead of copying bytes
+    // Backing another allocator by this one hands its large requests
+    // (like perfect-fit blobs) to the OS automatically
+    // On platforms without mmap, large allocations also go to the
+    // internal allocator, and reallocating them copies
+    // Note this expects an allocator which allocates bytes,
+    // and that this is not an allocator to be used directly
+    // with std containers, as it has no size type
+    template<std::size_t large_threshold, typename allocator_t = std::allocator<std::byte>>
+    class large_object
+    {
+      public:
+      // -- Members
+
+        allocator_t internal_allocator;
+
+        // Whether large allocations are faulted in (MAP_POPULATE) or
+        // locked in memory as soon as they are mapped
+        gaos::memory::residency residency;
+
+      // -- Construction
+
+        large_object(allocator_t allocator = {}, gaos::memory::residency residency = gaos::memory::residency::lazy) noexcept
+        : internal_allocator(allocator), residency(residency) {}
+
+      // -- Allocation
+
+        static bool is_large(std::size_t alloc_size) noexcept {
+            return alloc_size >= large_threshold;
+        }
+
+
+        auto allocate(std::size_t alloc_size) noexcept -> std::byte * {
+            if (!is_large(alloc_size))
+              return (std::byte*)internal_allocator.allocate(alloc_size);
+
+            return map_pages(alloc_size);
+        }
+
+
+        // Fresh mappings are zero, so large allocations are never
+        // cleared -- their pages are not even touched until used
+        auto allocate_zeroed(std::size_t alloc_size) noexcept -> std::byte * {
+            if (!is_large(alloc_size))
+              return gaos::allocators::allocate_zeroed(internal_allocator, alloc_size);
+
+          #if defined(__linux__)
+            return map_pages(alloc_size);
+          #else
+            return gaos::allocators::allocate_zeroed(internal_allocator, alloc_size);
+          #endif
+        }
+
+
+        void deallocate(void *ptr, std::size_t alloc_size) noexcept {
+            if (!is_large(alloc_size)) {
+                internal_allocator.deallocate((std::byte*)ptr, alloc_size);
+                return;
+            }
+
+            unmap_pages(ptr, alloc_size);
+        }
+
+
+        // Grow or shrink an allocation; when both the old and the new
+        // size are large, the mapping is remapped and no bytes are copied
+        auto reallocate(void *ptr, std::size_t old_size, std::size_t new_size) noexcept -> std::byte * {
+          #if defined(__linux__)
+            if (is_large(old_size) && is_large(new_size)) {
+                void *new_ptr = mremap(ptr, page_round(old_size), page_round(new_size), MREMAP_MAYMOVE);
+                if (new_ptr == MAP_FAILED)
+                  return nullptr;
+
+                gaos::memory::log_free(ptr, page_round(old_size));
+                gaos::memory::log_malloc(new_ptr, page_round(new_size));
+                return (std::byte*)new_ptr;
+            }
+          #endif
+
+            if constexpr (has_reallocate_v<allocator_t>) {
+                if (!is_large(old_size) && !is_large(new_size))
+                  return (std::byte*)internal_allocator.reallocate((std::byte*)ptr, old_size, new_size);
+            }
+
+            std::byte *new_ptr = allocate(new_size);
+            if (new_ptr != nullptr) {
+                std::memcpy(new_ptr, ptr, std::min(old_size, new_size));
+                deallocate(ptr, old_size);
+            }
+            return new_ptr;
+        }
+
+
+        // Some allocators in this project can be scoped and
+        // will return something sensible; this allocator does
+        // not, and so just returns a dummy int
+        auto get_scoped_pushpop() noexcept -> int {
+            return 0;
+        }
+
+      protected:
+        static auto page_round(std::size_t alloc_size) noexcept -> std::size_t {
+          #if defined(__linux__)
+            static const std::size_t page_size = (std::size_t)sysconf(_SC_PAGESIZE);
+            return (alloc_size + page_size - 1) / page_size * page_size;
+          #else
+            return alloc_size;
+          #endif
+        }
+
+
+        auto map_pages(std::size_t alloc_size) noexcept -> std::byte * {
+          #if defined(__linux__)
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+            if (residency != gaos::memory::residency::lazy)
+              flags |= MAP_POPULATE;
+
+            void *ptr = mmap(nullptr, page_round(alloc_size), PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (ptr == MAP_FAILED)
+              return nullptr;
+
+            if (residency == gaos::memory::residency::lock)
+              mlock(ptr, page_round(alloc_size));
+
+            gaos::memory::log_malloc(ptr, page_round(alloc_size));
+            return (std::byte*)ptr;
+          #else
+            return (std::byte*)internal_allocator.allocate(alloc_size);
+          #endif
+        }
+
+
+        void unmap_pages(void *ptr, std::size_t alloc_size) noexcept {
+          #if defined(__linux__)
+            gaos::memory::log_free(ptr, page_round(alloc_size));
+            munmap(ptr, page_round(alloc_size));
+          #else
+            internal_allocator.deallocate((std::byte*)ptr, alloc_size);
+          #endif
+        }
+    };
+
+}
\ No newline at end of file
@@ -1,3 +1,5 @@
+#pragma once
+
 #include "core/memory_logging.h"
 #include <iostream>
 
@@ -7,6 +9,8 @@ namespace gaos::allocators {
     // Use the libc style malloc/free to manage memory
     // Quite analogous to the default std allocator, except
     // that this explicitly uses the c runtime instead of new/delete
+    // It can be used from many threads at once, as malloc can, as long
+    // as logging (enable_logging) is off; the stats it keeps are atomic
     template <class T>
     class libc
     {
@@ -34,6 +38,18 @@ namespace gaos::allocators {
             return (value_type*)p;
         }
 
+
+        auto allocate_zeroed(std::size_t count) noexcept -> value_type * {
+            // calloc knows when its memory is fresh from the OS,
+            // in which case it does not need to clear it
+            std::size_t size = count * value_size;
+
+            void *p = calloc(count, value_size);
+            gaos::memory::log_malloc(p, size);
+
+            return (value_type*)p;
+        }
+
         void deallocate(value_type * p, std::size_t count) noexcept {
             // Free memory for (count  value_type)
             std::size_t size = count * value_size;
@@ -44,6 +60,25 @@ namespace gaos::allocators {
         }
 
 
+        // malloc has no way to hand out many blocks at once, so this is
+        // the loop anyone would write; each block is freed on its own
+        auto allocate_batch(std::size_t count_each, std::size_t count, void **out) noexcept -> std::size_t {
+            std::size_t done = 0;
+            for (; done < count; ++done) {
+                out[done] = allocate(count_each);
+                if (out[done] == nullptr)
+                  break;
+            }
+            return done;
+        }
+
+
+        void deallocate_batch(void *const *ptrs, std::size_t count, std::size_t count_each) noexcept {
+            for (std::size_t i = 0; i < count; ++i)
+              deallocate((value_type*)ptrs[i], count_each);
+        }
+
+
         // Some allocators in this project can be scoped and
         // will return something sensible; this allocator does
         // not, and so just returns a dummy int
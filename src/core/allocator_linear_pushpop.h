@@ -1,5 +1,16 @@
-#include "core/memory_logging.h"
+#pragma once
 
+#include "core/allocator_traits.h"
+#include "core/memory_heap_map.h"
+#include "core/memory_logging.h"
+#include "core/memory_page_map.h"
+#include "core/memory_resident.h"
+#include "core/memory_trim.h"
+#include "core/memory_zeroed.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <limits>
 
@@ -14,28 +25,48 @@ namespace gaos::allocators {
     // Note this expects an allocator which allocates bytes,
     // and that this is not an allocator to be used directly
     // with std containers, as it has no size type
-    template<std::size_t min_blob_size, typename allocator_t = std::allocator<std::byte>>
+    // With min_blob_size as runtime_size, the constructor takes it
+    // With page_mapped, every blob is added to the global page map, so
+    // anything in it can be deallocated without a size; this costs a
+    // small allocation and a lock for every blob, so it is opt-in
+    template<std::size_t min_blob_size, typename allocator_t = std::allocator<std::byte>, bool page_mapped = false>
     class linear_pushpop
     {
       public:
       // -- Types
 
-        using this_t = linear_pushpop<min_blob_size, allocator_t>;
+        using this_t = linear_pushpop<min_blob_size, allocator_t, page_mapped>;
+
+        // Memory only goes back when we pop or clear
+        static constexpr bool deallocate_is_noop = true;
 
         // Information as a header in the blob, effectively
         // making the blobs a doubly linked list
+        // The dirty size is how far into the blob memory may have been
+        // handed out before; everything past it is known to be zero
+        // if the blob came zeroed from the internal allocator
+        // The used size is how far into the blob we got when we last
+        // left it for the next one, which a snapshot reports for it
+        // The pages are the blob's range in the global page map, if we
+        // are page mapped
         struct blob_meta {
-            std::uint32_t size;
-            blob_meta*    next;
-            blob_meta*    previous;
+            std::size_t                    size;
+            std::size_t                    dirty_size;
+            std::size_t                    used_size;
+            blob_meta*                     next;
+            blob_meta*                     previous;
+            gaos::memory::page_map::range *pages;
         };
-        static constexpr std::uint32_t blob_meta_size = sizeof(blob_meta);
+        static constexpr std::size_t blob_meta_size = sizeof(blob_meta);
 
         // Stack data referencing a specific blob and the offset
-        // in it to the next free allocation
+        // in it to the next free allocation; the dead size is how much of
+        // what was handed out has been deallocated since, which a pop
+        // takes back along with the rest
         struct stack_data {
-            blob_meta*    blob;
-            std::uint32_t offset;
+            blob_meta*  blob;
+            std::size_t offset;
+            std::size_t dead_size = 0;
         };
 
       // -- Members
@@ -43,21 +74,33 @@ namespace gaos::allocators {
         stack_data  current_stack_data;
         allocator_t internal_allocator;
 
+        [[no_unique_address]] size_parameter<min_blob_size> min_blob;
+
       // -- Construction
 
-        linear_pushpop(allocator_t allocator = {}) noexcept
+        linear_pushpop(allocator_t allocator = {}) noexcept requires (min_blob_size != runtime_size)
         : internal_allocator(allocator) {
             // Upon construction, immediately grab a blob
-            current_stack_data.blob   = alloc_buffer(nullptr, min_blob_size);
+            current_stack_data.blob   = alloc_buffer(nullptr, min_blob.get());
             current_stack_data.offset = blob_meta_size;
         }
 
+        linear_pushpop(std::size_t blob_size, allocator_t allocator = {}) noexcept requires (min_blob_size == runtime_size)
+        : internal_allocator(allocator), min_blob{ blob_size } {
+            current_stack_data.blob   = alloc_buffer(nullptr, min_blob.get());
+            current_stack_data.offset = blob_meta_size;
+        }
+
+        // The page map knows us by address, so we stay where we are
+        linear_pushpop(linear_pushpop const&) = delete;
+        auto operator=(linear_pushpop const&) -> linear_pushpop& = delete;
+
 
         ~linear_pushpop() noexcept {
             clear();
             
             // Deallocate the initial blob
-            internal_allocator.deallocate((std::byte*)current_stack_data.blob, current_stack_data.blob->size);
+            free_buffer(current_stack_data.blob);
         }
 
       // -- Allocation
@@ -67,12 +110,14 @@ namespace gaos::allocators {
         void clear() noexcept {
             blob_meta *remove_next;
 
+            note_dirty();
+
             // For every blob following the stack's current blob, remove it
             for (remove_next = current_stack_data.blob->next; remove_next != nullptr;) {
                 blob_meta *remove_current = remove_next;
                 remove_next = remove_current->next;
 
-                internal_allocator.deallocate((std::byte*)remove_current, remove_current->size);
+                free_buffer(remove_current);
             }
 
             // For every blob before and including the stack's current blob, remove it
@@ -80,33 +125,226 @@ namespace gaos::allocators {
                 blob_meta *remove_current = remove_next;
                 remove_next = remove_current->previous;
 
-                internal_allocator.deallocate((std::byte*)remove_current, remove_current->size);
+                free_buffer(remove_current);
             }
 
             // Set our stack to the first blob with an empty blob offset
             current_stack_data.blob       = remove_next;
             current_stack_data.blob->next = nullptr;
             current_stack_data.offset     = blob_meta_size;
+            current_stack_data.dead_size  = 0;
+        }
+
+
+        // Make sure at least reserve_bytes can be allocated without going
+        // to the internal allocator, adding a blob after the others when
+        // needed; mode decides whether all the free memory we then have
+        // is faulted in (or locked) right away. Returns false only when
+        // locking, or getting the blob, failed
+        // Note reserved memory is only used in order, so an allocation too
+        // large for the free space it reaches will still get its own blob
+        bool reserve(std::size_t reserve_bytes, gaos::memory::residency mode = gaos::memory::residency::lazy) {
+            blob_meta  *last      = current_stack_data.blob;
+            std::size_t available = last->size - current_stack_data.offset;
+            while (last->next != nullptr) {
+                last       = last->next;
+                available += last->size - blob_meta_size;
+            }
+
+            if (available < reserve_bytes && alloc_buffer(last, std::max(min_blob.get(), reserve_bytes - available + blob_meta_size)) == nullptr)
+              return false;
+
+            bool resident = gaos::memory::make_resident(
+              (std::byte*)current_stack_data.blob + current_stack_data.offset,
+              current_stack_data.blob->size - current_stack_data.offset,
+              mode
+            );
+            for (blob_meta *blob = current_stack_data.blob->next; blob != nullptr; blob = blob->next)
+              resident &= gaos::memory::make_resident((std::byte*)blob + blob_meta_size, blob->size - blob_meta_size, mode);
+
+            return resident;
+        }
+
+
+        // Give back memory we hold on to but do not use: first the blobs
+        // past the current one (only ever used before a pop), from the
+        // last one back, and then if that is not enough the pages at the
+        // unused end of the current blob, which we keep but let the OS
+        // reclaim; returns how many bytes were released
+        auto trim(std::size_t target_bytes) noexcept -> std::size_t {
+            std::size_t released = 0;
+            blob_meta  *current  = current_stack_data.blob;
+
+            while (current->next != nullptr && released < target_bytes) {
+                blob_meta *last = current->next;
+                while (last->next != nullptr)
+                  last = last->next;
+
+                last->previous->next = nullptr;
+                released += last->size;
+                free_buffer(last);
+            }
+
+            if (released < target_bytes) {
+                note_dirty();
+                std::byte *unused = (std::byte*)current + current_stack_data.offset;
+                released += gaos::memory::release_pages(unused, current->size - current_stack_data.offset);
+            }
+
+            return released;
+        }
+
+
+        auto allocate(std::size_t alloc_size) -> void * {
+            std::byte *ptr = claim<false>(alloc_size);
+
+            gaos::memory::log_allocate(ptr, alloc_size);
+            return ptr;
+        }
+
+
+        // Bumps are not aligned unless asked; this pads the bump up to
+        // alignment (a power of two) first, as typed memory needs
+        auto allocate_aligned(std::size_t alloc_size, std::size_t alignment) -> void * {
+            std::byte *ptr = claim<false>(alloc_size, alignment);
+
+            gaos::memory::log_allocate(ptr, alloc_size);
+            return ptr;
+        }
+
+
+        // Any new blobs we need for zeroed allocations we get zeroed from
+        // the internal allocator, so we only clear the part of an allocation
+        // that overlaps memory handed out (and since popped) before
+        auto allocate_zeroed(std::size_t alloc_size, std::size_t alignment = 1) -> void * {
+            std::byte *ptr  = claim<true>(alloc_size, alignment);
+            std::byte *blob = (std::byte*)(current_stack_data.blob);
+
+            // Perfect-fit blobs are never the current blob, and always fresh
+            if (ptr > blob && ptr < blob + current_stack_data.blob->size) {
+                std::byte *dirty_end = blob + current_stack_data.blob->dirty_size;
+                if (ptr < dirty_end)
+                  gaos::memory::clear(ptr, std::min((std::size_t)(dirty_end - ptr), alloc_size));
+            }
+
+            gaos::memory::log_allocate(ptr, alloc_size);
+            return ptr;
+        }
+
+
+        void deallocate(void *ptr, std::size_t alloc_size) {
+            // Deallocation is a noop -- this makes this allocator fast
+            // but obviously with many repeated allocations it wastes enormous
+            // amounts of space; we only count how much
+            current_stack_data.dead_size += alloc_size;
+            gaos::memory::log_deallocate(ptr, alloc_size);
+        }
+
+
+        // Hand out count blocks at once, all from one claim, so they lie
+        // back to back in one blob (a perfect-fit blob if need be)
+        auto allocate_batch(std::size_t alloc_size, std::size_t count, void **out) -> std::size_t {
+            if (count == 0 || alloc_size > std::numeric_limits<std::size_t>::max() / count)
+              return 0;
+
+            // Blocks follow each other, so aligning the first to its size
+            // (up to max_align_t) aligns every one of them as a single
+            // allocation of that size would need
+            std::size_t alignment = std::min<std::size_t>(alignof(std::max_align_t), alloc_size & (~alloc_size + 1));
+            std::byte  *ptr       = claim<false>(alloc_size * count, alignment);
+            if (ptr == nullptr)
+              return 0;
+
+            for (std::size_t i = 0; i < count; ++i) {
+                out[i] = ptr + i * alloc_size;
+                gaos::memory::log_allocate(out[i], alloc_size);
+            }
+            return count;
+        }
+
+
+        void deallocate_batch(void *const *ptrs, std::size_t count, std::size_t alloc_size) {
+            current_stack_data.dead_size += alloc_size * count;
+            for (std::size_t i = 0; i < count; ++i)
+              gaos::memory::log_deallocate(ptrs[i], alloc_size);
         }
 
 
-        auto allocate(std::size_t alloc_size_) -> void * {
-            // We use 32 bits to store the allocation size in a blob,
-            // so prevent larger blobs from existing -- any maniac
-            // allocating over 4GB with a linear allocator deserves
-            // the nullptr coming to them
-            if (alloc_size_ > std::numeric_limits<std::uint32_t>::max())
+        // If ptr is the latest allocation in the current blob and the new
+        // size still fits, it grows or shrinks in place; otherwise we have
+        // to allocate anew and copy, as with any other allocation -- when
+        // that fails we return nullptr, and ptr stays as it was
+        auto reallocate(void *ptr, std::size_t old_size, std::size_t new_size) -> void * {
+            std::byte *blob_start = (std::byte*)(current_stack_data.blob);
+            std::size_t ptr_offset = (std::size_t)((std::byte*)ptr - blob_start);
+
+            if (   ptr >= blob_start + blob_meta_size
+                && ptr_offset + old_size == current_stack_data.offset
+                && ptr_offset + new_size <= current_stack_data.blob->size)
+            {
+                gaos::memory::log_deallocate(ptr, old_size);
+                note_dirty();
+                current_stack_data.offset = ptr_offset + new_size;
+                gaos::memory::log_allocate(ptr, new_size);
+                return ptr;
+            }
+
+            // The copy keeps what alignment the old allocation had
+            std::size_t alignment = std::min<std::size_t>(alignof(std::max_align_t), (std::uintptr_t)ptr & (~(std::uintptr_t)ptr + 1));
+            void *new_ptr = allocate_aligned(new_size, alignment);
+            if (new_ptr == nullptr)
               return nullptr;
+            std::memcpy(new_ptr, ptr, std::min(old_size, new_size));
+            deallocate(ptr, old_size);
+            return new_ptr;
+        }
+
+        // Write our blobs down, first to last: each with how much of it is
+        // handed out (from the blobs past the current one, nothing), and
+        // with how much of everything handed out was deallocated since
+        void snapshot(gaos::memory::heap_map &map, std::string name) const {
+            gaos::memory::heap_allocator &taken = map.add(gaos::memory::heap_kind::linear_pushpop, std::move(name), min_blob.get());
+            taken.dead_bytes = current_stack_data.dead_size;
+
+            blob_meta *blob = current_stack_data.blob;
+            while (blob->previous != nullptr)
+              blob = blob->previous;
+
+            bool past_current = false;
+            for (; blob != nullptr; blob = blob->next) {
+                std::size_t used = blob_meta_size;
+                if (blob == current_stack_data.blob) {
+                    used          = current_stack_data.offset;
+                    taken.current = taken.regions.size();
+                }
+                else if (!past_current) {
+                    used = blob->used_size;
+                }
+
+                taken.regions.push_back({ (std::uint64_t)blob + blob_meta_size, blob->size - blob_meta_size, used - blob_meta_size });
+                past_current |= blob == current_stack_data.blob;
+            }
+        }
 
+      protected:
+        // Claim memory within our blobs, grabbing new blobs when needed;
+        // blobs are aligned as the internal allocator aligns, and their
+        // header keeps that, so only alignments past it need padding in
+        // a perfect-fit blob
+        template<bool zeroed>
+        auto claim(std::size_t alloc_size, std::size_t alignment = 1) -> std::byte * {
             std::byte *ptr;
-            std::uint32_t alloc_size = (std::uint32_t)alloc_size_;
+
+            std::size_t fit_padding = alignment > alignof(std::max_align_t) ? alignment - 1 : 0;
 
             // Over multiple steps, try to allocate
             for (;;) {
                 // If the allocation fits within our current blob, grab it
-                if (current_stack_data.offset + alloc_size <= current_stack_data.blob->size) {
-                    ptr = (std::byte*)(current_stack_data.blob) + current_stack_data.offset;
-                    current_stack_data.offset += alloc_size;
+                std::byte   *blob    = (std::byte*)(current_stack_data.blob);
+                std::size_t  padding = (std::size_t)(~(std::uintptr_t)(blob + current_stack_data.offset) + 1) & (alignment - 1);
+                if (current_stack_data.offset + padding + alloc_size <= current_stack_data.blob->size) {
+                    ptr = blob + current_stack_data.offset + padding;
+                    current_stack_data.offset += padding + alloc_size;
                     break;
                 }
 
@@ -115,13 +353,26 @@ namespace gaos::allocators {
                 // We insert it before so that if we pop, the larger buffer is left earlier
                 // within the list, and if we do similar large allocations in a row, it will
                 // be reused more frequently [citation needed]
-                if (current_stack_data.offset == blob_meta_size && alloc_size + blob_meta_size > min_blob_size) {
-                    blob_meta *insert_blob = alloc_buffer(current_stack_data.blob->previous, alloc_size + blob_meta_size);
+                // (Unless the next blob, like one we reserved, can take it)
+                if (   current_stack_data.offset == blob_meta_size
+                    && alloc_size + fit_padding + blob_meta_size > min_blob.get()
+                    && (current_stack_data.blob->next == nullptr || alloc_size + fit_padding + blob_meta_size > current_stack_data.blob->next->size))
+                {
+                    blob_meta *insert_blob = alloc_buffer<zeroed>(current_stack_data.blob->previous, alloc_size + fit_padding + blob_meta_size);
+                    if (insert_blob == nullptr)
+                      return nullptr;
                     current_stack_data.blob->previous = insert_blob;
-                    insert_blob->next = current_stack_data.blob;
+                    insert_blob->next       = current_stack_data.blob;
+                    insert_blob->dirty_size = insert_blob->size;
+                    insert_blob->used_size  = insert_blob->size;
                     ptr = (std::byte*)(insert_blob) + blob_meta_size;
+                    ptr = ptr + ((std::size_t)(~(std::uintptr_t)ptr + 1) & (alignment - 1));
                     break;
                 }
+
+                // We are leaving the current blob, so remember how far we got in it
+                note_dirty();
+                current_stack_data.blob->used_size = current_stack_data.offset;
                 
                 // If there is another blob, try using it
                 if (current_stack_data.blob->next != nullptr) {
@@ -130,40 +381,70 @@ namespace gaos::allocators {
                     continue;
                 }
                 
-                // If we ran out of blobs, allocate a new one and restart this cycle
-                current_stack_data.blob   = alloc_buffer(current_stack_data.blob, min_blob_size);
+                // If we ran out of blobs, allocate a new one and restart this cycle;
+                // when the internal allocator fails (say, over a budget) so do we
+                blob_meta *next_blob = alloc_buffer<zeroed>(current_stack_data.blob, min_blob.get());
+                if (next_blob == nullptr)
+                  return nullptr;
+                current_stack_data.blob   = next_blob;
                 current_stack_data.offset = blob_meta_size;
             }
 
-            gaos::memory::log_allocate(ptr, alloc_size);
             return ptr;
         }
 
 
-        void deallocate(void *ptr, std::size_t alloc_size) {
-            // Deallocation is a noop -- this makes this allocator fast
-            // but obviously with many repeated allocations it wastes enormous
-            // amounts of space
-            gaos::memory::log_deallocate(ptr, alloc_size);
+        // The offset in the current blob only goes down when we pop or
+        // leave the blob, so that is when we track how far it ever got
+        void note_dirty() noexcept {
+            blob_meta *blob = current_stack_data.blob;
+            blob->dirty_size = std::max(blob->dirty_size, current_stack_data.offset);
         }
 
-      protected:
-        auto alloc_buffer(blob_meta *previous, std::uint32_t size) -> blob_meta * {
-            // Use the internal allocator to grab a new blob
-            std::byte *ptr  = internal_allocator.allocate(size);
+
+        template<bool zeroed = false>
+        auto alloc_buffer(blob_meta *previous, std::size_t size) -> blob_meta * {
+            // Use the internal allocator to grab a new blob; when it is
+            // for a zeroed allocation we ask for it zeroed, otherwise we
+            // do not know what is in it and consider all of it dirty
+            std::byte *ptr;
+            if constexpr (zeroed)
+              ptr = gaos::allocators::allocate_zeroed(internal_allocator, size);
+            else
+              ptr = (std::byte*)internal_allocator.allocate(size);
             blob_meta *blob = (blob_meta*)ptr;
+            if (blob == nullptr)
+              return nullptr;
 
             // Link it to the existing blobs
             if (previous != nullptr)
               previous->next = blob;
-            blob->previous = previous;
-            blob->size     = size;
-            blob->next     = nullptr;
+            blob->previous   = previous;
+            blob->size       = size;
+            blob->dirty_size = zeroed ? blob_meta_size : size;
+            blob->used_size  = blob_meta_size;
+            blob->next       = nullptr;
+            blob->pages      = nullptr;
+            if constexpr (page_mapped)
+              blob->pages = gaos::memory::page_map::global().add(blob, size, { this, 0, &release });
 
             return blob;
         }
 
 
+        void free_buffer(blob_meta *blob) noexcept {
+            if constexpr (page_mapped)
+              gaos::memory::page_map::global().remove(blob->pages);
+            internal_allocator.deallocate((std::byte*)blob, blob->size);
+        }
+
+
+        // How the page map deallocates without a size
+        static void release(void *allocator, void *ptr, std::size_t alloc_size) noexcept {
+            ((this_t*)allocator)->deallocate(ptr, alloc_size);
+        }
+
+
       public:
         // Struct to store a copy of the stack and replace it, thereby
         // effectively popping all allocations after it was constructed
@@ -175,6 +456,7 @@ namespace gaos::allocators {
               buffer(buffer), stack(buffer->current_stack_data) {}
 
             ~scoped_pushpop() {
+                buffer->note_dirty();
                 buffer->current_stack_data = stack;
             }
         };
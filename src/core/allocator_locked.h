@@ -0,0 +1,75 @@
+#pragma once
+
+#include "core/memory_zeroed.h"
+
+#include <mutex>
+
+
+namespace gaos::allocators {
+
+
+    // Serialise every request to the internal allocator with a mutex, so
+    // any allocator in this project can be shared between threads --
+    // including memory allocated on one thread and freed on another
+    // Scopes are not passed through: a pushpop on a shared allocator
+    // would pop whatever the other threads allocated in the meantime
+    // Note that this expects to get an allocator which allocates bytes
+    template<typename allocator_t = std::allocator<std::byte>>
+    class locked
+    {
+      public:
+      // -- Members
+
+        allocator_t internal_allocator;
+        std::mutex  mutex;
+
+      // -- Construction
+
+        locked() noexcept {}
+        locked(allocator_t allocator) noexcept
+        : internal_allocator(allocator) {}
+
+      // -- Allocation
+
+        auto allocate(std::size_t alloc_size) -> std::byte * {
+            std::lock_guard<std::mutex> lock(mutex);
+            return (std::byte*)internal_allocator.allocate(alloc_size);
+        }
+
+
+        auto allocate_zeroed(std::size_t alloc_size) -> std::byte * {
+            std::lock_guard<std::mutex> lock(mutex);
+            return gaos::allocators::allocate_zeroed(internal_allocator, alloc_size);
+        }
+
+
+        // Only available when the internal allocator takes an alignment
+        template<typename X = allocator_t, typename = std::enable_if_t<has_allocate_aligned_v<X>>>
+        auto allocate_aligned(std::size_t alloc_size, std::size_t alignment) -> std::byte * {
+            std::lock_guard<std::mutex> lock(mutex);
+            return (std::byte*)internal_allocator.allocate_aligned(alloc_size, alignment);
+        }
+
+
+        template<typename X = allocator_t, typename = std::enable_if_t<has_allocate_aligned_v<X>>>
+        auto allocate_zeroed(std::size_t alloc_size, std::size_t alignment) -> std::byte * {
+            std::lock_guard<std::mutex> lock(mutex);
+            return (std::byte*)internal_allocator.allocate_zeroed(alloc_size, alignment);
+        }
+
+
+        void deallocate(void * ptr, std::size_t alloc_size) {
+            std::lock_guard<std::mutex> lock(mutex);
+            internal_allocator.deallocate((std::byte*)ptr, alloc_size);
+        }
+
+
+        // Some allocators in this project can be scoped and
+        // will return something sensible; this allocator does
+        // not, and so just returns a dummy int
+        auto get_scoped_pushpop() noexcept -> int {
+            return 0;
+        }
+    };
+
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
-#include "core/memory.h"
+#pragma once
+
 #include "core/memory_logging.h"
+#include "core/memory_zeroed.h"
 
 #include <iostream>
 #include <limits>
@@ -38,7 +40,15 @@ namespace gaos::allocators {
 
         auto allocate(std::size_t alloc_size) noexcept -> std::byte * {
             // Let the internal allocator do the work
-            std::byte *ptr = internal_allocator.allocate(alloc_size);
+            std::byte *ptr = (std::byte*)internal_allocator.allocate(alloc_size);
+            gaos::memory::log_allocate(ptr, alloc_size);
+            return ptr;
+        }
+
+
+        auto allocate_zeroed(std::size_t alloc_size) noexcept -> std::byte * {
+            // Let the internal allocator do the work
+            std::byte *ptr = gaos::allocators::allocate_zeroed(internal_allocator, alloc_size);
             gaos::memory::log_allocate(ptr, alloc_size);
             return ptr;
         }
@@ -47,7 +57,7 @@ namespace gaos::allocators {
         void deallocate(void * ptr, std::size_t alloc_size) noexcept {
             // Let the internal allocator do the work
             gaos::memory::log_deallocate(ptr, alloc_size);
-            internal_allocator.deallocate(ptr, alloc_size);
+            internal_allocator.deallocate((std::byte*)ptr, alloc_size);
         }
         
 
@@ -0,0 +1,368 @@
+#pragma once
+
+#include "core/allocator_traits.h"
+#include "core/memory_heap_map.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+
+#if defined(__linux__)
+  #include <sched.h>
+  #include <unistd.h>
+#endif
+
+// Restartable sequences need the kernel (4.18+) to have them, glibc
+// (2.35+) to have registered each thread with them, and a critical
+// section written for the architecture -- we only have one for x86-64
+#if defined(__linux__) && defined(__x86_64__) && defined(__GLIBC__) && __has_include(<sys/rseq.h>)
+  #include <sys/rseq.h>
+  #define GAOS_PER_CPU_RSEQ
+#endif
+
+
+namespace gaos::allocators {
+
+
+    // Cache freed blocks per CPU instead of per thread, so what is cached
+    // grows with the number of cores, not with the number of threads --
+    // an idle thread holds on to nothing
+    // Blocks are rounded up to size classes of min_class_size << i, and
+    // each CPU has a slab with a stack of up to slots_per_class blocks
+    // per class; a miss or an overflow goes to the internal allocator
+    // Where we have rseq, a push or a pop is a restartable sequence on
+    // the slab of the CPU we run on: the kernel restarts it if we are
+    // preempted or migrated before its single committing store, so it
+    // needs no atomics and no locks. Elsewhere (or with use_rseq off)
+    // each slab has a spin lock instead, which is rarely contended as
+    // only threads on the same CPU share it
+    // The internal allocator is shared by all threads, so it has to be
+    // thread-safe itself (libc with logging off, or anything under a
+    // locked)
+    // Note that this expects to get an allocator which allocates bytes
+    template<typename allocator_t = std::allocator<std::byte>, std::size_t class_count = 8, std::size_t min_class_size = 16, std::size_t slots_per_class = 64>
+    class per_cpu
+    {
+      public:
+      // -- Types
+
+        static constexpr std::size_t max_class_size = min_class_size << (class_count - 1);
+
+        // The layout the critical sections below rely on: the count first,
+        // then the slots
+        struct slab_class {
+            std::uint64_t  count;
+            void          *slots[slots_per_class];
+        };
+
+        struct cpu_slab {
+            slab_class       classes[class_count];
+            std::atomic_flag lock;
+        };
+
+      // -- Members
+
+        allocator_t  internal_allocator;
+        cpu_slab    *slabs     = nullptr;
+        std::size_t  cpu_count = 0;
+        bool         use_rseq  = false;
+
+      // -- Construction
+
+        per_cpu(allocator_t allocator = {}, bool allow_rseq = true) noexcept
+        : internal_allocator(allocator) {
+          #if defined(__linux__)
+            long configured = sysconf(_SC_NPROCESSORS_CONF);
+            cpu_count = configured > 0 ? (std::size_t)configured : 1;
+          #else
+            cpu_count = 1;
+          #endif
+
+            slabs = (cpu_slab*)internal_allocator.allocate(cpu_count * sizeof(cpu_slab));
+            for (std::size_t cpu = 0; cpu < cpu_count; ++cpu) {
+                cpu_slab *slab = new (slabs + cpu) cpu_slab;
+                for (slab_class &c : slab->classes)
+                  c.count = 0;
+                slab->lock.clear();
+            }
+
+            use_rseq = allow_rseq && rseq_available();
+        }
+
+        per_cpu(per_cpu const&) = delete;
+        auto operator=(per_cpu const&) -> per_cpu& = delete;
+
+        // Like any allocator, only destroy this when no thread uses it
+        ~per_cpu() noexcept {
+            for (std::size_t cpu = 0; cpu < cpu_count; ++cpu) {
+                for (std::size_t c = 0; c < class_count; ++c) {
+                    slab_class &cached = slabs[cpu].classes[c];
+                    while (cached.count > 0)
+                      internal_allocator.deallocate((std::byte*)cached.slots[--cached.count], class_size(c));
+                }
+                slabs[cpu].~cpu_slab();
+            }
+            internal_allocator.deallocate((std::byte*)slabs, cpu_count * sizeof(cpu_slab));
+        }
+
+
+        // Whether this thread can use restartable sequences
+        static bool rseq_available() noexcept {
+          #if defined(GAOS_PER_CPU_RSEQ)
+            return __rseq_size >= 20 && (std::int32_t)current_rseq()->cpu_id >= 0;
+          #else
+            return false;
+          #endif
+        }
+
+      // -- Allocation
+
+        auto allocate(std::size_t alloc_size) noexcept -> std::byte * {
+            if (alloc_size > max_class_size)
+              return (std::byte*)internal_allocator.allocate(alloc_size);
+
+            std::size_t size_class = class_of(alloc_size);
+
+            void *ptr = use_rseq ? pop_rseq(size_class) : pop_locked(size_class);
+            if (ptr == nullptr)
+              ptr = internal_allocator.allocate(class_size(size_class));
+            return (std::byte*)ptr;
+        }
+
+
+        void deallocate(void * ptr, std::size_t alloc_size) noexcept {
+            if (alloc_size > max_class_size) {
+                internal_allocator.deallocate((std::byte*)ptr, alloc_size);
+                return;
+            }
+
+            std::size_t size_class = class_of(alloc_size);
+
+            bool cached = use_rseq ? push_rseq(size_class, ptr) : push_locked(size_class, ptr);
+            if (!cached)
+              internal_allocator.deallocate((std::byte*)ptr, class_size(size_class));
+        }
+
+
+        // Some allocators in this project can be scoped and
+        // will return something sensible; this allocator does
+        // not, and so just returns a dummy int
+        auto get_scoped_pushpop() noexcept -> int {
+            return 0;
+        }
+
+
+        // The most this can ever cache, however many threads use it
+        auto max_cached_bytes() const noexcept -> std::size_t {
+            std::size_t per_slab = 0;
+            for (std::size_t c = 0; c < class_count; ++c)
+              per_slab += slots_per_class * class_size(c);
+            return cpu_count * per_slab;
+        }
+
+
+        // Write down every cached block, slab by slab and class by class,
+        // in the order each stack hands them out
+        void snapshot(gaos::memory::heap_map &map, std::string name) const {
+            gaos::memory::heap_allocator &taken = map.add(gaos::memory::heap_kind::per_cpu, std::move(name), min_class_size);
+
+            for (std::size_t cpu = 0; cpu < cpu_count; ++cpu) {
+                for (std::size_t c = 0; c < class_count; ++c) {
+                    slab_class const &cached = slabs[cpu].classes[c];
+                    for (std::size_t slot = cached.count; slot-- > 0;)
+                      taken.free_blocks.push_back({ (std::uint64_t)cached.slots[slot], class_size(c) });
+                }
+            }
+        }
+
+      protected:
+        static constexpr auto class_size(std::size_t size_class) noexcept -> std::size_t {
+            return min_class_size << size_class;
+        }
+
+
+        static auto class_of(std::size_t alloc_size) noexcept -> std::size_t {
+            std::size_t size_class = 0;
+            while (class_size(size_class) < alloc_size)
+              ++size_class;
+            return size_class;
+        }
+
+      // -- Locked path
+
+        static auto current_cpu() noexcept -> std::size_t {
+          #if defined(__linux__)
+            int cpu = sched_getcpu();
+            return cpu > 0 ? (std::size_t)cpu : 0;
+          #else
+            return 0;
+          #endif
+        }
+
+
+        auto lock_slab() noexcept -> cpu_slab * {
+            // The owner may have been preempted on this CPU, in which case
+            // spinning only keeps it from running again
+            cpu_slab *slab = slabs + current_cpu() % cpu_count;
+            for (int spin = 0; slab->lock.test_and_set(std::memory_order_acquire); ++spin) {
+                if (spin >= 64)
+                  std::this_thread::yield();
+            }
+            return slab;
+        }
+
+
+        auto pop_locked(std::size_t size_class) noexcept -> void * {
+            cpu_slab   *slab   = lock_slab();
+            slab_class &cached = slab->classes[size_class];
+            void       *ptr    = cached.count > 0 ? cached.slots[--cached.count] : nullptr;
+            slab->lock.clear(std::memory_order_release);
+            return ptr;
+        }
+
+
+        bool push_locked(std::size_t size_class, void *ptr) noexcept {
+            cpu_slab   *slab   = lock_slab();
+            slab_class &cached = slab->classes[size_class];
+            bool        room   = cached.count < slots_per_class;
+            if (room)
+              cached.slots[cached.count++] = ptr;
+            slab->lock.clear(std::memory_order_release);
+            return room;
+        }
+
+      // -- Restartable sequences
+
+      #if defined(GAOS_PER_CPU_RSEQ)
+        static auto current_rseq() noexcept -> struct rseq * {
+            return (struct rseq*)((std::byte*)__builtin_thread_pointer() + __rseq_offset);
+        }
+      #endif
+
+        // Each critical section is described by a struct rseq_cs in the
+        // __rseq_cs section (its start, its length up to and including the
+        // commit, and where to go on an abort), which we point the thread's
+        // rseq area at before we start; the abort handler has to be preceded
+        // by the signature glibc registered the thread with
+        // Both sections find the slab class of the current CPU from the
+        // cpu_id in the rseq area, and we retry them from the start when
+        // they are aborted
+
+        auto pop_rseq(std::size_t size_class) noexcept -> void * {
+          #if defined(GAOS_PER_CPU_RSEQ)
+            struct rseq   *area   = current_rseq();
+            slab_class    *first  = &slabs[0].classes[size_class];
+            std::uint64_t  stride = sizeof(cpu_slab);
+            void          *ptr;
+
+          retry:
+            asm goto (
+                ".pushsection __rseq_cs, \"aw\"\n\t"
+                ".balign 32\n\t"
+                "3:\n\t"
+                ".long 0, 0\n\t"
+                ".quad 1f, (2f - 1f), 4f\n\t"
+                ".popsection\n\t"
+                "leaq 3b(%%rip), %%rax\n\t"
+                "movq %%rax, %[rseq_cs]\n\t"
+                "1:\n\t"
+                "movl %[cpu_id], %%eax\n\t"
+                "imulq %[stride], %%rax\n\t"
+                "addq %[first], %%rax\n\t"
+                "movq (%%rax), %%rcx\n\t"
+                "testq %%rcx, %%rcx\n\t"
+                "jz %l[empty]\n\t"
+                "movq (%%rax, %%rcx, 8), %%rdx\n\t"
+                "decq %%rcx\n\t"
+                "movq %%rcx, (%%rax)\n\t"
+                "2:\n\t"
+                "movq %%rdx, %[ptr]\n\t"
+                ".pushsection __rseq_failure, \"ax\"\n\t"
+                ".long 0x53053053\n\t"
+                "4:\n\t"
+                "jmp %l[aborted]\n\t"
+                ".popsection\n\t"
+                : [ptr] "=m" (ptr)
+                : [rseq_cs] "m" (area->rseq_cs),
+                  [cpu_id]  "m" (area->cpu_id),
+                  [stride]  "r" (stride),
+                  [first]   "r" (first)
+                : "rax", "rcx", "rdx", "memory", "cc"
+                : empty, aborted
+            );
+            return ptr;
+
+          empty:
+            return nullptr;
+
+          aborted:
+            goto retry;
+          #else
+            (void)size_class;
+            return nullptr;
+          #endif
+        }
+
+
+        bool push_rseq(std::size_t size_class, void *ptr) noexcept {
+          #if defined(GAOS_PER_CPU_RSEQ)
+            struct rseq   *area     = current_rseq();
+            slab_class    *first    = &slabs[0].classes[size_class];
+            std::uint64_t  stride   = sizeof(cpu_slab);
+            std::uint64_t  capacity = slots_per_class;
+
+          retry:
+            // The slot past the count is ours to write until we commit
+            asm goto (
+                ".pushsection __rseq_cs, \"aw\"\n\t"
+                ".balign 32\n\t"
+                "3:\n\t"
+                ".long 0, 0\n\t"
+                ".quad 1f, (2f - 1f), 4f\n\t"
+                ".popsection\n\t"
+                "leaq 3b(%%rip), %%rax\n\t"
+                "movq %%rax, %[rseq_cs]\n\t"
+                "1:\n\t"
+                "movl %[cpu_id], %%eax\n\t"
+                "imulq %[stride], %%rax\n\t"
+                "addq %[first], %%rax\n\t"
+                "movq (%%rax), %%rcx\n\t"
+                "cmpq %[capacity], %%rcx\n\t"
+                "jae %l[full]\n\t"
+                "movq %[ptr], 8(%%rax, %%rcx, 8)\n\t"
+                "incq %%rcx\n\t"
+                "movq %%rcx, (%%rax)\n\t"
+                "2:\n\t"
+                ".pushsection __rseq_failure, \"ax\"\n\t"
+                ".long 0x53053053\n\t"
+                "4:\n\t"
+                "jmp %l[aborted]\n\t"
+                ".popsection\n\t"
+                :
+                : [rseq_cs]  "m" (area->rseq_cs),
+                  [cpu_id]   "m" (area->cpu_id),
+                  [stride]   "r" (stride),
+                  [first]    "r" (first),
+                  [capacity] "r" (capacity),
+                  [ptr]      "r" (ptr)
+                : "rax", "rcx", "memory", "cc"
+                : full, aborted
+            );
+            return true;
+
+          full:
+            return false;
+
+          aborted:
+            goto retry;
+          #else
+            (void)size_class;
+            (void)ptr;
+            return false;
+          #endif
+        }
+    };
+
+}
\ No newline at end of file
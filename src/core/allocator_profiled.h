@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core/memory_heap_profiler.h"
+#include "core/memory_zeroed.h"
+
+#include <iostream>
+
+
+namespace gaos::allocators {
+
+
+    // Report allocations through the internal allocator to a sampling
+    // heap profiler, which can be shared by any number of these layers
+    // When an allocation is not sampled this costs a thread-local
+    // decrement, and a deallocation costs a check if anything is
+    // sampled at all, plus a lock-free probe if so
+    // Note that this expects to get an allocator which allocates bytes
+    template<typename allocator_t = std::allocator<std::byte>>
+    class profiled
+    {
+      public:
+      // -- Members
+
+        allocator_t                  internal_allocator;
+        gaos::memory::heap_profiler *profiler;
+
+      // -- Construction
+
+        profiled(gaos::memory::heap_profiler *profiler, allocator_t allocator = {}) noexcept
+        : internal_allocator(allocator), profiler(profiler) {}
+
+      // -- Allocation
+
+        auto allocate(std::size_t alloc_size) noexcept -> std::byte * {
+            std::byte *ptr = (std::byte*)internal_allocator.allocate(alloc_size);
+            if (profiler->should_sample(alloc_size))
+              profiler->record_allocation(ptr, alloc_size);
+            return ptr;
+        }
+
+
+        auto allocate_zeroed(std::size_t alloc_size) noexcept -> std::byte * {
+            std::byte *ptr = gaos::allocators::allocate_zeroed(internal_allocator, alloc_size);
+            if (profiler->should_sample(alloc_size))
+              profiler->record_allocation(ptr, alloc_size);
+            return ptr;
+        }
+
+
+        void deallocate(void * ptr, std::size_t alloc_size) noexcept {
+            if (profiler->may_be_sampled())
+              profiler->record_deallocation(ptr);
+            internal_allocator.deallocate((std::byte*)ptr, alloc_size);
+        }
+
+
+        // Some allocators in this project can be scoped;
+        // We pass this scoped pushpop request through too
+        auto get_scoped_pushpop() noexcept {
+            return internal_allocator.get_scoped_pushpop();
+        }
+    };
+
+}
\ No newline at end of file
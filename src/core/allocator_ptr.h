@@ -1,4 +1,9 @@
+#pragma once
+
+#include "core/allocator_traits.h"
+#include "core/memory_batch.h"
 #include "core/memory_logging.h"
+#include "core/memory_zeroed.h"
 
 #include <iostream>
 #include <limits>
@@ -20,6 +25,7 @@ namespace gaos::allocators {
         using this_type  = ptr<T, internal_allocator_t>;
         using value_type = T;
         static constexpr std::size_t value_size = sizeof(value_type);
+        static constexpr bool deallocate_is_noop = has_noop_deallocate_v<internal_allocator_t>;
         
       // -- Members
 
@@ -40,10 +46,26 @@ namespace gaos::allocators {
             // Allocate memory for (count  value_type)
             std::size_t size = count * value_size;
 
-            // We just pass through to the internal allocator
+            // We just pass through to the internal allocator, asking
+            // for our alignment where it does not align by itself
             // Note we do not log, as we literally do not do
             // any contributions to the allocation
-            void * p = internal_allocator->allocate(size);
+            void * p;
+            if constexpr (has_allocate_aligned_v<internal_allocator_t>)
+              p = internal_allocator->allocate_aligned(size, alignof(value_type));
+            else
+              p = internal_allocator->allocate(size);
+            return (value_type*)p;
+        }
+
+
+        auto allocate_zeroed(std::size_t count) noexcept -> value_type * {
+            // We just pass through to the internal allocator
+            void * p;
+            if constexpr (has_allocate_aligned_v<internal_allocator_t>)
+              p = internal_allocator->allocate_zeroed(count * value_size, alignof(value_type));
+            else
+              p = gaos::allocators::allocate_zeroed(*internal_allocator, count * value_size);
             return (value_type*)p;
         }
 
@@ -55,7 +77,43 @@ namespace gaos::allocators {
             // We just pass through to the internal allocator
             // Note we do not log, as we literally do not do
             // any contributions to the deallocation
-            internal_allocator->deallocate(p, size);
+            internal_allocator->deallocate((std::byte*)p, size);
+        }
+
+
+        // count allocations of count_each values; we pass through to the
+        // internal allocator, which does them in one go if it can
+        auto allocate_batch(std::size_t count_each, std::size_t count, void **out) noexcept -> std::size_t {
+            return gaos::allocators::allocate_batch(*internal_allocator, count_each * value_size, count, out);
+        }
+
+
+        void deallocate_batch(void *const *ptrs, std::size_t count, std::size_t count_each) noexcept {
+            gaos::allocators::deallocate_batch(*internal_allocator, ptrs, count, count_each * value_size);
+        }
+
+
+        // Only available when the internal allocator takes an alignment;
+        // for a ptr handing out bytes to another allocator (as under a
+        // locked), which passes on the alignment its own users ask for
+        template<typename X = internal_allocator_t, typename = std::enable_if_t<has_allocate_aligned_v<X>>>
+        auto allocate_aligned(std::size_t count, std::size_t alignment) noexcept -> value_type * {
+            return (value_type*)internal_allocator->allocate_aligned(count * value_size, alignment);
+        }
+
+
+        template<typename X = internal_allocator_t, typename = std::enable_if_t<has_allocate_aligned_v<X>>>
+        auto allocate_zeroed(std::size_t count, std::size_t alignment) noexcept -> value_type * {
+            return (value_type*)internal_allocator->allocate_zeroed(count * value_size, alignment);
+        }
+
+
+        // Only available when the internal allocator can reallocate
+        template<typename X = internal_allocator_t, typename = std::enable_if_t<has_reallocate_v<X>>>
+        auto reallocate(value_type * p, std::size_t old_count, std::size_t new_count) noexcept -> value_type * {
+            // We just pass through to the internal allocator
+            void * new_p = internal_allocator->reallocate(p, old_count * value_size, new_count * value_size);
+            return (value_type*)new_p;
         }
 
         
@@ -1,5 +1,16 @@
+#pragma once
+
+#include "core/allocator_traits.h"
+#include "core/memory_batch.h"
+#include "core/memory_heap_map.h"
 #include "core/memory_logging.h"
+#include "core/memory_page_map.h"
+#include "core/memory_reclaimer.h"
+#include "core/memory_zeroed.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <limits>
 
@@ -7,46 +18,208 @@
 namespace gaos::allocators {
 
 
+    // How a reuse keeps its list; each of these does a little work on the
+    // side to keep the nodes it hands out close together in memory:
+    // - prefetch: when a node is taken, prefetch the one after it, so the
+    //   next allocation does not stall on reading its link
+    // - sort_interval: after at least this many deallocations, and once
+    //   at least half the list came in since the last sort, sort the list
+    //   by address, so what is allocated next is laid out in order again
+    // - refill_count: on a miss, take this many nodes at once, as one
+    //   contiguous chunk, from the internal allocator
+    // - page_mapped: with chunks, add each one to the global page map, so
+    //   its nodes can be deallocated without a size; this costs a small
+    //   allocation and a lock for every chunk
+    template<bool prefetch_next, std::size_t sort_every, std::size_t refill_nodes, bool page_map_chunks = false>
+    struct reuse_policy {
+        static constexpr bool        prefetch      = prefetch_next;
+        static constexpr std::size_t sort_interval = sort_every;
+        static constexpr std::size_t refill_count  = refill_nodes;
+        static constexpr bool        page_mapped   = page_map_chunks;
+    };
+
+    using reuse_lifo     = reuse_policy<false, 0,       1>;
+    using reuse_prefetch = reuse_policy<true,  0,       1>;
+    using reuse_sorted   = reuse_policy<false, 1 << 12, 1>;
+    using reuse_batched  = reuse_policy<false, 0,       64>;
+
+
     // Try to reuse memory of a fixed size by creating a linked list
     // When no memory is available, use an internal allocator
     // Note this expects an allocator which allocates bytes,
     // and that this is not an allocator to be used directly
     // with std containers, as it has no size type
-    template<std::size_t fixed_alloc_size, typename allocator_t = std::allocator<std::byte>>
+    // With fixed_alloc_size as runtime_size, the constructor takes it
+    // With a batched policy, nodes can only go back to the internal
+    // allocator a chunk at a time: so clear (and destroying this) frees
+    // every chunk, including nodes still handed out, and trim only
+    // does anything when no node is handed out at all
+    template<std::size_t fixed_alloc_size, typename allocator_t = std::allocator<std::byte>, typename policy_t = reuse_lifo>
     class reuse
     {
       public:
+      // -- Types
+
+        static constexpr bool        batched           = policy_t::refill_count > 1;
+        // A chunk starts with a link to the next chunk and its range in
+        // the page map, padded so the nodes after it stay aligned
+        static constexpr std::size_t chunk_header_size = alignof(std::max_align_t) < 2 * sizeof(void*) ? 2 * sizeof(void*) : alignof(std::max_align_t);
+
       // -- Members
 
         allocator_t  internal_allocator;
         std::byte   *next = nullptr;
-        
+
+        [[no_unique_address]] size_parameter<fixed_alloc_size> fixed_size;
+
+        std::size_t  free_count        = 0;
+        std::size_t  pushes_since_sort = 0;
+        std::size_t  handed_out        = 0;
+        std::byte   *chunks            = nullptr;
+
       // -- Construction
 
-        reuse() noexcept {}
-        reuse(allocator_t allocator) noexcept
+        reuse() noexcept requires (fixed_alloc_size != runtime_size) {}
+        reuse(allocator_t allocator) noexcept requires (fixed_alloc_size != runtime_size)
         : internal_allocator(allocator) {}
 
+        reuse(std::size_t alloc_size, allocator_t allocator = {}) noexcept requires (fixed_alloc_size == runtime_size)
+        : internal_allocator(allocator), fixed_size{ alloc_size } {}
+
+        // The page map knows us by address, so we stay where we are
+        reuse(reuse const&) = delete;
+        auto operator=(reuse const&) -> reuse& = delete;
+
+
         ~reuse() noexcept {
             clear();
         }
-        
+
       // -- Allocation
 
         void clear() noexcept
         {
+            if constexpr (batched) {
+                next       = nullptr;
+                free_count = 0;
+                handed_out = 0;
+                release_chunks();
+                return;
+            }
+
             // Remove all allocations by following the linked list
             // and deallocating one by one -- note that in a real
             // scenario, we might be backed by a linear allocator
             // so we might be doing a lot of unneeded ptr chasing!
             while (next != nullptr) {
                 // Get the next ptr in the chain
-                std::byte* ptr = next;
-                next = *(std::byte**)(next);
+                std::byte* ptr = pop();
 
                 // Deallocate
-                gaos::memory::log_deallocate(ptr, fixed_alloc_size);
-                internal_allocator.deallocate(ptr, fixed_alloc_size);
+                gaos::memory::log_deallocate(ptr, fixed_size.get());
+                internal_allocator.deallocate(ptr, fixed_size.get());
+            }
+        }
+
+
+        // Clear on a reclaimer instead: the list is handed over whole, and
+        // freed into a copy of the internal allocator on its thread, which
+        // so has to be thread-safe (libc with logging off, or anything
+        // under a locked); a batched list is cleared right away,
+        // as it only frees a chunk at a time anyway
+        void clear(gaos::memory::reclaimer &later) noexcept
+        {
+            if constexpr (batched) {
+                clear();
+            }
+            else {
+                std::byte *list = next;
+                next       = nullptr;
+                free_count = 0;
+
+                later.defer([list, allocator = internal_allocator, size = fixed_size.get()]() mutable {
+                    for (std::byte *ptr = list; ptr != nullptr;) {
+                        std::byte *after = link(ptr);
+                        gaos::memory::log_deallocate(ptr, size);
+                        allocator.deallocate(ptr, size);
+                        ptr = after;
+                    }
+                });
+            }
+        }
+
+
+        // Fill the list with count nodes from the internal allocator up front,
+        // so the first count allocations do not have to go there
+        void prefill(std::size_t count) noexcept
+        {
+            std::size_t start_count = free_count;
+            while (free_count - start_count < count) {
+                std::byte *ptr = refill();
+                if (ptr == nullptr)
+                  break;
+                push(ptr);
+            }
+        }
+
+
+        // Give cached memory back to the internal allocator until at least
+        // target_bytes have been released, or there is nothing left;
+        // returns how many bytes were released
+        auto trim(std::size_t target_bytes) noexcept -> std::size_t
+        {
+            std::size_t released = 0;
+
+            if constexpr (batched) {
+                if (handed_out != 0 || target_bytes == 0)
+                  return 0;
+
+                released   = free_count * fixed_size.get();
+                next       = nullptr;
+                free_count = 0;
+                release_chunks();
+                return released;
+            }
+
+            while (next != nullptr && released < target_bytes) {
+                std::byte* ptr = pop();
+
+                gaos::memory::log_deallocate(ptr, fixed_size.get());
+                internal_allocator.deallocate(ptr, fixed_size.get());
+                released += fixed_size.get();
+            }
+            return released;
+        }
+
+
+        // Relink the list in address order, so the nodes are handed out
+        // in the order they are laid out in memory; this is a merge sort
+        // of the list itself, so it needs no memory of its own -- runs are
+        // merged as soon as two of the same length exist, so most merges
+        // touch nodes which were only just touched and are still in cache
+        void sort() noexcept
+        {
+            pushes_since_sort = 0;
+
+            // Run i holds 2^i nodes, or is empty
+            std::byte *runs[64] = {};
+
+            while (next != nullptr) {
+                std::byte *run = next;
+                next = link(next);
+                *(std::byte**)(run) = nullptr;
+
+                std::size_t i = 0;
+                for (; runs[i] != nullptr; ++i) {
+                    run     = merge(runs[i], run);
+                    runs[i] = nullptr;
+                }
+                runs[i] = run;
+            }
+
+            for (std::byte *run : runs) {
+                if (run != nullptr)
+                  next = merge(run, next);
             }
         }
 
@@ -57,20 +230,22 @@ namespace gaos::allocators {
             // If the allocation size is leq to our fixed size we try to
             // reuse an old piece of memory -- otherwise, we immediately
             // pass on this allocation req to the internal allocator
-            if (alloc_size <= fixed_alloc_size)
+            if (alloc_size <= fixed_size.get())
             {
                 // If we have a next reusable allocation, we return it
                 // and move our next ptr to the linked location
                 // Otherwise, we use the internal allocator
                 if (next != nullptr)
                 {
-                    ptr = next;
-                    next = *(std::byte**)(next);
+                    ptr = pop();
                 }
                 else
                 {
-                    ptr = (next != nullptr)? next : (std::byte*)internal_allocator.allocate(fixed_alloc_size);
+                    ptr = refill();
                 }
+
+                if constexpr (batched)
+                  handed_out += (ptr != nullptr);
             }
             else
             {
@@ -82,18 +257,61 @@ namespace gaos::allocators {
         }
 
 
+        // Reused memory is dirty and has to be cleared; only memory
+        // fresh from the internal allocator may be zero already
+        auto allocate_zeroed(std::size_t alloc_size) noexcept -> void * {
+            std::byte *ptr;
+
+            if (alloc_size <= fixed_size.get())
+            {
+                if (next != nullptr)
+                {
+                    ptr = pop();
+                    gaos::memory::clear(ptr, alloc_size);
+                }
+                else if constexpr (batched)
+                {
+                    ptr = refill();
+                    if (ptr != nullptr)
+                      gaos::memory::clear(ptr, alloc_size);
+                }
+                else
+                {
+                    ptr = gaos::allocators::allocate_zeroed(internal_allocator, fixed_size.get());
+                }
+
+                if constexpr (batched)
+                  handed_out += (ptr != nullptr);
+            }
+            else
+            {
+                ptr = gaos::allocators::allocate_zeroed(internal_allocator, alloc_size);
+            }
+
+            gaos::memory::log_allocate(ptr, alloc_size);
+            return ptr;
+        }
+
+
         void deallocate(void * ptr, std::size_t alloc_size) noexcept {
             // If the allocation size is leq to our fixed size we reuse the
             // memory; otherwise we pass on to the internal allocator
-            if (alloc_size <= fixed_alloc_size)
+            if (alloc_size <= fixed_size.get())
             {
-                gaos::memory::log_deallocate(ptr, fixed_alloc_size);
+                gaos::memory::log_deallocate(ptr, fixed_size.get());
 
                 // Make our next ptr point to the now available memory,
                 // and store the previous next ptr to create the chain
-                std::byte *old_next = next;
-                next = (std::byte*)ptr;
-                *(std::byte**)(next) = old_next;
+                push((std::byte*)ptr);
+
+                if constexpr (batched)
+                  handed_out -= 1;
+
+                if constexpr (policy_t::sort_interval != 0) {
+                    pushes_since_sort += 1;
+                    if (pushes_since_sort >= policy_t::sort_interval && 2 * pushes_since_sort >= free_count)
+                      sort();
+                }
             }
             else
             {
@@ -102,7 +320,78 @@ namespace gaos::allocators {
             }
         }
 
-        
+
+        // Hand out count nodes at once: first whatever is on the list, then
+        // when batched whole chunks, carved into as many nodes as we still
+        // need (the rest of the last chunk goes on the list), and otherwise
+        // a batch from the internal allocator
+        auto allocate_batch(std::size_t alloc_size, std::size_t count, void **out) noexcept -> std::size_t {
+            std::size_t done = 0;
+
+            if (alloc_size > fixed_size.get()) {
+                done = gaos::allocators::allocate_batch(internal_allocator, alloc_size, count, out);
+            }
+            else {
+                for (; done < count && next != nullptr; ++done)
+                  out[done] = pop();
+
+                if constexpr (batched) {
+                    while (done < count) {
+                        std::byte *first = carve_chunk();
+                        if (first == nullptr)
+                          break;
+
+                        std::size_t taken = std::min(policy_t::refill_count, count - done);
+                        for (std::size_t i = policy_t::refill_count - 1; i >= taken; --i)
+                          push(first + i * fixed_size.get());
+                        for (std::size_t i = 0; i < taken; ++i)
+                          out[done++] = first + i * fixed_size.get();
+                    }
+                    handed_out += done;
+                }
+                else {
+                    done += gaos::allocators::allocate_batch(internal_allocator, fixed_size.get(), count - done, out + done);
+                }
+            }
+
+            for (std::size_t i = 0; i < done; ++i)
+              gaos::memory::log_allocate(out[i], alloc_size);
+            return done;
+        }
+
+
+        // Take count nodes back at once: they are linked into a chain, which
+        // goes on the list as a whole -- in the order deallocating them one
+        // by one would have left them, the last on top
+        void deallocate_batch(void *const *ptrs, std::size_t count, std::size_t alloc_size) noexcept {
+            if (count == 0)
+              return;
+
+            if (alloc_size > fixed_size.get()) {
+                for (std::size_t i = 0; i < count; ++i)
+                  gaos::memory::log_deallocate(ptrs[i], alloc_size);
+                gaos::allocators::deallocate_batch(internal_allocator, ptrs, count, alloc_size);
+                return;
+            }
+
+            for (std::size_t i = 0; i < count; ++i) {
+                gaos::memory::log_deallocate(ptrs[i], fixed_size.get());
+                *(std::byte**)(ptrs[i]) = (i == 0) ? next : (std::byte*)ptrs[i - 1];
+            }
+            next        = (std::byte*)ptrs[count - 1];
+            free_count += count;
+
+            if constexpr (batched)
+              handed_out -= count;
+
+            if constexpr (policy_t::sort_interval != 0) {
+                pushes_since_sort += count;
+                if (pushes_since_sort >= policy_t::sort_interval && 2 * pushes_since_sort >= free_count)
+                  sort();
+            }
+        }
+
+
         // Some allocators in this project can be scoped;
         // We pass this scoped pushpop request through too
         // In fact, be careful when backing a reuse with a
@@ -111,6 +400,131 @@ namespace gaos::allocators {
         auto get_scoped_pushpop() noexcept -> int {
             return 1;
         }
+
+
+        // Write down our list in the order we hand it out, and when
+        // batched the chunks the nodes were carved from
+        void snapshot(gaos::memory::heap_map &map, std::string name) const {
+            gaos::memory::heap_allocator &taken = map.add(gaos::memory::heap_kind::reuse, std::move(name), fixed_size.get());
+
+            taken.free_blocks.reserve(free_count);
+            for (std::byte *node = next; node != nullptr; node = link(node))
+              taken.free_blocks.push_back({ (std::uint64_t)node, fixed_size.get() });
+
+            if constexpr (batched) {
+                for (std::byte *chunk = chunks; chunk != nullptr; chunk = link(chunk)) {
+                    std::uint64_t carved = policy_t::refill_count * fixed_size.get();
+                    taken.regions.push_back({ (std::uint64_t)(chunk + chunk_header_size), carved, carved });
+                }
+            }
+            taken.current = taken.regions.size();
+        }
+
+      protected:
+        static auto link(std::byte *node) noexcept -> std::byte * {
+            return *(std::byte**)(node);
+        }
+
+
+        auto pop() noexcept -> std::byte * {
+            std::byte *ptr = next;
+            next = link(next);
+            free_count -= 1;
+
+            // Prefetching never faults, so the end of the list is fine
+            if constexpr (policy_t::prefetch) {
+              #if defined(__GNUC__)
+                __builtin_prefetch(next);
+              #endif
+            }
+
+            return ptr;
+        }
+
+
+        // Merge two lists which are in address order
+        static auto merge(std::byte *left, std::byte *right) noexcept -> std::byte * {
+            std::byte  *head = nullptr;
+            std::byte **tail = &head;
+
+            while (left != nullptr && right != nullptr) {
+                std::byte *&take = (std::uintptr_t)right < (std::uintptr_t)left ? right : left;
+                *tail = take;
+                tail  = (std::byte**)take;
+                take  = link(take);
+            }
+
+            *tail = left != nullptr ? left : right;
+            return head;
+        }
+
+
+        void push(std::byte *ptr) noexcept {
+            *(std::byte**)(ptr) = next;
+            next = ptr;
+            free_count += 1;
+        }
+
+
+        // Get a node for a miss; when batched, take a whole chunk, keep
+        // the first node and put the others on the list in address order
+        auto refill() noexcept -> std::byte * {
+            if constexpr (!batched) {
+                return (std::byte*)internal_allocator.allocate(fixed_size.get());
+            }
+            else {
+                std::byte *first = carve_chunk();
+                if (first == nullptr)
+                  return nullptr;
+
+                for (std::size_t i = policy_t::refill_count - 1; i > 0; --i)
+                  push(first + i * fixed_size.get());
+
+                return first;
+            }
+        }
+
+
+        // Take a new chunk from the internal allocator and return its
+        // first node; none of its nodes are on the list yet
+        auto carve_chunk() noexcept -> std::byte * {
+            std::byte *chunk = (std::byte*)internal_allocator.allocate(chunk_size());
+            if (chunk == nullptr)
+              return nullptr;
+
+            *(std::byte**)(chunk) = chunks;
+            chunks = chunk;
+
+            // The header is ours, so only the nodes are in the page map
+            std::byte *first = chunk + chunk_header_size;
+            *(gaos::memory::page_map::range**)(chunk + sizeof(std::byte*)) = nullptr;
+            if constexpr (policy_t::page_mapped)
+              *(gaos::memory::page_map::range**)(chunk + sizeof(std::byte*)) =
+                gaos::memory::page_map::global().add(first, policy_t::refill_count * fixed_size.get(), { this, fixed_size.get(), &release });
+
+            return first;
+        }
+
+
+        // How the page map deallocates without a size
+        static void release(void *allocator, void *ptr, std::size_t alloc_size) noexcept {
+            ((reuse*)allocator)->deallocate(ptr, alloc_size);
+        }
+
+
+        auto chunk_size() const noexcept -> std::size_t {
+            return chunk_header_size + policy_t::refill_count * fixed_size.get();
+        }
+
+
+        void release_chunks() noexcept {
+            while (chunks != nullptr) {
+                std::byte *chunk = chunks;
+                chunks = link(chunks);
+                gaos::memory::page_map::global().remove(*(gaos::memory::page_map::range**)(chunk + sizeof(std::byte*)));
+                internal_allocator.deallocate(chunk, chunk_size());
+            }
+        }
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,262 @@
+#pragma once
+
+#include "core/memory_logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+
+namespace gaos::allocators {
+
+
+    // One circular region of a ring: memory is handed out at the head and
+    // comes back at the tail, both counting up forever, so the bytes in
+    // use are head - tail and a position in the region is the count
+    // modulo the capacity
+    // The region is a memfd mapped twice, back to back, so a block which
+    // runs past the end of the first mapping simply carries on into the
+    // second: blocks never have to be split (or skipped) at the wrap
+    // Each block starts with a header with its size and whether it was
+    // freed; blocks freed out of order wait until the ones before them
+    // are freed too, and then the tail moves past all of them at once
+    // The head is only written by whoever allocates and the tail only by
+    // whoever deallocates, so one thread can allocate while another one
+    // deallocates, without locks
+    struct ring_region
+    {
+      // -- Types
+
+        struct block_header {
+            std::size_t size;
+            std::size_t freed;
+        };
+        static constexpr std::size_t header_size = sizeof(block_header);
+
+      // -- Members
+
+        std::byte                *base     = nullptr;
+        std::size_t               capacity = 0;
+        ring_region              *older    = nullptr;
+
+        alignas(64) std::atomic<std::uint64_t> head { 0 };
+        alignas(64) std::atomic<std::uint64_t> tail { 0 };
+
+      // -- Construction
+
+        // The capacity is rounded up to whole pages; when mapping fails
+        // (and always off Linux) the region is not valid, and has no room
+        ring_region(std::size_t min_capacity) noexcept {
+          #if defined(__linux__)
+            std::size_t size = (min_capacity + page_size() - 1) / page_size() * page_size();
+
+            int fd = memfd_create("gaos_ring", MFD_CLOEXEC);
+            if (fd < 0)
+              return;
+
+            // Reserve room for both mappings first, so they end up next
+            // to each other, then map the file over both halves
+            void *reserved = mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (reserved != MAP_FAILED) {
+                std::byte *first  = (std::byte*)reserved;
+                bool       mapped = ftruncate(fd, (off_t)size) == 0
+                                 && mmap(first,        size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED
+                                 && mmap(first + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+                if (mapped) {
+                    base     = first;
+                    capacity = size;
+                    gaos::memory::log_malloc(base, capacity);
+                }
+                else {
+                    munmap(reserved, 2 * size);
+                }
+            }
+
+            // The mappings keep the file alive
+            close(fd);
+          #else
+            (void)min_capacity;
+          #endif
+        }
+
+        ring_region(ring_region const&) = delete;
+        auto operator=(ring_region const&) -> ring_region& = delete;
+
+        ~ring_region() noexcept {
+          #if defined(__unix__) || defined(__APPLE__)
+            if (base != nullptr) {
+                gaos::memory::log_free(base, capacity);
+                munmap(base, 2 * capacity);
+            }
+          #endif
+        }
+
+
+        bool valid() const noexcept {
+            return base != nullptr;
+        }
+
+
+        static auto page_size() noexcept -> std::size_t {
+          #if defined(__unix__) || defined(__APPLE__)
+            return (std::size_t)sysconf(_SC_PAGESIZE);
+          #else
+            return 4096;
+          #endif
+        }
+
+
+        bool empty() const noexcept {
+            return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+        }
+
+
+        bool contains(void const *ptr) const noexcept {
+            return ptr >= base && ptr < base + 2 * capacity;
+        }
+
+      // -- Allocation
+
+        // Returns nullptr when there is not enough room left
+        auto allocate(std::size_t alloc_size) noexcept -> std::byte * {
+            std::size_t   size = header_size + (alloc_size + header_size - 1) / header_size * header_size;
+            std::uint64_t at   = head.load(std::memory_order_relaxed);
+
+            if (at + size - tail.load(std::memory_order_acquire) > capacity)
+              return nullptr;
+
+            block_header *header = (block_header*)(base + at % capacity);
+            header->size  = size;
+            header->freed = 0;
+
+            head.store(at + size, std::memory_order_release);
+            return (std::byte*)(header + 1);
+        }
+
+
+        void deallocate(void *ptr) noexcept {
+            block_header *header = (block_header*)ptr - 1;
+            header->freed = 1;
+
+            // Move the tail past every block at it which has been freed;
+            // the head tells us where the blocks allocated so far end
+            std::uint64_t at  = tail.load(std::memory_order_relaxed);
+            std::uint64_t end = head.load(std::memory_order_acquire);
+            while (at != end) {
+                block_header *oldest = (block_header*)(base + at % capacity);
+                if (oldest->freed == 0)
+                  break;
+                at += oldest->size;
+            }
+            tail.store(at, std::memory_order_release);
+        }
+    };
+
+
+    // Allocate from a ring: for data which is freed in about the order it
+    // was allocated (messages, log records, stages of a pipeline), which
+    // linear_pushpop could only give back all at once
+    // A fixed ring fails an allocation (returns nullptr) when it is full,
+    // and can be shared by one thread allocating and one deallocating
+    // A growable ring instead starts a new region twice the size, and
+    // frees the old ones once everything in them has come back; as this
+    // changes the regions under a deallocating thread, a growable ring
+    // is for use by a single thread
+    // Mapping the first region can fail, so check valid() after
+    // constructing; a fixed ring which is not valid fails every allocation
+    // Nothing in this allocator needs the size on deallocate
+    class ring
+    {
+      public:
+      // -- Members
+
+        ring_region *current  = nullptr;
+        bool         growable = false;
+
+      // -- Construction
+
+        ring(std::size_t capacity, bool growable = false) noexcept
+        : growable(growable) {
+            current = new ring_region(capacity);
+        }
+
+        ring(ring const&) = delete;
+        auto operator=(ring const&) -> ring& = delete;
+
+        ~ring() noexcept {
+            while (current != nullptr) {
+                ring_region *older = current->older;
+                delete current;
+                current = older;
+            }
+        }
+
+
+        bool valid() const noexcept {
+            return current != nullptr && current->valid();
+        }
+
+      // -- Allocation
+
+        auto allocate(std::size_t alloc_size) noexcept -> std::byte * {
+            std::byte *ptr = current->allocate(alloc_size);
+            if (ptr != nullptr || !growable)
+              return ptr;
+
+            // The first region may not have mapped, and have no capacity
+            std::size_t capacity = 2 * std::max(current->capacity, ring_region::page_size());
+            while (capacity < 2 * (alloc_size + 2 * ring_region::header_size))
+              capacity *= 2;
+
+            ring_region *grown = new ring_region(capacity);
+            if (!grown->valid()) {
+                delete grown;
+                return nullptr;
+            }
+
+            if (current->valid())
+              grown->older = current;
+            else
+              delete current;
+            current = grown;
+            return current->allocate(alloc_size);
+        }
+
+
+        void deallocate(void *ptr, std::size_t = 0) noexcept {
+            if (!growable || current->contains(ptr)) {
+                current->deallocate(ptr);
+                return;
+            }
+
+            // An older region, which we let go of once it is empty
+            for (ring_region **at = &current->older; *at != nullptr; at = &(*at)->older) {
+                ring_region *region = *at;
+                if (!region->contains(ptr))
+                  continue;
+
+                region->deallocate(ptr);
+                if (region->empty()) {
+                    *at = region->older;
+                    delete region;
+                }
+                return;
+            }
+        }
+
+
+        // Some allocators in this project can be scoped and
+        // will return something sensible; this allocator does
+        // not, and so just returns a dummy int
+        auto get_scoped_pushpop() noexcept -> int {
+            return 0;
+        }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "core/allocator_libc.h"
+#include "core/allocator_linear_pushpop.h"
+#include "core/allocator_ptr.h"
+
+#include <cstddef>
+
+
+namespace gaos::allocators {
+
+
+    // A few linear_pushpop arenas per thread for temporary memory, so it
+    // is just a pointer bump; get one with scratch() below, which pushes
+    // it for as long as the returned scope lives
+    // Popping a scratch arena frees everything allocated in it since the
+    // push, so a function which returns its result in an arena of its
+    // caller must not take its temporaries from that same arena: it
+    // passes the arena as a conflict, and gets one of the others instead
+    // With the default two arenas every level of such nested calls just
+    // gets the other arena than the one its caller gave it, and pushes
+    // and pops on each arena stay properly nested; more arenas are only
+    // needed for functions writing into several arenas of their callers
+    template<std::size_t arena_count = 2, std::size_t min_blob_size = 1 << 16, typename allocator_t = libc<std::byte>>
+    class scratch_arenas
+    {
+      public:
+      // -- Types
+
+        using this_t  = scratch_arenas<arena_count, min_blob_size, allocator_t>;
+        using arena_t = linear_pushpop<min_blob_size, allocator_t>;
+
+        // One scratch arena, pushed until the scope ends
+        class scope
+        {
+          public:
+            arena_t                          *arena;
+            typename arena_t::scoped_pushpop  pushpop;
+
+            scope(arena_t *arena) noexcept
+            : arena(arena), pushpop(arena) {}
+
+            scope(scope const&) = delete;
+            auto operator=(scope const&) -> scope& = delete;
+
+
+            // Aligned for anything, as an arena bump by itself is not
+            auto allocate(std::size_t alloc_size) -> void * {
+                return arena->allocate_aligned(alloc_size, alignof(std::max_align_t));
+            }
+
+
+            // An allocator for std containers living within this scope;
+            // ptr asks the arena for the alignment of T
+            template<typename T = std::byte>
+            auto allocator() const noexcept -> ptr<T, arena_t> {
+                return ptr<T, arena_t>(arena);
+            }
+        };
+
+      // -- Members
+
+        arena_t arenas[arena_count];
+
+      // -- Construction
+
+        scratch_arenas() noexcept = default;
+
+        scratch_arenas(this_t const&) = delete;
+        auto operator=(this_t const&) -> this_t& = delete;
+
+
+        static auto local() noexcept -> this_t& {
+            thread_local this_t scratch;
+            return scratch;
+        }
+
+      // -- Scratch
+
+        // The first of our arenas which is none of the conflicts, which
+        // may be arenas, pointer allocators on them, or nullptr
+        template<typename... conflicts_t>
+        auto pick(conflicts_t const&... conflicts) noexcept -> arena_t * {
+            static_assert(sizeof...(conflicts) < arena_count, "more conflicts than scratch arenas to avoid them");
+
+            for (arena_t &arena : arenas) {
+                if (((address_of(conflicts) != &arena) && ...))
+                  return &arena;
+            }
+            return nullptr;
+        }
+
+      protected:
+        static auto address_of(void const *conflict) noexcept -> void const * {
+            return conflict;
+        }
+
+
+        template<typename T>
+        static auto address_of(ptr<T, arena_t> const &conflict) noexcept -> void const * {
+            return conflict.internal_allocator;
+        }
+    };
+
+    using thread_scratch = scratch_arenas<>;
+
+
+    // A scratch arena of this thread which is none of the conflicts,
+    // pushed until the returned scope ends: say
+    //   auto temp = scratch(out);
+    // in a function which returns its result in the arena out
+    template<typename... conflicts_t>
+    auto scratch(conflicts_t const&... conflicts) -> thread_scratch::scope {
+        return thread_scratch::scope(thread_scratch::local().pick(conflicts...));
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,723 @@
+#pragma once
+
+#include "core/memory_logging.h"
+#include "core/memory_offset_ptr.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <signal.h>
+  #include <sched.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#if defined(__linux__)
+  #include <linux/futex.h>
+  #include <sys/syscall.h>
+  #include <time.h>
+#endif
+
+
+namespace gaos::allocators {
+
+
+    // The part of a shared arena which lives inside the shared mapping
+    // itself: the allocator state and a small directory of named roots,
+    // so another process can find the containers built in here
+    // Allocations are rounded up to a power of two; freed blocks go on
+    // a free list per size class, and everything else is bumped from
+    // the top -- all addressed by offsets from the start of the region,
+    // so the region works the same wherever it is mapped
+    // The lock is a futex (on Linux; a spin elsewhere) holding the pid
+    // of its owner; a process which finds the owner has died takes the
+    // lock over (and counts it in locks_recovered), so the others are
+    // not stuck forever. This does not make the state safe: allocate and
+    // deallocate update the list heads, top and bytes_in_use one store
+    // at a time, so an owner dying halfway leaves them inconsistent --
+    // a block can be lost, or handed out twice. After a recovery, treat
+    // the region as suspect
+    struct shared_region
+    {
+      // -- Types
+
+        static constexpr std::uint64_t magic_value  = 0x4741'4F53'5348'4152ull;
+        static constexpr std::size_t   min_class    = 4;
+        static constexpr std::size_t   class_count  = 48;
+        static constexpr std::size_t   max_roots    = 16;
+        static constexpr std::size_t   name_length  = 32;
+        static constexpr std::uint64_t max_size     = std::uint64_t(1) << 44;
+
+        struct root {
+            char          name[name_length];
+            std::uint64_t offset;
+        };
+
+      // -- Members
+
+        std::uint64_t              magic;
+        std::uint64_t              size;
+        std::atomic<std::uint32_t> lock_word{ 0 };
+        std::atomic<std::uint32_t> waiters{ 0 };
+        std::uint64_t              top;
+        std::uint64_t              free_heads[class_count] = {};
+        std::uint64_t              bytes_in_use     = 0;
+        std::uint64_t              locks_recovered  = 0;
+        root                       roots[max_roots] = {};
+
+      // -- Construction
+
+        shared_region(std::size_t region_size) noexcept
+        : magic(magic_value), size(region_size), top(first_offset()) {}
+
+      // -- Allocation
+
+        auto allocate(std::size_t alloc_size) noexcept -> std::byte * {
+            std::size_t size_class = class_of(alloc_size);
+            if (size_class >= class_count)
+              return nullptr;
+
+            lock();
+
+            std::uint64_t offset = free_heads[size_class];
+            if (offset != 0) {
+                free_heads[size_class] = *(std::uint64_t*)at(offset);
+            }
+            else if (top + class_size(size_class) <= size) {
+                offset = top;
+                top   += class_size(size_class);
+            }
+
+            if (offset != 0)
+              bytes_in_use += class_size(size_class);
+
+            unlock();
+
+            if (offset == 0)
+              return nullptr;
+
+            gaos::memory::log_allocate(at(offset), alloc_size);
+            return at(offset);
+        }
+
+
+        void deallocate(void *ptr, std::size_t alloc_size) noexcept {
+            if (ptr == nullptr)
+              return;
+
+            gaos::memory::log_deallocate(ptr, alloc_size);
+
+            std::size_t   size_class = class_of(alloc_size);
+            std::uint64_t offset     = (std::uint64_t)((std::byte*)ptr - (std::byte*)this);
+
+            lock();
+            *(std::uint64_t*)ptr   = free_heads[size_class];
+            free_heads[size_class] = offset;
+            bytes_in_use          -= class_size(size_class);
+            unlock();
+        }
+
+
+        // Some allocators in this project can be scoped and
+        // will return something sensible; this allocator does
+        // not, and so just returns a dummy int
+        auto get_scoped_pushpop() noexcept -> int {
+            return 0;
+        }
+
+      // -- Roots
+
+        // Name an object in the region, so other processes can find it;
+        // naming a null pointer removes the name
+        bool set_root(char const *name, void const *ptr) noexcept {
+            if (std::strlen(name) >= name_length)
+              return false;
+
+            lock();
+
+            root *found = find_root_locked(name);
+            if (found == nullptr && ptr != nullptr) {
+                for (root &r : roots) {
+                    if (r.offset == 0) {
+                        std::strcpy(r.name, name);
+                        found = &r;
+                        break;
+                    }
+                }
+            }
+            if (found != nullptr)
+              found->offset = (ptr == nullptr) ? 0 : (std::uint64_t)((std::byte const*)ptr - (std::byte const*)this);
+
+            unlock();
+            return found != nullptr || ptr == nullptr;
+        }
+
+
+        auto find_root(char const *name) noexcept -> void * {
+            lock();
+            root *found = find_root_locked(name);
+            std::uint64_t offset = (found == nullptr) ? 0 : found->offset;
+            unlock();
+            return (offset == 0) ? nullptr : at(offset);
+        }
+
+
+        // Construct an object in the region and give it a name
+        template<typename T, typename... args_t>
+        auto construct(char const *name, args_t&&... args) -> T * {
+            std::byte *ptr = allocate(sizeof(T));
+            if (ptr == nullptr)
+              return nullptr;
+
+            T *object = new (ptr) T(std::forward<args_t>(args)...);
+            if (!set_root(name, object)) {
+                object->~T();
+                deallocate(ptr, sizeof(T));
+                return nullptr;
+            }
+            return object;
+        }
+
+
+        template<typename T>
+        auto find(char const *name) noexcept -> T * {
+            return (T*)find_root(name);
+        }
+
+
+        template<typename T>
+        void destroy(char const *name) noexcept {
+            T *object = find<T>(name);
+            if (object == nullptr)
+              return;
+
+            set_root(name, nullptr);
+            object->~T();
+            deallocate(object, sizeof(T));
+        }
+
+        // Whether a region read back from a file stays inside its own
+        // mapping: its size whole pages, its top within it, and every
+        // list head and root below its top -- the lists further on are
+        // trusted as much as the file is
+        bool consistent(std::size_t page_size) const noexcept {
+            if (magic != magic_value || size == 0 || size > max_size || size % page_size != 0)
+              return false;
+            if (top < first_offset() || top > size)
+              return false;
+
+            for (std::size_t size_class = 0; size_class < class_count; ++size_class) {
+                std::uint64_t head = free_heads[size_class];
+                if (head != 0 && (head < first_offset() || head > top || class_size(size_class) > top - head))
+                  return false;
+            }
+            for (root const &r : roots) {
+                if (r.offset != 0 && (r.offset < first_offset() || r.offset >= top))
+                  return false;
+            }
+            return true;
+        }
+
+      // -- Locking
+
+        void lock() noexcept {
+            std::uint32_t self = own_id();
+            for (int spin = 0;; ++spin) {
+                std::uint32_t expected = 0;
+                if (lock_word.compare_exchange_weak(expected, self, std::memory_order_acquire, std::memory_order_relaxed))
+                  return;
+
+                if (spin < 64)
+                  continue;
+
+                // A dead owner never unlocks, so take over from it
+                if (!is_alive(expected)) {
+                    if (lock_word.compare_exchange_strong(expected, self, std::memory_order_acquire, std::memory_order_relaxed)) {
+                        ++locks_recovered;
+                        return;
+                    }
+                    continue;
+                }
+
+                wait(expected);
+            }
+        }
+
+
+        void unlock() noexcept {
+            lock_word.store(0, std::memory_order_release);
+            if (waiters.load(std::memory_order_relaxed) != 0)
+              wake();
+        }
+
+      protected:
+        static constexpr auto first_offset() noexcept -> std::uint64_t {
+            return (sizeof(shared_region) + 63) / 64 * 64;
+        }
+
+
+        // class_count when no class is large enough
+        static auto class_of(std::size_t alloc_size) noexcept -> std::size_t {
+            std::size_t size_class = min_class;
+            while (size_class < class_count && class_size(size_class) < alloc_size)
+              ++size_class;
+            return size_class;
+        }
+
+
+        static constexpr auto class_size(std::size_t size_class) noexcept -> std::uint64_t {
+            return std::uint64_t(1) << size_class;
+        }
+
+
+        auto at(std::uint64_t offset) noexcept -> std::byte * {
+            return (std::byte*)this + offset;
+        }
+
+
+        auto find_root_locked(char const *name) noexcept -> root * {
+            for (root &r : roots) {
+                if (r.offset != 0 && std::strncmp(r.name, name, name_length) == 0)
+                  return &r;
+            }
+            return nullptr;
+        }
+
+
+        static auto own_id() noexcept -> std::uint32_t {
+          #if defined(__unix__) || defined(__APPLE__)
+            return (std::uint32_t)getpid();
+          #else
+            return 1;
+          #endif
+        }
+
+
+        static bool is_alive(std::uint32_t owner) noexcept {
+          #if defined(__unix__) || defined(__APPLE__)
+            return kill((pid_t)owner, 0) == 0 || errno != ESRCH;
+          #else
+            (void)owner;
+            return true;
+          #endif
+        }
+
+
+        // Sleep until the lock word changes, but not for too long,
+        // so we get to see if the owner died
+        void wait(std::uint32_t value) noexcept {
+          #if defined(__linux__)
+            waiters.fetch_add(1, std::memory_order_relaxed);
+            timespec timeout = { 0, 1000000 };
+            syscall(SYS_futex, (std::uint32_t*)&lock_word, FUTEX_WAIT, value, &timeout, nullptr, 0);
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+          #elif defined(__unix__) || defined(__APPLE__)
+            (void)value;
+            sched_yield();
+          #else
+            (void)value;
+          #endif
+        }
+
+
+        void wake() noexcept {
+          #if defined(__linux__)
+            syscall(SYS_futex, (std::uint32_t*)&lock_word, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+          #endif
+        }
+    };
+
+
+    // A handle on a shared region, mapped into this process
+    // Either create a new region (anonymous with memfd_create, so it is
+    // shared through its file descriptor, or named with shm_open), or
+    // open one which another process created, by descriptor or name
+    // The region has a fixed size, but its pages are only backed once
+    // they are touched, so it is cheap to be generous
+    // Containers shared between processes need to live in the region
+    // and use offset pointers -- see the shared<T> adapter below
+    // As nothing in the region depends on where it is mapped, it can be
+    // forked in O(1): forking freezes the file, by mapping the original
+    // privately over itself, and the fork maps the same file privately;
+    // both then share every page until one of them writes to it, and
+    // only then pay for a copy of that page; dropping the fork drops the
+    // copies. A region which is private already (a fork, or an original
+    // forked before) has writes the file does not, so forking it first
+    // writes what it sees, up to its top, to a new file to freeze
+    // Note that a forked original no longer shares its writes with other
+    // processes which mapped the file, so fork a region nobody else uses
+    class shared_arena
+    {
+      public:
+      // -- Types
+
+        // Which region to open, so that opening is never mistaken for creating
+        struct from_fd   { int fd; };
+        struct from_name { char const *name; };
+        struct from_file { char const *path; };
+        struct fork_of   { shared_arena &source; };
+
+      // -- Members
+
+        int            fd          = -1;
+        std::size_t    region_size = 0;
+        shared_region *region      = nullptr;
+        char const    *owned_name  = nullptr;
+        bool           is_private  = false;
+
+      // -- Construction
+
+        // Create a new region; named regions are unlinked again when
+        // their creator closes them, so the name has to live as long
+        // The size is rounded up to whole pages
+        shared_arena(std::size_t size, char const *name = nullptr) noexcept {
+          #if defined(__unix__) || defined(__APPLE__)
+            std::size_t page = (std::size_t)sysconf(_SC_PAGESIZE);
+            size = (size + page - 1) / page * page;
+
+            #if defined(__linux__)
+              if (name == nullptr)
+                fd = memfd_create("gaos_shared_arena", MFD_CLOEXEC);
+            #endif
+            if (name != nullptr) {
+                fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+                owned_name = name;
+            }
+            if (fd < 0 || ftruncate(fd, (off_t)size) != 0)
+              return;
+
+            if (map(size))
+              new (region) shared_region(size);
+          #else
+            (void)size;
+            (void)name;
+          #endif
+        }
+
+
+        // Open a region by descriptor; the descriptor is duplicated
+        explicit shared_arena(from_fd source) noexcept {
+          #if defined(__unix__) || defined(__APPLE__)
+            fd = dup(source.fd);
+            open_existing();
+          #else
+            (void)source;
+          #endif
+        }
+
+
+        // Open a region by name
+        explicit shared_arena(from_name source) noexcept {
+          #if defined(__unix__) || defined(__APPLE__)
+            fd = shm_open(source.name, O_RDWR, 0600);
+            open_existing();
+          #else
+            (void)source;
+          #endif
+        }
+
+
+        // Fork a region, copy-on-write; see above -- when the file cannot
+        // be frozen, we are left invalid
+        explicit shared_arena(fork_of source) noexcept {
+          #if defined(__unix__) || defined(__APPLE__)
+            shared_arena &original = source.source;
+            if (original.fd < 0 || original.region == nullptr || !original.freeze())
+              return;
+
+            fd = dup(original.fd);
+            if (fd >= 0)
+              is_private = map(original.region_size, MAP_PRIVATE);
+          #else
+            (void)source;
+          #endif
+        }
+
+
+        // Load a region saved with save() into a new anonymous region; a
+        // file which does not hold exactly a consistent region up to its
+        // top is turned down, and leaves us invalid
+        explicit shared_arena(from_file source) noexcept {
+          #if defined(__linux__)
+            int file = ::open(source.path, O_RDONLY | O_CLOEXEC);
+            if (file < 0)
+              return;
+
+            struct stat   status;
+            shared_region header(0);
+            if (   fstat(file, &status) == 0
+                && read_all(file, &header, sizeof(header))
+                && header.consistent((std::size_t)sysconf(_SC_PAGESIZE))
+                && (std::uint64_t)status.st_size == header.top)
+            {
+                fd = memfd_create("gaos_shared_arena", MFD_CLOEXEC);
+                if (fd >= 0 && ftruncate(fd, (off_t)header.size) == 0 && map(header.size)) {
+                    std::memcpy((void*)region, (void const*)&header, sizeof(header));
+                    if (!read_all(file, (std::byte*)region + sizeof(header), header.top - sizeof(header))) {
+                        gaos::memory::log_free(region, region_size);
+                        munmap(region, region_size);
+                        region = nullptr;
+                    }
+                    else {
+                        // It was saved under the lock of whoever saved it
+                        region->lock_word.store(0, std::memory_order_relaxed);
+                        region->waiters.store(0, std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            ::close(file);
+          #else
+            (void)source;
+          #endif
+        }
+
+
+        shared_arena(shared_arena const&) = delete;
+        auto operator=(shared_arena const&) -> shared_arena& = delete;
+
+
+        ~shared_arena() noexcept {
+          #if defined(__unix__) || defined(__APPLE__)
+            if (region != nullptr) {
+                gaos::memory::log_free(region, region_size);
+                munmap(region, region_size);
+            }
+            if (fd >= 0)
+              close(fd);
+            if (owned_name != nullptr)
+              shm_unlink(owned_name);
+          #endif
+        }
+
+
+        bool valid() const noexcept {
+            return region != nullptr;
+        }
+
+
+        // Write the region, up to the highest offset ever allocated, to a
+        // file; works the same for a fork, which saves what it sees
+        bool save(char const *path) const noexcept {
+          #if defined(__unix__) || defined(__APPLE__)
+            if (region == nullptr)
+              return false;
+
+            int file = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+            if (file < 0)
+              return false;
+
+            region->lock();
+            bool written = write_all(file, region, region->top);
+            region->unlock();
+
+            return (::close(file) == 0) && written;
+          #else
+            (void)path;
+            return false;
+          #endif
+        }
+
+      // -- Allocation
+
+        auto allocate(std::size_t alloc_size) noexcept -> std::byte * {
+            return region->allocate(alloc_size);
+        }
+
+
+        void deallocate(void *ptr, std::size_t alloc_size) noexcept {
+            region->deallocate(ptr, alloc_size);
+        }
+
+
+        // Some allocators in this project can be scoped and
+        // will return something sensible; this allocator does
+        // not, and so just returns a dummy int
+        auto get_scoped_pushpop() noexcept -> int {
+            return 0;
+        }
+
+      protected:
+        // Map our file privately over where it is mapped now, so nothing
+        // we write reaches the file any more; when we are private already,
+        // move what we see to a new file first
+        bool freeze() noexcept {
+          #if defined(__unix__) || defined(__APPLE__)
+            int frozen_fd = fd;
+            if (is_private) {
+              #if defined(__linux__)
+                frozen_fd = memfd_create("gaos_shared_arena", MFD_CLOEXEC);
+                if (frozen_fd < 0)
+                  return false;
+                if (   ftruncate(frozen_fd, (off_t)region_size) != 0
+                    || !write_all(frozen_fd, region, region->top))
+                {
+                    ::close(frozen_fd);
+                    return false;
+                }
+              #else
+                return false;
+              #endif
+            }
+
+            // Where this fails, the old mapping may be gone already
+            void *ptr = mmap(region, region_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, frozen_fd, 0);
+            if (ptr == MAP_FAILED) {
+                gaos::memory::log_free(region, region_size);
+                munmap(region, region_size);
+                region = nullptr;
+                if (frozen_fd != fd)
+                  ::close(frozen_fd);
+                return false;
+            }
+
+            if (frozen_fd != fd) {
+                ::close(fd);
+                fd = frozen_fd;
+            }
+            is_private = true;
+            return true;
+          #else
+            return false;
+          #endif
+        }
+
+
+        bool map(std::size_t size, int sharing = MAP_SHARED) noexcept {
+          #if defined(__unix__) || defined(__APPLE__)
+            void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, sharing, fd, 0);
+            if (ptr == MAP_FAILED)
+              return false;
+
+            gaos::memory::log_malloc(ptr, size);
+            region      = (shared_region*)ptr;
+            region_size = size;
+            return true;
+          #else
+            (void)size;
+            (void)sharing;
+            return false;
+          #endif
+        }
+
+
+        void open_existing() noexcept {
+          #if defined(__unix__) || defined(__APPLE__)
+            struct stat info;
+            if (fd < 0 || fstat(fd, &info) != 0 || (std::size_t)info.st_size < sizeof(shared_region))
+              return;
+
+            if (!map((std::size_t)info.st_size))
+              return;
+
+            if (region->magic != shared_region::magic_value || region->size != region_size) {
+                gaos::memory::log_free(region, region_size);
+                munmap(region, region_size);
+                region = nullptr;
+            }
+          #endif
+        }
+
+
+      #if defined(__unix__) || defined(__APPLE__)
+        static bool read_all(int file, void *to, std::size_t size) noexcept {
+            for (std::size_t done = 0; done < size;) {
+                ssize_t got = ::read(file, (std::byte*)to + done, size - done);
+                if (got <= 0)
+                  return false;
+                done += (std::size_t)got;
+            }
+            return true;
+        }
+
+
+        static bool write_all(int file, void const *from, std::size_t size) noexcept {
+            for (std::size_t done = 0; done < size;) {
+                ssize_t put = ::write(file, (std::byte const*)from + done, size - done);
+                if (put <= 0)
+                  return false;
+                done += (std::size_t)put;
+            }
+            return true;
+        }
+      #endif
+    };
+
+
+    // A typed allocator for std-style containers living in a shared
+    // region; both the region and the memory handed out are referenced
+    // through offset pointers, so a container built in the region by
+    // one process can be read in place by another
+    template <class T>
+    class shared
+    {
+    public:
+      // -- Types
+
+        using this_type          = shared<T>;
+        using value_type         = T;
+        using pointer            = gaos::memory::offset_ptr<T>;
+        using const_pointer      = gaos::memory::offset_ptr<T const>;
+        using void_pointer       = gaos::memory::offset_ptr<void>;
+        using const_void_pointer = gaos::memory::offset_ptr<void const>;
+        using size_type          = std::size_t;
+        using difference_type    = std::ptrdiff_t;
+        static constexpr std::size_t value_size = sizeof(value_type);
+
+      // -- Members
+
+        gaos::memory::offset_ptr<shared_region> region;
+
+      // -- Construction
+
+        shared(shared_region *region) noexcept
+        : region(region) {}
+
+        shared(shared_arena &arena) noexcept
+        : region(arena.region) {}
+
+        template <class U> shared(shared<U> const &rh) noexcept
+        : region(rh.region) {}
+
+      // -- Allocation
+
+        auto allocate(std::size_t count) noexcept -> pointer {
+            return pointer((value_type*)region->allocate(count * value_size));
+        }
+
+
+        void deallocate(pointer p, std::size_t count) noexcept {
+            region->deallocate((void*)p.get(), count * value_size);
+        }
+
+
+        // Some allocators in this project can be scoped and
+        // will return something sensible; this allocator does
+        // not, and so just returns a dummy int
+        auto get_scoped_pushpop() noexcept -> int {
+            return 0;
+        }
+    };
+
+  // -- Operators
+
+    template <class T, class U>
+    bool operator==(shared<T> const& lh, shared<U> const& rh) noexcept {
+        return lh.region == rh.region;
+    }
+
+
+    template <class T, class U>
+    bool operator!=(shared<T> const& lh, shared<U> const& rh) noexcept {
+        return !(lh == rh);
+    }
+
+}
\ No newline at end of file
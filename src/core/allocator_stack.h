@@ -1,3 +1,9 @@
+#include "core/allocator_traits.h"
+#include "core/memory_heap_map.h"
+#include "core/memory_page_map.h"
+#include "core/memory_zeroed.h"
+
+#include <cstdint>
 #include <iostream>
 
 
@@ -9,7 +15,13 @@ namespace gaos::allocators {
     // Note this expects an allocator which allocates bytes,
     // and that this is not an allocator to be used directly
     // with std containers, as it has no size type
-    template<std::size_t size_on_stack, typename allocator_t = std::allocator<std::byte>>
+    // With size_on_stack as runtime_size, the constructor takes it; as
+    // the body then has no room for it, the buffer is taken from the
+    // internal allocator once, up front
+    // With page_mapped, the buffer is added to the global page map, so
+    // anything in it can be deallocated without a size; this costs a
+    // small allocation and a lock for every stack, so it is opt-in
+    template<std::size_t size_on_stack, typename allocator_t = std::allocator<std::byte>, bool page_mapped = false>
     class stack
     {
       public:
@@ -19,23 +31,124 @@ namespace gaos::allocators {
         allocator_t                           internal_allocator;
         std::array<std::byte, size_on_stack>  buffer;
 
+        [[no_unique_address]] size_parameter<size_on_stack> stack_size;
+        std::byte                                          *runtime_buffer = nullptr;
+
+        // The buffer's range in the global page map, if we are page mapped
+        gaos::memory::page_map::range *pages = nullptr;
+
+        // How much of what the buffer handed out was deallocated since
+        std::size_t dead_size = 0;
+
       // -- Construction
         
-        stack() noexcept
-        : next_allocation(&buffer.front()) {}
+        stack() noexcept requires (size_on_stack != runtime_size) {
+            // Point to the start of the buffer in the body, as
+            // the buffer is (intentionally) left uninitialised
+            next_allocation = buffer.data();
+            if constexpr (page_mapped)
+              pages = gaos::memory::page_map::global().add(buffer.data(), size_on_stack, { this, 0, &release });
+        }
+
+        stack(std::size_t buffer_size, allocator_t allocator = {}) noexcept requires (size_on_stack == runtime_size)
+        : internal_allocator(allocator), stack_size{ buffer_size } {
+            runtime_buffer  = (std::byte*)internal_allocator.allocate(buffer_size);
+            next_allocation = runtime_buffer;
+            if constexpr (page_mapped) {
+                if (runtime_buffer != nullptr)
+                  pages = gaos::memory::page_map::global().add(runtime_buffer, buffer_size, { this, 0, &release });
+            }
+        }
+
+        // The page map knows us by address, so we stay where we are
+        stack(stack const&) = delete;
+        auto operator=(stack const&) -> stack& = delete;
+
+        ~stack() noexcept {
+            if constexpr (page_mapped)
+              gaos::memory::page_map::global().remove(pages);
+            if constexpr (size_on_stack == runtime_size)
+              internal_allocator.deallocate(runtime_buffer, stack_size.get());
+        }
 
       // -- Allocation
 
         auto allocate(std::size_t alloc_size) noexcept -> void * {
-            std::byte *ptr;
+            return claim<false>(alloc_size, 1);
+        }
+
+
+        // The buffer is bumped byte by byte, so typed users ask for the
+        // alignment of their type; the internal allocator is taken to
+        // align for any fundamental type by itself
+        auto allocate_aligned(std::size_t alloc_size, std::size_t alignment) noexcept -> void * {
+            return claim<false>(alloc_size, alignment);
+        }
+
+
+        // Our buffer lives on the stack and starts out as whatever was
+        // there before, so it always needs to be cleared
+        auto allocate_zeroed(std::size_t alloc_size, std::size_t alignment = 1) noexcept -> void * {
+            return claim<true>(alloc_size, alignment);
+        }
+
+
+        void deallocate(void * ptr, std::size_t alloc_size) {
+            gaos::memory::log_deallocate(ptr, alloc_size);
+
+            // If the ptr came from our buffer, we do nothing, as deallocation
+            // is a noop; otherwise pass the ptr on to the internal allocator
+            if (ptr >= buffer_front() && ptr < buffer_back()) {
+                dead_size += alloc_size;
+                return;
+            }
+
+            internal_allocator.deallocate((std::byte*)ptr, alloc_size);
+        }
+
+
+        // Some allocators in this project can be scoped and
+        // will return something sensible; this allocator does
+        // not, and so just returns a dummy int
+        auto get_scoped_pushpop() noexcept -> int {
+            return 0;
+        }
+
+
+        // Write down our buffer and how far into it we are; what went to
+        // the internal allocator is not ours to describe
+        void snapshot(gaos::memory::heap_map &map, std::string name) const {
+            gaos::memory::heap_allocator &taken = map.add(gaos::memory::heap_kind::stack, std::move(name));
+            taken.dead_bytes = dead_size;
+
+            std::byte const *front;
+            if constexpr (size_on_stack == runtime_size)
+              front = runtime_buffer;
+            else
+              front = buffer.data();
+
+            taken.regions.push_back({ (std::uint64_t)front, stack_size.get(), (std::uint64_t)(next_allocation - front) });
+        }
+
+      protected:
+        template<bool zeroed>
+        auto claim(std::size_t alloc_size, std::size_t alignment) noexcept -> std::byte * {
+            std::byte   *ptr;
+            std::size_t  padding = (std::size_t)(~(std::uintptr_t)next_allocation + 1) & (alignment - 1);
 
             // If we can fit our allocation in the buffer, we simply
             // return the address and move the next allocation ptr
             // If we cannot, we use the internal allocator
-            if (next_allocation + alloc_size < &buffer.back())
+            if (padding + alloc_size < (std::size_t)(buffer_back() - next_allocation))
             {
-                ptr = next_allocation;
-                next_allocation += alloc_size;
+                ptr = next_allocation + padding;
+                next_allocation = ptr + alloc_size;
+                if constexpr (zeroed)
+                  gaos::memory::clear(ptr, alloc_size);
+            }
+            else if constexpr (zeroed)
+            {
+                ptr = gaos::allocators::allocate_zeroed(internal_allocator, alloc_size);
             }
             else
             {
@@ -47,23 +160,22 @@ namespace gaos::allocators {
         }
 
 
-        void deallocate(void * ptr, std::size_t alloc_size) {
-            gaos::memory::log_deallocate(ptr, alloc_size);
+        // How the page map deallocates without a size
+        static void release(void *allocator, void *ptr, std::size_t alloc_size) noexcept {
+            ((stack*)allocator)->deallocate(ptr, alloc_size);
+        }
 
-            // If the ptr came from our buffer, we do nothing, as deallocation
-            // is a noop; otherwise pass the ptr on to the internal allocator
-            if (ptr >= &buffer.front() && ptr < &buffer.back())
-              return;
 
-            internal_allocator.deallocate((std::byte*)ptr, alloc_size);
+        auto buffer_front() noexcept -> std::byte * {
+            if constexpr (size_on_stack == runtime_size)
+              return runtime_buffer;
+            else
+              return buffer.data();
         }
 
 
-        // Some allocators in this project can be scoped and
-        // will return something sensible; this allocator does
-        // not, and so just returns a dummy int
-        auto get_scoped_pushpop() noexcept -> int {
-            return 0;
+        auto buffer_back() noexcept -> std::byte * {
+            return buffer_front() + stack_size.get() - 1;
         }
     };
 
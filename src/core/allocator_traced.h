@@ -0,0 +1,98 @@
+#pragma once
+
+#include "core/memory_trace.h"
+#include "core/memory_zeroed.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+
+namespace gaos::allocators {
+
+
+    // Record every request to the internal allocator into a trace, which
+    // can be saved and replayed against other configurations later (see
+    // the autotune tool); scoped pushpops are recorded as well
+    // The bookkeeping uses the global heap, so it does not show up in
+    // the stats of the allocators being traced
+    // An allocation which fails is not in the trace, as it never
+    // happened; it is counted in failed_count instead
+    // Note that this expects to get an allocator which allocates bytes
+    template<typename allocator_t = std::allocator<std::byte>>
+    class traced
+    {
+      public:
+      // -- Types
+
+        using this_t  = traced<allocator_t>;
+        using scope_t = decltype(std::declval<allocator_t&>().get_scoped_pushpop());
+
+        // Records the push when it is created and the pop when it goes,
+        // wrapping the scope of the internal allocator
+        struct scoped_pushpop {
+            scope_t  internal_scope;
+            this_t  *owner;
+
+            scoped_pushpop(this_t *owner)
+            : internal_scope(owner->internal_allocator.get_scoped_pushpop()), owner(owner) {
+                owner->trace->record_push();
+            }
+
+            ~scoped_pushpop() {
+                owner->trace->record_pop();
+            }
+        };
+
+      // -- Members
+
+        allocator_t                               internal_allocator;
+        gaos::memory::allocation_trace           *trace;
+        std::unordered_map<void*, std::uint32_t>  live_ids;
+        std::size_t                               failed_count = 0;
+
+      // -- Construction
+
+        traced(gaos::memory::allocation_trace *trace, allocator_t allocator = {}) noexcept
+        : internal_allocator(allocator), trace(trace) {}
+
+      // -- Allocation
+
+        auto allocate(std::size_t alloc_size) -> std::byte * {
+            std::byte *ptr = (std::byte*)internal_allocator.allocate(alloc_size);
+            if (ptr == nullptr) {
+                ++failed_count;
+                return nullptr;
+            }
+            live_ids[ptr] = trace->record_allocate(alloc_size, false);
+            return ptr;
+        }
+
+
+        auto allocate_zeroed(std::size_t alloc_size) -> std::byte * {
+            std::byte *ptr = gaos::allocators::allocate_zeroed(internal_allocator, alloc_size);
+            if (ptr == nullptr) {
+                ++failed_count;
+                return nullptr;
+            }
+            live_ids[ptr] = trace->record_allocate(alloc_size, true);
+            return ptr;
+        }
+
+
+        void deallocate(void * ptr, std::size_t alloc_size) {
+            auto found = live_ids.find(ptr);
+            if (found != live_ids.end()) {
+                trace->record_deallocate(found->second, alloc_size);
+                live_ids.erase(found);
+            }
+            internal_allocator.deallocate((std::byte*)ptr, alloc_size);
+        }
+
+
+        auto get_scoped_pushpop() -> scoped_pushpop {
+            return scoped_pushpop(this);
+        }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+
+namespace gaos::allocators {
+
+
+    // Not every allocator in this project supports every operation;
+    // these let containers and other allocators pick up the optional
+    // ones when the allocator they are given has them
+
+    // reallocate(ptr, old_size, new_size) -- grow or shrink an allocation,
+    // preferably without copying
+    template<typename allocator_t, typename = void>
+    struct has_reallocate : std::false_type {};
+
+    template<typename allocator_t>
+    struct has_reallocate<allocator_t, std::void_t<decltype(
+      std::declval<allocator_t&>().reallocate(nullptr, std::size_t{}, std::size_t{})
+    )>> : std::true_type {};
+
+    template<typename allocator_t>
+    inline constexpr bool has_reallocate_v = has_reallocate<allocator_t>::value;
+
+
+    // allocate_zeroed(size) -- allocate memory which reads as zero,
+    // ideally without writing to it when it is known to be zero already
+    template<typename allocator_t, typename = void>
+    struct has_allocate_zeroed : std::false_type {};
+
+    template<typename allocator_t>
+    struct has_allocate_zeroed<allocator_t, std::void_t<decltype(
+      std::declval<allocator_t&>().allocate_zeroed(std::size_t{})
+    )>> : std::true_type {};
+
+    template<typename allocator_t>
+    inline constexpr bool has_allocate_zeroed_v = has_allocate_zeroed<allocator_t>::value;
+
+
+    // allocate_aligned(size, alignment) -- allocators which do not align
+    // what they hand out by themselves (like the bump of linear_pushpop)
+    // can be asked to; typed adapters ask for the alignment of their type
+    // Those allocators also take an alignment in allocate_zeroed
+    template<typename allocator_t, typename = void>
+    struct has_allocate_aligned : std::false_type {};
+
+    template<typename allocator_t>
+    struct has_allocate_aligned<allocator_t, std::void_t<decltype(
+      std::declval<allocator_t&>().allocate_aligned(std::size_t{}, std::size_t{})
+    )>> : std::true_type {};
+
+    template<typename allocator_t>
+    inline constexpr bool has_allocate_aligned_v = has_allocate_aligned<allocator_t>::value;
+
+
+    // allocate_batch(size, count, out) / deallocate_batch(ptrs, count,
+    // size) -- hand out or take back count blocks of one size in one
+    // call, which allocators that can do better than a loop over
+    // allocate (carving a chunk, splicing a list) have
+    template<typename allocator_t, typename = void>
+    struct has_allocate_batch : std::false_type {};
+
+    template<typename allocator_t>
+    struct has_allocate_batch<allocator_t, std::void_t<decltype(
+      std::declval<allocator_t&>().allocate_batch(std::size_t{}, std::size_t{}, (void**)nullptr)
+    )>> : std::true_type {};
+
+    template<typename allocator_t>
+    inline constexpr bool has_allocate_batch_v = has_allocate_batch<allocator_t>::value;
+
+
+    // pointer -- allocators whose memory has to be addressed through
+    // something other than a plain pointer (like offset pointers into a
+    // shared mapping) say so; containers keep their own pointers as the
+    // same kind, rebound to what they point at
+    template<typename allocator_t, typename = void>
+    struct allocator_pointer {
+        template<typename U>
+        using rebind = U*;
+    };
+
+    template<typename allocator_t>
+    struct allocator_pointer<allocator_t, std::void_t<typename allocator_t::pointer>> {
+        template<typename U>
+        using rebind = typename std::pointer_traits<typename allocator_t::pointer>::template rebind<U>;
+    };
+
+    template<typename allocator_t, typename U>
+    using allocator_pointer_t = typename allocator_pointer<allocator_t>::template rebind<U>;
+
+
+    // deallocate_is_noop -- allocators which reclaim memory all at once
+    // (like linear_pushpop on a pop) and do nothing on deallocate say
+    // so; containers on them can then be given up without destroying them
+    template<typename allocator_t, typename = void>
+    struct has_noop_deallocate : std::false_type {};
+
+    template<typename allocator_t>
+    struct has_noop_deallocate<allocator_t, std::void_t<decltype(allocator_t::deallocate_is_noop)>>
+    : std::bool_constant<allocator_t::deallocate_is_noop> {};
+
+    template<typename allocator_t>
+    inline constexpr bool has_noop_deallocate_v = has_noop_deallocate<allocator_t>::value;
+
+
+    // trim(target_bytes) -- give cached memory back to the internal
+    // allocator, returning how much was released
+    template<typename allocator_t, typename = void>
+    struct has_trim : std::false_type {};
+
+    template<typename allocator_t>
+    struct has_trim<allocator_t, std::void_t<decltype(
+      std::declval<allocator_t&>().trim(std::size_t{})
+    )>> : std::true_type {};
+
+    template<typename allocator_t>
+    inline constexpr bool has_trim_v = has_trim<allocator_t>::value;
+
+
+    // runtime_size -- given as the size parameter of an allocator (like
+    // the min_blob_size of linear_pushpop), the size is passed to its
+    // constructor instead, so one build can try many sizes; no allocator
+    // has a use for a size of zero otherwise
+    inline constexpr std::size_t runtime_size = 0;
+
+    // Holds such a size parameter, taking no space when it is fixed
+    template<std::size_t fixed_size>
+    struct size_parameter {
+        static constexpr auto get() noexcept -> std::size_t {
+            return fixed_size;
+        }
+    };
+
+    template<>
+    struct size_parameter<runtime_size> {
+        std::size_t value;
+
+        auto get() const noexcept -> std::size_t {
+            return value;
+        }
+    };
+
+}
\ No newline at end of file
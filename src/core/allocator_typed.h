@@ -0,0 +1,139 @@
+#pragma once
+
+#include "core/allocator_libc.h"
+#include "core/allocator_ptr.h"
+#include "core/allocator_reuse.h"
+#include "core/allocator_traits.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+
+
+namespace gaos::allocators {
+
+
+    // A set of reuse lists, one per block size, which all get their memory
+    // from one general allocator; the typed allocator below picks the one
+    // for the type it allocates, so nothing has to be sized by hand
+    // Sizes are rounded up to their alignment (and to hold the link of
+    // the list), so types of the same size share a pool; once all pools
+    // are taken, further sizes go to the general allocator
+    // Blocks are only aligned as far as the general allocator aligns what
+    // it hands out, which for libc is any fundamental alignment
+    template<typename general_t = libc<std::byte>, std::size_t max_pools = 16>
+    class pool_registry
+    {
+      public:
+      // -- Types
+
+        using pool_t = reuse<runtime_size, ptr<std::byte, general_t>>;
+
+      // -- Members
+
+        general_t             general;
+        std::size_t           pool_count = 0;
+        std::size_t           pool_sizes[max_pools];
+        std::optional<pool_t> pools[max_pools];
+
+      // -- Construction
+
+        pool_registry(general_t allocator = {}) noexcept
+        : general(allocator) {}
+
+        // The pools point at our general allocator, so we stay where we are
+        pool_registry(pool_registry const&) = delete;
+        auto operator=(pool_registry const&) -> pool_registry& = delete;
+
+      // -- Pools
+
+        // The pool for blocks of this size and alignment, made on first
+        // use; nullptr when there is no pool left for it
+        auto pool_for(std::size_t size, std::size_t alignment) noexcept -> pool_t * {
+            std::size_t block_size = std::max((size + alignment - 1) / alignment * alignment, sizeof(std::byte*));
+
+            for (std::size_t i = 0; i < pool_count; ++i) {
+                if (pool_sizes[i] == block_size)
+                  return &*pools[i];
+            }
+
+            if (pool_count == max_pools)
+              return nullptr;
+
+            pool_sizes[pool_count] = block_size;
+            pools[pool_count].emplace(block_size, ptr<std::byte, general_t>(&general));
+            return &*pools[pool_count++];
+        }
+    };
+
+
+    // A typed allocator for std containers on a pool registry: single
+    // objects come from the pool for exactly sizeof(T) and alignof(T),
+    // and arrays from the general allocator of the registry
+    // Containers rebind their allocator to the nodes they actually
+    // allocate, so every node-based container gets an exact-fit list for
+    // its nodes, whatever they look like in this standard library
+    template <class T, class registry_t>
+    class typed
+    {
+    public:
+      // -- Types
+
+        using this_type  = typed<T, registry_t>;
+        using value_type = T;
+        using pool_t     = typename registry_t::pool_t;
+        static constexpr std::size_t value_size = sizeof(value_type);
+
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types need an aligning general allocator");
+
+      // -- Members
+
+        registry_t *registry;
+        pool_t     *pool;
+
+      // -- Construction
+
+        typed(registry_t *registry) noexcept
+        : registry(registry), pool(registry->pool_for(sizeof(T), alignof(T))) {}
+
+        template <class U> typed(typed<U, registry_t> const &rh) noexcept
+        : typed(rh.registry) {}
+
+      // -- Allocation
+
+        auto allocate(std::size_t count) noexcept -> value_type * {
+            if (count == 1 && pool != nullptr)
+              return (value_type*)pool->allocate(value_size);
+            return (value_type*)registry->general.allocate(count * value_size);
+        }
+
+
+        void deallocate(value_type * p, std::size_t count) noexcept {
+            if (count == 1 && pool != nullptr)
+              pool->deallocate(p, value_size);
+            else
+              registry->general.deallocate((std::byte*)p, count * value_size);
+        }
+
+
+        // Pools keep what they are given back, so they cannot be scoped;
+        // this allocator just returns a dummy int
+        auto get_scoped_pushpop() noexcept -> int {
+            return 0;
+        }
+    };
+
+  // -- Operators
+
+    template <class T, class U, class registry_t>
+    bool operator==(typed<T, registry_t> const& lh, typed<U, registry_t> const& rh) noexcept {
+        return lh.registry == rh.registry;
+    }
+
+
+    template <class T, class U, class registry_t>
+    bool operator!=(typed<T, registry_t> const& lh, typed<U, registry_t> const& rh) noexcept {
+        return !(lh == rh);
+    }
+
+}
\ No newline at end of file
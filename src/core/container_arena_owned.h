@@ -0,0 +1,76 @@
+#pragma once
+
+#include "core/allocator_traits.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace gaos::containers {
+
+
+    // A container can be given up without destroying it when its
+    // allocator does nothing on deallocate -- the memory goes back when
+    // the arena is popped or cleared -- and its elements need no destructor
+    template<typename container_t>
+    inline constexpr bool can_abandon_v =
+         gaos::allocators::has_noop_deallocate_v<typename container_t::allocator_type>
+      && std::is_trivially_destructible_v<typename container_t::value_type>;
+
+
+    // Hold a container in an arena and give it up rather than destroy it:
+    // when can_abandon_v holds, going out of scope costs nothing, however
+    // many nodes it has, where its destructor would visit every one of
+    // them only to deallocate into an arena which ignores it
+    // Otherwise the container is destroyed as usual
+    // As with anything in an arena, this must not outlive its scope; the
+    // usual place for one is just inside a scoped pushpop
+    template<typename container_t>
+    class arena_owned
+    {
+      public:
+      // -- Types
+
+        using this_t = arena_owned<container_t>;
+
+        static constexpr bool abandons = can_abandon_v<container_t>;
+
+      // -- Members
+
+        alignas(container_t) std::byte storage[sizeof(container_t)];
+
+      // -- Construction
+
+        template<typename... args_t>
+        explicit arena_owned(args_t&&... args) {
+            new (storage) container_t(std::forward<args_t>(args)...);
+        }
+
+        arena_owned(this_t const&) = delete;
+        auto operator=(this_t const&) -> this_t& = delete;
+
+        ~arena_owned() noexcept {
+            if constexpr (!abandons)
+              get().~container_t();
+        }
+
+      // -- Access
+
+        auto get() noexcept -> container_t& {
+            return *std::launder((container_t*)storage);
+        }
+
+
+        auto operator*() noexcept -> container_t& {
+            return get();
+        }
+
+
+        auto operator->() noexcept -> container_t* {
+            return &get();
+        }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,498 @@
+#pragma once
+
+#include "core/memory_zeroed.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+  #define GAOS_FLAT_MAP_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define GAOS_FLAT_MAP_SSE2
+#endif
+
+
+namespace gaos::containers {
+
+
+    // A group of control bytes which we can compare all at once;
+    // every control byte describes one slot of the map, and is either
+    // empty (0), deleted (1), or full (high bit set, with the low 7
+    // bits being a part of the hash of the key in the slot)
+    // Empty is zero so that a fresh table is a plain memset
+    struct flat_map_group {
+      // -- Types
+
+        using mask_t = std::uint32_t;
+
+      #if defined(GAOS_FLAT_MAP_AVX2)
+        static constexpr std::size_t width = 32;
+        __m256i ctrl;
+      #elif defined(GAOS_FLAT_MAP_SSE2)
+        static constexpr std::size_t width = 16;
+        __m128i ctrl;
+      #else
+        static constexpr std::size_t width = 16;
+        std::uint8_t ctrl[width];
+      #endif
+
+        static constexpr std::uint8_t ctrl_empty   = 0x00;
+        static constexpr std::uint8_t ctrl_deleted = 0x01;
+        static constexpr std::uint8_t ctrl_full    = 0x80;
+
+      // -- Construction
+
+        // Load a group from (unaligned) memory
+        explicit flat_map_group(std::uint8_t const *p) noexcept {
+          #if defined(GAOS_FLAT_MAP_AVX2)
+            ctrl = _mm256_loadu_si256((__m256i const*)p);
+          #elif defined(GAOS_FLAT_MAP_SSE2)
+            ctrl = _mm_loadu_si128((__m128i const*)p);
+          #else
+            std::memcpy(ctrl, p, width);
+          #endif
+        }
+
+      // -- Matching
+
+        // Get a bitmask of all the slots whose control byte is exactly value
+        auto match(std::uint8_t value) const noexcept -> mask_t {
+          #if defined(GAOS_FLAT_MAP_AVX2)
+            return (mask_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_set1_epi8((char)value), ctrl));
+          #elif defined(GAOS_FLAT_MAP_SSE2)
+            return (mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char)value), ctrl));
+          #else
+            mask_t mask = 0;
+            for (std::size_t i = 0; i < width; ++i)
+              mask |= mask_t(ctrl[i] == value) << i;
+            return mask;
+          #endif
+        }
+
+
+        auto match_empty() const noexcept -> mask_t {
+            return match(ctrl_empty);
+        }
+
+
+        // The full bit is the high bit, so the movemask gives us
+        // all full slots for free -- the rest are empty or deleted
+        auto match_empty_or_deleted() const noexcept -> mask_t {
+          #if defined(GAOS_FLAT_MAP_AVX2)
+            return ~(mask_t)_mm256_movemask_epi8(ctrl);
+          #elif defined(GAOS_FLAT_MAP_SSE2)
+            return ~(mask_t)_mm_movemask_epi8(ctrl) & 0xFFFF;
+          #else
+            mask_t mask = 0;
+            for (std::size_t i = 0; i < width; ++i)
+              mask |= mask_t((ctrl[i] & ctrl_full) == 0) << i;
+            return mask;
+          #endif
+        }
+
+
+        // Index of the lowest set bit of a non-zero mask
+        static auto lowest_bit(mask_t mask) noexcept -> std::size_t {
+          #if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return index;
+          #else
+            return (std::size_t)__builtin_ctz(mask);
+          #endif
+        }
+    };
+
+
+    // An open-addressing hash map which keeps all its control bytes
+    // and all its slots in a single allocation, probing a whole group
+    // of control bytes at once (SSE2/AVX2 where available)
+    // Inserting and erasing never allocates; only growing the table
+    // does, which is then one bulk allocation
+    // An allocator with its own pointer type (like offset pointers for
+    // a shared region) has the table addressed through that type, so a
+    // map living in such a region is readable wherever it is mapped
+    // Note this expects an allocator which allocates bytes
+    template<
+      typename key_t,
+      typename mapped_t,
+      typename allocator_t = std::allocator<std::byte>,
+      typename hash_t      = std::hash<key_t>,
+      typename equal_t     = std::equal_to<key_t>
+    >
+    class flat_map
+    {
+      public:
+      // -- Types
+
+        using this_t         = flat_map<key_t, mapped_t, allocator_t, hash_t, equal_t>;
+        using value_type     = std::pair<const key_t, mapped_t>;
+        using allocator_type = allocator_t;
+        using group          = flat_map_group;
+
+        template<typename U>
+        using pointer_t      = gaos::allocators::allocator_pointer_t<allocator_t, U>;
+
+        static constexpr std::size_t group_width  = group::width;
+        static constexpr std::size_t min_capacity = group_width;
+        static constexpr std::size_t npos         = ~std::size_t(0);
+
+        // Tables at least this size we allocate zeroed, so that the
+        // pages of a fresh table are not touched until they are used
+        static constexpr std::size_t zeroed_table_size = 1 << 16;
+
+        // Iterate over all full slots
+        template<typename map_t, typename reference_t>
+        struct basic_iterator {
+            map_t       *map;
+            std::size_t  index;
+
+            auto operator*() const noexcept -> reference_t {
+                return map->slots[index];
+            }
+
+            auto operator->() const noexcept {
+                return &**this;
+            }
+
+            auto operator++() noexcept -> basic_iterator& {
+                index = map->next_full(index + 1);
+                return *this;
+            }
+
+            bool operator==(basic_iterator const &rh) const noexcept {
+                return index == rh.index;
+            }
+
+            bool operator!=(basic_iterator const &rh) const noexcept {
+                return index != rh.index;
+            }
+        };
+
+        using iterator       = basic_iterator<this_t,       value_type&>;
+        using const_iterator = basic_iterator<this_t const, value_type const&>;
+
+      // -- Members
+
+        allocator_t               internal_allocator;
+        pointer_t<std::uint8_t>   ctrl        = nullptr;
+        pointer_t<value_type>     slots       = nullptr;
+        std::size_t               capacity    = 0;
+        std::size_t               count       = 0;
+        std::size_t               growth_left = 0;
+
+      // -- Construction
+
+        flat_map(allocator_t allocator = {}) noexcept
+        : internal_allocator(allocator) {}
+
+        flat_map(this_t const&) = delete;
+        auto operator=(this_t const&) -> this_t& = delete;
+
+        flat_map(this_t &&rh) noexcept
+        : internal_allocator(rh.internal_allocator), ctrl(rh.ctrl), slots(rh.slots)
+        , capacity(rh.capacity), count(rh.count), growth_left(rh.growth_left) {
+            rh.ctrl        = nullptr;
+            rh.slots       = nullptr;
+            rh.capacity    = 0;
+            rh.count       = 0;
+            rh.growth_left = 0;
+        }
+
+        ~flat_map() noexcept {
+            destroy_slots();
+            release_table();
+        }
+
+      // -- Access
+
+        auto size() const noexcept -> std::size_t {
+            return count;
+        }
+
+
+        bool empty() const noexcept {
+            return count == 0;
+        }
+
+
+        auto begin() noexcept -> iterator {
+            return { this, next_full(0) };
+        }
+
+
+        auto end() noexcept -> iterator {
+            return { this, capacity };
+        }
+
+
+        auto begin() const noexcept -> const_iterator {
+            return { this, next_full(0) };
+        }
+
+
+        auto end() const noexcept -> const_iterator {
+            return { this, capacity };
+        }
+
+
+        auto find(key_t const &key) noexcept -> iterator {
+            std::size_t index = find_index(key, hash_key(key));
+            return { this, (index == npos) ? capacity : index };
+        }
+
+
+        bool contains(key_t const &key) const noexcept {
+            return find_index(key, hash_key(key)) != npos;
+        }
+
+
+        auto operator[](key_t const &key) -> mapped_t& {
+            return try_emplace(key).first->second;
+        }
+
+      // -- Modification
+
+        // Find the key, or default-construct its value if it does not exist
+        template<typename... args_t>
+        auto try_emplace(key_t const &key, args_t&&... args) -> std::pair<iterator, bool> {
+            std::size_t hash  = hash_key(key);
+            std::size_t index = find_index(key, hash);
+            if (index != npos)
+              return { { this, index }, false };
+
+            // The slot is only marked full once its value is built, so a
+            // constructor that throws leaves the map as it was
+            index = prepare_insert(hash);
+            new (&slots[index]) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<args_t>(args)...));
+            mark_inserted(index, hash);
+            return { { this, index }, true };
+        }
+
+
+        // Erase leaves a tombstone, so that probe sequences running
+        // through this slot are not broken; tombstones are cleaned
+        // up when the table is next rehashed
+        auto erase(key_t const &key) noexcept -> std::size_t {
+            std::size_t index = find_index(key, hash_key(key));
+            if (index == npos)
+              return 0;
+
+            slots[index].~value_type();
+            set_ctrl(index, group::ctrl_deleted);
+            --count;
+            return 1;
+        }
+
+
+        // Destroy all entries but keep the table allocated
+        void clear() noexcept {
+            destroy_slots();
+            if (capacity != 0)
+              std::memset(&ctrl[0], group::ctrl_empty, capacity + group_width);
+            count       = 0;
+            growth_left = max_load(capacity);
+        }
+
+
+        void reserve(std::size_t reserve_count) {
+            if (reserve_count > max_load(capacity))
+              rehash(capacity_for(reserve_count));
+        }
+
+      protected:
+        // We keep the table at most 7/8 full
+        static auto max_load(std::size_t table_capacity) noexcept -> std::size_t {
+            return table_capacity - table_capacity / 8;
+        }
+
+
+        static auto capacity_for(std::size_t reserve_count) noexcept -> std::size_t {
+            std::size_t new_capacity = min_capacity;
+            while (max_load(new_capacity) < reserve_count)
+              new_capacity *= 2;
+            return new_capacity;
+        }
+
+
+        // The control bytes come first (with a mirror of the first group
+        // at the end, so a group can always be loaded without wrapping),
+        // followed by the slots aligned to the value type
+        static auto slots_offset(std::size_t table_capacity) noexcept -> std::size_t {
+            constexpr std::size_t align = alignof(value_type);
+            return (table_capacity + group_width + align - 1) / align * align;
+        }
+
+
+        static auto table_size(std::size_t table_capacity) noexcept -> std::size_t {
+            return slots_offset(table_capacity) + table_capacity * sizeof(value_type);
+        }
+
+
+        // Hashes like std::hash<int> are the identity, which would put runs
+        // of keys in the same group; mix the bits so both the position and
+        // the 7 bits we keep in the control byte are well spread
+        static auto hash_key(key_t const &key) noexcept -> std::size_t {
+            std::uint64_t hash = (std::uint64_t)hash_t{}(key) * 0x9E3779B97F4A7C15ull;
+            return std::size_t(hash ^ (hash >> 32));
+        }
+
+
+        static auto split_hash_position(std::size_t hash) noexcept -> std::size_t {
+            return hash >> 7;
+        }
+
+
+        static auto split_hash_ctrl(std::size_t hash) noexcept -> std::uint8_t {
+            return std::uint8_t(group::ctrl_full | (hash & 0x7F));
+        }
+
+
+        void set_ctrl(std::size_t index, std::uint8_t value) noexcept {
+            ctrl[index] = value;
+            if (index < group_width)
+              ctrl[capacity + index] = value;
+        }
+
+
+        auto next_full(std::size_t index) const noexcept -> std::size_t {
+            while (index < capacity && (ctrl[index] & group::ctrl_full) == 0)
+              ++index;
+            return index;
+        }
+
+
+        auto find_index(key_t const &key, std::size_t hash) const noexcept -> std::size_t {
+            if (capacity == 0)
+              return npos;
+
+            std::size_t  mask     = capacity - 1;
+            std::size_t  position = split_hash_position(hash) & mask;
+            std::uint8_t h2       = split_hash_ctrl(hash);
+
+            // Probe group by group with a triangular sequence,
+            // stopping at the first group with an empty slot
+            for (std::size_t step = group_width;; step += group_width) {
+                group g(&ctrl[position]);
+
+                for (auto match = g.match(h2); match != 0; match &= match - 1) {
+                    std::size_t index = (position + group::lowest_bit(match)) & mask;
+                    if (equal_t{}(slots[index].first, key))
+                      return index;
+                }
+
+                if (g.match_empty() != 0)
+                  return npos;
+
+                position = (position + step) & mask;
+            }
+        }
+
+
+        auto find_insert_index(std::size_t hash) const noexcept -> std::size_t {
+            std::size_t mask     = capacity - 1;
+            std::size_t position = split_hash_position(hash) & mask;
+
+            for (std::size_t step = group_width;; step += group_width) {
+                auto match = group(&ctrl[position]).match_empty_or_deleted();
+                if (match != 0)
+                  return (position + group::lowest_bit(match)) & mask;
+
+                position = (position + step) & mask;
+            }
+        }
+
+
+        // Find a slot for a new key, growing the table when needed
+        auto prepare_insert(std::size_t hash) -> std::size_t {
+            std::size_t index = (capacity == 0) ? npos : find_insert_index(hash);
+
+            // Reusing a tombstone never costs growth; taking an empty slot does,
+            // and when we are out we rehash -- to a larger table if we are
+            // genuinely full, or at the same size if tombstones clog it up
+            if (index == npos || (growth_left == 0 && ctrl[index] == group::ctrl_empty)) {
+                std::size_t new_capacity = min_capacity;
+                if (capacity != 0)
+                  new_capacity = ((count + 1) * 32 > capacity * 25) ? capacity * 2 : capacity;
+                rehash(new_capacity);
+                index = find_insert_index(hash);
+            }
+
+            return index;
+        }
+
+
+        // Mark a slot from prepare_insert as full, now it holds a value
+        void mark_inserted(std::size_t index, std::size_t hash) noexcept {
+            if (ctrl[index] == group::ctrl_empty)
+              --growth_left;
+            set_ctrl(index, split_hash_ctrl(hash));
+            ++count;
+        }
+
+
+        // Move all entries to a new table with one bulk allocation
+        void rehash(std::size_t new_capacity) {
+            std::uint8_t *old_ctrl     = (capacity == 0) ? nullptr : &ctrl[0];
+            value_type   *old_slots    = (capacity == 0) ? nullptr : &slots[0];
+            std::size_t   old_capacity = capacity;
+
+            // Empty control bytes are zero, so a zeroed table is ready as is
+            std::byte *table;
+            if (table_size(new_capacity) >= zeroed_table_size) {
+                table = gaos::allocators::allocate_zeroed(internal_allocator, table_size(new_capacity), alignof(value_type));
+            }
+            else {
+                table = gaos::allocators::allocate_aligned(internal_allocator, table_size(new_capacity), alignof(value_type));
+                std::memset(table, group::ctrl_empty, new_capacity + group_width);
+            }
+
+            ctrl        = (std::uint8_t*)table;
+            slots       = (value_type*)(table + slots_offset(new_capacity));
+            capacity    = new_capacity;
+            growth_left = max_load(new_capacity) - count;
+
+            for (std::size_t i = 0; i < old_capacity; ++i) {
+                if ((old_ctrl[i] & group::ctrl_full) == 0)
+                  continue;
+
+                std::size_t hash  = hash_key(old_slots[i].first);
+                std::size_t index = find_insert_index(hash);
+                set_ctrl(index, split_hash_ctrl(hash));
+                new (&slots[index]) value_type(std::move(old_slots[i]));
+                old_slots[i].~value_type();
+            }
+
+            if (old_capacity != 0)
+              internal_allocator.deallocate((std::byte*)old_ctrl, table_size(old_capacity));
+        }
+
+
+        void destroy_slots() noexcept {
+            if constexpr (std::is_trivially_destructible_v<value_type>)
+              return;
+
+            for (std::size_t i = 0; i < capacity; ++i) {
+                if (ctrl[i] & group::ctrl_full)
+                  slots[i].~value_type();
+            }
+        }
+
+
+        void release_table() noexcept {
+            if (capacity != 0)
+              internal_allocator.deallocate((std::byte*)&ctrl[0], table_size(capacity));
+            ctrl     = nullptr;
+            slots    = nullptr;
+            capacity = 0;
+        }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "core/container_small_vector.h"
+
+#include <string_view>
+
+
+namespace gaos::containers {
+
+
+    // A string which keeps short contents inside the object, and spills
+    // longer ones to the internal allocator -- a thin layer over a
+    // small_vector of chars which always keeps a terminating zero
+    // Note that this expects to get an allocator which allocates bytes
+    template<std::size_t inline_length = 22, typename allocator_t = std::allocator<std::byte>>
+    class small_string
+    {
+      public:
+      // -- Types
+
+        using this_t   = small_string<inline_length, allocator_t>;
+        using buffer_t = small_vector<char, inline_length + 1, allocator_t>;
+
+      // -- Members
+
+        buffer_t characters;
+
+      // -- Construction
+
+        small_string(allocator_t allocator = {}) noexcept
+        : characters(allocator) {
+            characters.push_back(0);
+        }
+
+
+        small_string(std::string_view text, allocator_t allocator = {})
+        : small_string(allocator) {
+            append(text);
+        }
+
+      // -- Access
+
+        auto size() const noexcept -> std::size_t {
+            return characters.size() - 1;
+        }
+
+
+        bool empty() const noexcept {
+            return size() == 0;
+        }
+
+
+        bool is_inline() const noexcept {
+            return characters.is_inline();
+        }
+
+
+        auto data() const noexcept -> char const* {
+            return characters.data();
+        }
+
+
+        auto c_str() const noexcept -> char const* {
+            return characters.data();
+        }
+
+
+        auto view() const noexcept -> std::string_view {
+            return { characters.data(), size() };
+        }
+
+
+        operator std::string_view() const noexcept {
+            return view();
+        }
+
+
+        auto operator[](std::size_t i) const noexcept -> char {
+            return characters[i];
+        }
+
+      // -- Modification
+
+        // The text may be (part of) ourselves, which growing can move;
+        // then we copy from where it is after the resize
+        auto append(std::string_view text) -> this_t& {
+            std::size_t old_size = size();
+            bool        own_text = text.data() >= characters.data() && text.data() < characters.data() + characters.size();
+            std::size_t offset   = own_text ? (std::size_t)(text.data() - characters.data()) : 0;
+
+            characters.resize(old_size + text.size() + 1);
+            char const *from = own_text ? characters.data() + offset : text.data();
+            if (text.size() != 0)
+              std::memmove(characters.data() + old_size, from, text.size());
+            characters[old_size + text.size()] = 0;
+            return *this;
+        }
+
+
+        void push_back(char c) {
+            characters.back() = c;
+            characters.push_back(0);
+        }
+
+
+        auto operator+=(std::string_view text) -> this_t& {
+            return append(text);
+        }
+
+
+        auto operator+=(char c) -> this_t& {
+            push_back(c);
+            return *this;
+        }
+
+
+        void clear() noexcept {
+            characters.resize(1);
+            characters[0] = 0;
+        }
+
+
+        // Give back spilled memory, moving short contents back inline
+        void shrink_to_fit() {
+            characters.shrink_to_fit();
+        }
+    };
+
+  // -- Operators
+
+    template<std::size_t lh_length, std::size_t rh_length, typename allocator_t>
+    bool operator==(small_string<lh_length, allocator_t> const &lh, small_string<rh_length, allocator_t> const &rh) noexcept {
+        return lh.view() == rh.view();
+    }
+
+
+    template<std::size_t lh_length, std::size_t rh_length, typename allocator_t>
+    bool operator!=(small_string<lh_length, allocator_t> const &lh, small_string<rh_length, allocator_t> const &rh) noexcept {
+        return !(lh == rh);
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,360 @@
+#pragma once
+
+#include "core/allocator_traits.h"
+#include "core/memory_zeroed.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace gaos::containers {
+
+
+    // A vector which keeps its first inline_count elements in a buffer
+    // inside the object itself -- so a small_vector on the stack does no
+    // allocations at all until it grows past that; it then spills to the
+    // internal allocator, and can move back inline when shrunk to fit
+    // Note that this expects to get an allocator which allocates bytes
+    template<typename T, std::size_t inline_count, typename allocator_t = std::allocator<std::byte>>
+    class small_vector
+    {
+        static_assert(inline_count > 0, "small_vector needs room for at least one inline element");
+
+      public:
+      // -- Types
+
+        using this_t         = small_vector<T, inline_count, allocator_t>;
+        using value_type     = T;
+        using allocator_type = allocator_t;
+        using iterator       = T*;
+        using const_iterator = T const*;
+        static constexpr std::size_t value_size = sizeof(value_type);
+
+      // -- Members
+
+        allocator_t  internal_allocator;
+        T           *elements;
+        std::size_t  count    = 0;
+        std::size_t  capacity = inline_count;
+
+        alignas(T) std::byte inline_buffer[inline_count * value_size];
+
+      // -- Construction
+
+        small_vector(allocator_t allocator = {}) noexcept
+        : internal_allocator(allocator), elements((T*)inline_buffer) {}
+
+
+        small_vector(std::initializer_list<T> init, allocator_t allocator = {})
+        : small_vector(allocator) {
+            reserve(init.size());
+            for (T const &value : init)
+              new (&elements[count++]) T(value);
+        }
+
+
+        small_vector(this_t const &rh)
+        : small_vector(rh.internal_allocator) {
+            reserve(rh.count);
+            for (T const &value : rh)
+              new (&elements[count++]) T(value);
+        }
+
+
+        // A spilled vector hands over its allocation; an inline
+        // vector has to move its elements one by one
+        small_vector(this_t &&rh) noexcept
+        : small_vector(rh.internal_allocator) {
+            take(std::move(rh));
+        }
+
+
+        ~small_vector() noexcept {
+            clear();
+            release();
+        }
+
+
+        auto operator=(this_t const &rh) -> this_t& {
+            if (this != &rh) {
+                clear();
+                reserve(rh.count);
+                for (T const &value : rh)
+                  new (&elements[count++]) T(value);
+            }
+            return *this;
+        }
+
+
+        auto operator=(this_t &&rh) noexcept -> this_t& {
+            if (this != &rh) {
+                clear();
+                release();
+                internal_allocator = rh.internal_allocator;
+                take(std::move(rh));
+            }
+            return *this;
+        }
+
+      // -- Access
+
+        auto size() const noexcept -> std::size_t {
+            return count;
+        }
+
+
+        bool empty() const noexcept {
+            return count == 0;
+        }
+
+
+        bool is_inline() const noexcept {
+            return (std::byte const*)elements == inline_buffer;
+        }
+
+
+        auto data() noexcept -> T* {
+            return elements;
+        }
+
+
+        auto data() const noexcept -> T const* {
+            return elements;
+        }
+
+
+        auto begin() noexcept -> iterator {
+            return elements;
+        }
+
+
+        auto end() noexcept -> iterator {
+            return elements + count;
+        }
+
+
+        auto begin() const noexcept -> const_iterator {
+            return elements;
+        }
+
+
+        auto end() const noexcept -> const_iterator {
+            return elements + count;
+        }
+
+
+        auto operator[](std::size_t i) noexcept -> T& {
+            return elements[i];
+        }
+
+
+        auto operator[](std::size_t i) const noexcept -> T const& {
+            return elements[i];
+        }
+
+
+        auto front() noexcept -> T& {
+            return elements[0];
+        }
+
+
+        auto back() noexcept -> T& {
+            return elements[count - 1];
+        }
+
+      // -- Modification
+
+        template<typename... args_t>
+        auto emplace_back(args_t&&... args) -> T& {
+            if (count == capacity)
+              return grow_and_emplace_back(std::forward<args_t>(args)...);
+            return *new (&elements[count++]) T(std::forward<args_t>(args)...);
+        }
+
+
+        void push_back(T const &value) {
+            emplace_back(value);
+        }
+
+
+        void push_back(T &&value) {
+            emplace_back(std::move(value));
+        }
+
+
+        void pop_back() noexcept {
+            elements[--count].~T();
+        }
+
+
+        void resize(std::size_t new_count) {
+            if (new_count > capacity)
+              grow_to(std::max(new_count, capacity * 2));
+            while (count > new_count)
+              pop_back();
+            while (count < new_count)
+              new (&elements[count++]) T();
+        }
+
+
+        // Erase a single element, shifting the rest down
+        auto erase(const_iterator where) -> iterator {
+            T *at = elements + (where - elements);
+            std::move(at + 1, elements + count, at);
+            pop_back();
+            return at;
+        }
+
+
+        void clear() noexcept {
+            while (count > 0)
+              pop_back();
+        }
+
+
+        void reserve(std::size_t new_capacity) {
+            if (new_capacity > capacity)
+              grow_to(new_capacity);
+        }
+
+
+        // Give back spilled memory; if the elements fit inline
+        // again they are moved back into the object
+        void shrink_to_fit() {
+            if (is_inline() || count == capacity)
+              return;
+
+            T *old_elements = elements;
+            std::size_t old_capacity = capacity;
+
+            if (count <= inline_count) {
+                elements = (T*)inline_buffer;
+                capacity = inline_count;
+            }
+            else {
+                elements = allocate_elements(count);
+                capacity = count;
+            }
+
+            relocate(old_elements, elements, count);
+            internal_allocator.deallocate((std::byte*)old_elements, old_capacity * value_size);
+        }
+
+      protected:
+        // Our allocators return nullptr when they fail; we throw, as a
+        // std::vector would, before anything of ours has changed
+        auto allocate_elements(std::size_t element_count) -> T* {
+            T *allocated = (T*)gaos::allocators::allocate_aligned(internal_allocator, element_count * value_size, alignof(T));
+            if (allocated == nullptr)
+              throw std::bad_alloc();
+            return allocated;
+        }
+
+
+        // Move-construct elements to their new home and destroy the old
+        static void relocate(T *from, T *to, std::size_t relocate_count) noexcept {
+            if constexpr (std::is_trivially_copyable_v<T>) {
+                if (relocate_count != 0)
+                  std::memcpy((void*)to, (void const*)from, relocate_count * value_size);
+            }
+            else {
+                for (std::size_t i = 0; i < relocate_count; ++i) {
+                    new (&to[i]) T(std::move(from[i]));
+                    from[i].~T();
+                }
+            }
+        }
+
+
+        void grow_to(std::size_t new_capacity) {
+            // An allocator which can reallocate may grow us without a
+            // copy (or at least without us moving element by element)
+            if constexpr (std::is_trivially_copyable_v<T> && gaos::allocators::has_reallocate_v<allocator_t>) {
+                if (!is_inline()) {
+                    // A failed reallocate leaves the old elements where they are
+                    T *grown = (T*)internal_allocator.reallocate((std::byte*)elements, capacity * value_size, new_capacity * value_size);
+                    if (grown == nullptr)
+                      throw std::bad_alloc();
+                    elements = grown;
+                    capacity = new_capacity;
+                    return;
+                }
+            }
+
+            T *new_elements = allocate_elements(new_capacity);
+            relocate(elements, new_elements, count);
+            release();
+            elements = new_elements;
+            capacity = new_capacity;
+        }
+
+
+        // The arguments may refer to one of our own elements (as in
+        // v.push_back(v[0])), so the new element is constructed in the
+        // new memory before the old elements move out -- or, when we
+        // reallocate, from a copy taken before
+        template<typename... args_t>
+        auto grow_and_emplace_back(args_t&&... args) -> T& {
+            std::size_t new_capacity = capacity * 2;
+
+            if constexpr (std::is_trivially_copyable_v<T> && gaos::allocators::has_reallocate_v<allocator_t>) {
+                if (!is_inline()) {
+                    T value(std::forward<args_t>(args)...);
+                    grow_to(new_capacity);
+                    return *new (&elements[count++]) T(value);
+                }
+            }
+
+            T *new_elements = allocate_elements(new_capacity);
+            T *added;
+            try {
+                added = new (&new_elements[count]) T(std::forward<args_t>(args)...);
+            }
+            catch (...) {
+                internal_allocator.deallocate((std::byte*)new_elements, new_capacity * value_size);
+                throw;
+            }
+
+            relocate(elements, new_elements, count);
+            release();
+            elements = new_elements;
+            capacity = new_capacity;
+            count   += 1;
+            return *added;
+        }
+
+
+        // Give back spilled memory, if any; leaves elements dangling
+        void release() noexcept {
+            if (!is_inline())
+              internal_allocator.deallocate((std::byte*)elements, capacity * value_size);
+        }
+
+
+        // Take the elements of another vector; we are expected to be
+        // empty and inline, and leave the other empty and inline
+        void take(this_t &&rh) noexcept {
+            if (rh.is_inline()) {
+                elements = (T*)inline_buffer;
+                capacity = inline_count;
+                relocate(rh.elements, elements, rh.count);
+            }
+            else {
+                elements = rh.elements;
+                capacity = rh.capacity;
+            }
+
+            count       = rh.count;
+            rh.elements = (T*)rh.inline_buffer;
+            rh.count    = 0;
+            rh.capacity = inline_count;
+        }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,455 @@
+#pragma once
+
+#include "core/allocator_linear_pushpop.h"
+#include "core/container_flat_map.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__SSE4_2__)
+  #include <nmmintrin.h>
+  #define GAOS_INTERNER_CRC32
+#endif
+
+
+namespace gaos::containers {
+
+
+    // Stands in for a shared_mutex when an interner is used by one thread
+    struct interner_no_lock {
+        void lock() noexcept {}
+        void unlock() noexcept {}
+        void lock_shared() noexcept {}
+        void unlock_shared() noexcept {}
+    };
+
+
+    // Keep one copy of every distinct string, back to back in the blobs of
+    // a linear_pushpop, and give each a 32-bit id: interned strings are
+    // equal exactly when their ids are, so comparing (and hashing, and
+    // storing) them is comparing ids, and a string seen a million times
+    // takes its bytes once rather than a heap buffer every time
+    // Ids count up from zero and stay valid, as do the views of the
+    // strings, until the interner is cleared or destroyed
+    // Strings are found through an open-addressing table of ids, probed a
+    // group of control bytes at a time like flat_map; the hash reads the
+    // string eight bytes at a time, with the SSE4.2 crc32 instruction
+    // where we are built for it, in two independent lanes
+    // With concurrent set, any number of threads can find and view at
+    // once under a shared lock; interning takes the lock exclusively only
+    // when the string is new, so a mostly warm interner is read-mostly
+    // Note this expects an allocator which allocates bytes
+    template<std::size_t blob_size = 1 << 16, typename allocator_t = std::allocator<std::byte>, bool concurrent = false>
+    class string_interner
+    {
+      public:
+      // -- Types
+
+        using id_t    = std::uint32_t;
+        using group   = flat_map_group;
+        using mutex_t = std::conditional_t<concurrent, std::shared_mutex, interner_no_lock>;
+
+        static constexpr id_t        npos         = ~id_t(0);
+        static constexpr std::size_t group_width  = group::width;
+        static constexpr std::size_t min_capacity = group_width;
+
+        // Strings are found by the table through these; the hash is kept
+        // so that most mismatches never touch the string, and so that
+        // growing the table does not hash every string again
+        struct entry {
+            char const    *data;
+            std::uint32_t  size;
+            std::uint32_t  hash;
+        };
+
+      // -- Members
+
+        gaos::allocators::linear_pushpop<blob_size, allocator_t> strings;
+
+        allocator_t       internal_allocator;
+        std::uint8_t     *ctrl           = nullptr;
+        id_t             *slots          = nullptr;
+        std::size_t       capacity       = 0;
+        std::size_t       growth_left    = 0;
+        entry            *entries        = nullptr;
+        std::size_t       count          = 0;
+        std::size_t       entry_capacity = 0;
+        std::size_t       string_bytes   = 0;
+        mutable mutex_t   mutex;
+
+      // -- Construction
+
+        string_interner(allocator_t allocator = {}) noexcept
+        : strings(allocator), internal_allocator(allocator) {}
+
+        string_interner(string_interner const&) = delete;
+        auto operator=(string_interner const&) -> string_interner& = delete;
+
+        ~string_interner() noexcept {
+            release_table();
+            if (entry_capacity != 0)
+              internal_allocator.deallocate((std::byte*)entries, entry_capacity * sizeof(entry));
+        }
+
+      // -- Access
+
+        auto size() const -> std::size_t {
+            std::shared_lock<mutex_t> lock(mutex);
+            return count;
+        }
+
+
+        // How many bytes of strings we keep, not counting the table
+        auto bytes() const -> std::size_t {
+            std::shared_lock<mutex_t> lock(mutex);
+            return string_bytes;
+        }
+
+
+        // How many bytes the table and the entries take
+        auto table_bytes() const -> std::size_t {
+            std::shared_lock<mutex_t> lock(mutex);
+            return (capacity == 0 ? 0 : table_size(capacity)) + entry_capacity * sizeof(entry);
+        }
+
+
+        auto view(id_t id) const -> std::string_view {
+            std::shared_lock<mutex_t> lock(mutex);
+            return { entries[id].data, entries[id].size };
+        }
+
+
+        // The id of a string if it was interned, npos otherwise
+        auto find(std::string_view text) const -> id_t {
+            std::uint32_t hash = hash_string(text);
+
+            std::shared_lock<mutex_t> lock(mutex);
+            return find_id(text, hash);
+        }
+
+      // -- Modification
+
+        // The id of a string, interning it if it is new; npos only when
+        // the allocator failed us
+        auto intern(std::string_view text) -> id_t {
+            std::uint32_t hash = hash_string(text);
+
+            if constexpr (concurrent) {
+                std::shared_lock<mutex_t> lock(mutex);
+                id_t id = find_id(text, hash);
+                if (id != npos)
+                  return id;
+            }
+
+            std::unique_lock<mutex_t> lock(mutex);
+            id_t id = find_id(text, hash);
+            if (id == npos)
+              id = insert(text, hash);
+            return id;
+        }
+
+
+        // As intern, but the interned copy of the string
+        auto intern_view(std::string_view text) -> std::string_view {
+            id_t id = intern(text);
+            return (id == npos) ? std::string_view() : view(id);
+        }
+
+
+        // Intern count strings into out, returning how many were new; the
+        // strings are hashed a run at a time, after which their groups are
+        // prefetched before any is probed, so the cache misses on the
+        // table overlap; the run is looked up under one shared lock, and
+        // only if it has new strings do we lock again to add them
+        auto intern_batch(std::string_view const *texts, std::size_t batch_count, id_t *out) -> std::size_t {
+            constexpr std::size_t run_size = 64;
+
+            std::uint32_t hashes[run_size];
+            std::size_t   added = 0;
+
+            for (std::size_t start = 0; start < batch_count; start += run_size) {
+                std::size_t run = std::min(run_size, batch_count - start);
+                for (std::size_t i = 0; i < run; ++i)
+                  hashes[i] = hash_string(texts[start + i]);
+
+                bool missed = false;
+                {
+                    std::shared_lock<mutex_t> lock(mutex);
+                  #if defined(__GNUC__)
+                    if (capacity != 0) {
+                        for (std::size_t i = 0; i < run; ++i)
+                          __builtin_prefetch(&ctrl[position_of(hashes[i])]);
+                    }
+                  #endif
+                    for (std::size_t i = 0; i < run; ++i) {
+                        out[start + i] = find_id(texts[start + i], hashes[i]);
+                        missed |= out[start + i] == npos;
+                    }
+                }
+                if (!missed)
+                  continue;
+
+                std::unique_lock<mutex_t> lock(mutex);
+                for (std::size_t i = 0; i < run; ++i) {
+                    if (out[start + i] != npos)
+                      continue;
+
+                    // An earlier string of this run (or another thread) may
+                    // have added it since we looked
+                    out[start + i] = find_id(texts[start + i], hashes[i]);
+                    if (out[start + i] == npos) {
+                        out[start + i] = insert(texts[start + i], hashes[i]);
+                        added         += out[start + i] != npos;
+                    }
+                }
+            }
+
+            return added;
+        }
+
+
+        // Make room for reserve_count strings before the table has to grow
+        void reserve(std::size_t reserve_count) {
+            std::unique_lock<mutex_t> lock(mutex);
+            if (reserve_count > max_load(capacity)) {
+                std::size_t new_capacity = min_capacity;
+                while (max_load(new_capacity) < reserve_count)
+                  new_capacity *= 2;
+                rehash(new_capacity);
+            }
+        }
+
+
+        // Forget every string; all ids and views are invalid after this
+        void clear() {
+            std::unique_lock<mutex_t> lock(mutex);
+            strings.clear();
+            if (capacity != 0)
+              std::memset(ctrl, group::ctrl_empty, capacity + group_width);
+            count        = 0;
+            string_bytes = 0;
+            growth_left  = max_load(capacity);
+        }
+
+      protected:
+        static auto load_word(char const *p) noexcept -> std::uint64_t {
+            std::uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            return word;
+        }
+
+
+        // The last few bytes, zero padded; the size is in the seed, so
+        // strings differing only in trailing zeroes do not collide
+        static auto load_tail(char const *p, std::size_t size) noexcept -> std::uint64_t {
+            std::uint64_t word = 0;
+            std::memcpy(&word, p, size);
+            return word;
+        }
+
+
+        static auto hash_string(std::string_view text) noexcept -> std::uint32_t {
+            char const  *p    = text.data();
+            std::size_t  size = text.size();
+
+            std::uint64_t low  = 0x243F6A8885A308D3ull ^ size;
+            std::uint64_t high = 0x13198A2E03707344ull;
+
+          #if defined(GAOS_INTERNER_CRC32)
+            for (; size >= 16; p += 16, size -= 16) {
+                low  = _mm_crc32_u64(low,  load_word(p));
+                high = _mm_crc32_u64(high, load_word(p + 8));
+            }
+            if (size >= 8) {
+                low   = _mm_crc32_u64(low, load_word(p));
+                p    += 8;
+                size -= 8;
+            }
+            if (size != 0)
+              high = _mm_crc32_u64(high, load_tail(p, size));
+          #else
+            constexpr std::uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+            for (; size >= 16; p += 16, size -= 16) {
+                low  = (low  ^ load_word(p))     * multiplier;
+                high = (high ^ load_word(p + 8)) * multiplier;
+                low ^= low >> 29;
+                high ^= high >> 29;
+            }
+            if (size >= 8) {
+                low   = (low ^ load_word(p)) * multiplier;
+                low  ^= low >> 29;
+                p    += 8;
+                size -= 8;
+            }
+            if (size != 0) {
+                high  = (high ^ load_tail(p, size)) * multiplier;
+                high ^= high >> 29;
+            }
+          #endif
+
+            // Mix the lanes so that both the position (the high bits) and
+            // the control byte (the low 7) depend on every byte
+            std::uint64_t hash = (low ^ (high << 32 | high >> 32)) * 0x9E3779B97F4A7C15ull;
+            return std::uint32_t(hash >> 32);
+        }
+
+
+        // We keep the table at most 7/8 full
+        static auto max_load(std::size_t table_capacity) noexcept -> std::size_t {
+            return table_capacity - table_capacity / 8;
+        }
+
+
+        // The control bytes, with the first group mirrored at the end as
+        // in flat_map, followed by the ids
+        static auto slots_offset(std::size_t table_capacity) noexcept -> std::size_t {
+            return (table_capacity + group_width + alignof(id_t) - 1) / alignof(id_t) * alignof(id_t);
+        }
+
+
+        static auto table_size(std::size_t table_capacity) noexcept -> std::size_t {
+            return slots_offset(table_capacity) + table_capacity * sizeof(id_t);
+        }
+
+
+        auto position_of(std::uint32_t hash) const noexcept -> std::size_t {
+            return (hash >> 7) & (capacity - 1);
+        }
+
+
+        static auto ctrl_of(std::uint32_t hash) noexcept -> std::uint8_t {
+            return std::uint8_t(group::ctrl_full | (hash & 0x7F));
+        }
+
+
+        void set_ctrl(std::size_t index, std::uint8_t value) noexcept {
+            ctrl[index] = value;
+            if (index < group_width)
+              ctrl[capacity + index] = value;
+        }
+
+
+        auto find_id(std::string_view text, std::uint32_t hash) const noexcept -> id_t {
+            if (capacity == 0)
+              return npos;
+
+            std::size_t  mask     = capacity - 1;
+            std::size_t  position = position_of(hash);
+            std::uint8_t h2       = ctrl_of(hash);
+
+            for (std::size_t step = group_width;; step += group_width) {
+                group g(&ctrl[position]);
+
+                for (auto match = g.match(h2); match != 0; match &= match - 1) {
+                    id_t          id    = slots[(position + group::lowest_bit(match)) & mask];
+                    entry const  &found = entries[id];
+                    if (   found.hash == hash && found.size == text.size()
+                        && (text.size() == 0 || std::memcmp(found.data, text.data(), text.size()) == 0))
+                      return id;
+                }
+
+                if (g.match_empty() != 0)
+                  return npos;
+
+                position = (position + step) & mask;
+            }
+        }
+
+
+        auto find_insert_index(std::uint32_t hash) const noexcept -> std::size_t {
+            std::size_t mask     = capacity - 1;
+            std::size_t position = position_of(hash);
+
+            for (std::size_t step = group_width;; step += group_width) {
+                auto match = group(&ctrl[position]).match_empty();
+                if (match != 0)
+                  return (position + group::lowest_bit(match)) & mask;
+
+                position = (position + step) & mask;
+            }
+        }
+
+
+        // Copy a new string into our blobs and give it the next id; we
+        // never erase, so there are no tombstones and the table only grows
+        auto insert(std::string_view text, std::uint32_t hash) -> id_t {
+            if (count >= npos || text.size() > ~std::uint32_t(0))
+              return npos;
+
+            if (growth_left == 0 && !rehash(capacity == 0 ? min_capacity : capacity * 2))
+              return npos;
+
+            if (count == entry_capacity && !grow_entries())
+              return npos;
+
+            char *data = (char*)strings.allocate(text.size() == 0 ? 1 : text.size());
+            if (data == nullptr)
+              return npos;
+            if (text.size() != 0)
+              std::memcpy(data, text.data(), text.size());
+
+            std::size_t index = find_insert_index(hash);
+            set_ctrl(index, ctrl_of(hash));
+            slots[index]   = (id_t)count;
+            entries[count] = { data, (std::uint32_t)text.size(), hash };
+
+            growth_left  -= 1;
+            string_bytes += text.size();
+            return (id_t)count++;
+        }
+
+
+        auto rehash(std::size_t new_capacity) -> bool {
+            std::byte *table = gaos::allocators::allocate_aligned(internal_allocator, table_size(new_capacity), alignof(id_t));
+            if (table == nullptr)
+              return false;
+
+            release_table();
+
+            ctrl        = (std::uint8_t*)table;
+            slots       = (id_t*)(table + slots_offset(new_capacity));
+            capacity    = new_capacity;
+            growth_left = max_load(new_capacity) - count;
+            std::memset(ctrl, group::ctrl_empty, new_capacity + group_width);
+
+            for (std::size_t id = 0; id < count; ++id) {
+                std::size_t index = find_insert_index(entries[id].hash);
+                set_ctrl(index, ctrl_of(entries[id].hash));
+                slots[index] = (id_t)id;
+            }
+            return true;
+        }
+
+
+        auto grow_entries() -> bool {
+            std::size_t new_capacity = std::max<std::size_t>(64, entry_capacity * 2);
+            entry      *grown        = (entry*)gaos::allocators::allocate_aligned(internal_allocator, new_capacity * sizeof(entry), alignof(entry));
+            if (grown == nullptr)
+              return false;
+
+            if (entry_capacity != 0) {
+                std::memcpy((void*)grown, entries, count * sizeof(entry));
+                internal_allocator.deallocate((std::byte*)entries, entry_capacity * sizeof(entry));
+            }
+            entries        = grown;
+            entry_capacity = new_capacity;
+            return true;
+        }
+
+
+        void release_table() noexcept {
+            if (capacity != 0)
+              internal_allocator.deallocate((std::byte*)ctrl, table_size(capacity));
+            ctrl     = nullptr;
+            slots    = nullptr;
+            capacity = 0;
+        }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,264 @@
+#pragma once
+
+#include "core/allocator_libc.h"
+#include "core/allocator_linear_pushpop.h"
+#include "core/allocator_ptr.h"
+#include "core/allocator_reuse.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+
+namespace gaos::coroutines {
+
+
+    // Coroutine frames are allocated when a coroutine starts and freed
+    // when it is destroyed, which for short-lived tasks is a lot of churn
+    // through the global heap; this pool hands out frames from a reuse
+    // list per size class, all backed by a linear_pushpop, so a frame
+    // freed by a finished coroutine is simply taken by the next one
+    // Frames larger than the largest class go to malloc
+    // There is one pool per thread (see local), so a frame should be
+    // destroyed on the thread which created it -- and coroutines cannot
+    // outlive the thread, as its pool takes all memory with it
+    template<std::size_t... class_sizes>
+    class frame_pool_t
+    {
+      public:
+      // -- Types
+
+        using this_t    = frame_pool_t<class_sizes...>;
+        using arena_t   = gaos::allocators::linear_pushpop<1 << 16, gaos::allocators::libc<std::byte>>;
+        using arena_ptr = gaos::allocators::ptr<std::byte, arena_t>;
+        using pools_t   = std::tuple<gaos::allocators::reuse<class_sizes, arena_ptr>...>;
+
+        static constexpr std::size_t class_count = sizeof...(class_sizes);
+        static constexpr std::size_t sizes[class_count] = { class_sizes... };
+
+      // -- Members
+
+        arena_t                             arena;
+        pools_t                             pools;
+        gaos::allocators::libc<std::byte>   large_allocator;
+
+      // -- Construction
+
+        // Every pool is built in place from a pointer to the arena, as a
+        // reuse cannot be copied or moved
+        frame_pool_t() noexcept
+        : pools((void(class_sizes), arena_ptr(&arena))...) {}
+
+        frame_pool_t(this_t const&) = delete;
+        auto operator=(this_t const&) -> this_t& = delete;
+
+
+        static auto local() noexcept -> this_t& {
+            thread_local this_t pool;
+            return pool;
+        }
+
+      // -- Warming up
+
+        // Put count frames on the list of every size class, carved from
+        // an arena reserved to hold them all
+        void prefill(std::size_t count, gaos::memory::residency mode = gaos::memory::residency::lazy) {
+            arena.reserve(count * (class_sizes + ...), mode);
+            std::apply([count](auto&... pool) { (pool.prefill(count), ...); }, pools);
+        }
+
+      // -- Allocation
+
+        template<std::size_t index = 0>
+        auto allocate(std::size_t alloc_size) noexcept -> void * {
+            if constexpr (index == class_count) {
+                return large_allocator.allocate(alloc_size);
+            }
+            else {
+                if (alloc_size <= sizes[index])
+                  return std::get<index>(pools).allocate(alloc_size);
+                return allocate<index + 1>(alloc_size);
+            }
+        }
+
+
+        template<std::size_t index = 0>
+        void deallocate(void *ptr, std::size_t alloc_size) noexcept {
+            if constexpr (index == class_count) {
+                large_allocator.deallocate((std::byte*)ptr, alloc_size);
+            }
+            else {
+                if (alloc_size <= sizes[index])
+                  return std::get<index>(pools).deallocate(ptr, alloc_size);
+                deallocate<index + 1>(ptr, alloc_size);
+            }
+        }
+    };
+
+    using frame_pool = frame_pool_t<128, 256, 512, 1024, 2048, 4096>;
+
+
+    // Mix into a promise type to have its coroutine frames come from
+    // (and go back to) the frame pool of the current thread
+    template<typename pool_t = frame_pool>
+    struct pooled_frame
+    {
+        // A coroutine only checks for a null frame when its promise has
+        // get_return_object_on_allocation_failure, so we throw instead,
+        // as the global operator new would
+        static auto operator new(std::size_t frame_size) -> void * {
+            void *frame = pool_t::local().allocate(frame_size);
+            if (frame == nullptr)
+              throw std::bad_alloc();
+            return frame;
+        }
+
+
+        static void operator delete(void *ptr, std::size_t frame_size) noexcept {
+            pool_t::local().deallocate(ptr, frame_size);
+        }
+    };
+
+
+    // Mix in nothing, so frames use the global operator new
+    struct global_frame {};
+
+
+    // Where a finished task keeps its result
+    template<typename T>
+    struct task_result {
+        std::optional<T> value;
+
+        template<typename U>
+        void return_value(U &&result) {
+            value.emplace(std::forward<U>(result));
+        }
+
+        auto take_result() -> T {
+            return std::move(*value);
+        }
+    };
+
+    template<>
+    struct task_result<void> {
+        void return_void() noexcept {}
+        void take_result() noexcept {}
+    };
+
+
+    // A lazily started task: it runs once it is awaited (or run), and
+    // when it finishes it continues straight into whoever awaited it
+    // The frame_t mixin decides where the coroutine frames come from
+    template<typename T = void, typename frame_t = pooled_frame<>>
+    class task
+    {
+      public:
+      // -- Types
+
+        struct promise_type;
+        using handle_t = std::coroutine_handle<promise_type>;
+
+        struct final_awaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            auto await_suspend(handle_t handle) noexcept -> std::coroutine_handle<> {
+                return handle.promise().continuation;
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        struct promise_type : frame_t, task_result<T> {
+            std::coroutine_handle<> continuation = std::noop_coroutine();
+
+            auto get_return_object() noexcept -> task {
+                return task(handle_t::from_promise(*this));
+            }
+
+            auto initial_suspend() noexcept -> std::suspend_always {
+                return {};
+            }
+
+            auto final_suspend() noexcept -> final_awaiter {
+                return {};
+            }
+
+            void unhandled_exception() noexcept {
+                std::terminate();
+            }
+        };
+
+        struct awaiter {
+            handle_t handle;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            auto await_suspend(std::coroutine_handle<> awaiting) noexcept -> std::coroutine_handle<> {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            auto await_resume() -> T {
+                return handle.promise().take_result();
+            }
+        };
+
+      // -- Members
+
+        handle_t handle;
+
+      // -- Construction
+
+        explicit task(handle_t handle) noexcept
+        : handle(handle) {}
+
+        task(task const&) = delete;
+        auto operator=(task const&) -> task& = delete;
+
+        task(task &&rh) noexcept
+        : handle(std::exchange(rh.handle, nullptr)) {}
+
+        auto operator=(task &&rh) noexcept -> task& {
+            if (this != &rh) {
+                if (handle)
+                  handle.destroy();
+                handle = std::exchange(rh.handle, nullptr);
+            }
+            return *this;
+        }
+
+        // Destroying the frame is what gives it back to the pool
+        ~task() noexcept {
+            if (handle)
+              handle.destroy();
+        }
+
+      // -- Running
+
+        bool valid() const noexcept {
+            return (bool)handle;
+        }
+
+
+        auto operator co_await() && noexcept -> awaiter {
+            return { handle };
+        }
+
+
+        // Run a top-level task until it finishes and return its result;
+        // this expects that nothing it awaits suspends it elsewhere
+        auto run() -> T {
+            handle.resume();
+            return handle.promise().take_result();
+        }
+    };
+
+}
\ No newline at end of file
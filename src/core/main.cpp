@@ -1,16 +1,62 @@
+#include "core/allocator_budgeted.h"
+#include "core/allocator_bulk.h"
+#include "core/allocator_deferred.h"
+#include "core/allocator_io_buffers.h"
+#include "core/allocator_large_object.h"
 #include "core/allocator_libc.h"
 #include "core/allocator_linear_pushpop.h"
+#include "core/allocator_locked.h"
+#include "core/allocator_passthrough.h"
+#include "core/allocator_per_cpu.h"
+#include "core/allocator_profiled.h"
 #include "core/allocator_ptr.h"
 #include "core/allocator_reuse.h"
+#include "core/allocator_ring.h"
+#include "core/allocator_scratch.h"
+#include "core/allocator_shared_arena.h"
 #include "core/allocator_stack.h"
+#include "core/allocator_typed.h"
+#include "core/container_arena_owned.h"
+#include "core/container_flat_map.h"
+#include "core/container_small_vector.h"
+#include "core/container_string_interner.h"
+#include "core/coroutine_task.h"
+#include "core/memory_budget.h"
+#include "core/memory_heap_map.h"
+#include "core/memory_ingest.h"
+#include "core/memory_page_map.h"
+#include "core/memory_reclaimer.h"
+#include "core/memory_trim.h"
 #include "core/tests.h"
 #include "version/git_version.h"
 
+#include <algorithm>
+#include <cctype>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <list>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/uio.h>
+  #include <sys/wait.h>
+  #include <unistd.h>
+#endif
+
 
 void main_speed_test()
 {
@@ -85,16 +131,9 @@ void main_speed_test()
         for (int i = 0; i < repeat_count; ++i) {
             gaos::memory::reset_meta_stats();
             
-            constexpr std::size_t node_size =
-            #ifdef _MSC_VER
-              24;
-            #else
-              sizeof(std::unordered_map<const int, int>::node_type);
-            #endif
-
-            using reuse = gaos::allocators::reuse<node_size, gaos::allocators::libc<std::byte>>;
-            reuse reuse_allocator;
-            alloc::ptr<int, reuse> alloc_int(&reuse_allocator);
+            using pools = alloc::pool_registry<alloc::libc<std::byte>>;
+            pools reuse_pools;
+            alloc::typed<int, pools> alloc_int(&reuse_pools);
 
             auto time_start = clock::now();
             gaos::tests::test_vector(alloc_int);
@@ -127,6 +166,113 @@ void main_speed_test()
         }
     }
     
+    std::cout
+      << "passthrough    "
+        <<                 std::setw(6) << (sum_time_passthrough / repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_passthrough << "x"
+        << " | peak   " << std::setw(6) << max_mem_passthrough << "B"
+        << std::endl
+      << "stack_buffer   "
+        <<                 std::setw(6) << (sum_time_stack_buffer / repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_stack_buffer << "x"
+        << " | peak   " << std::setw(6) << max_mem_stack_buffer << "B"
+        << std::endl
+      << "reuse          "
+        <<                 std::setw(6) << (sum_time_reuse / repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_reuse << "x"
+        << " | peak   " << std::setw(6) << max_mem_reuse << "B"
+        << std::endl
+      << "linear_pushpop "
+        <<                 std::setw(6) << (sum_time_linear_pushpop / repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_linear_pushpop << "x"
+        << " | peak   " << std::setw(6) << max_mem_linear_pushpop << "B"
+        << std::endl
+        << std::endl;
+
+    std::cout
+      << "running small vector experiment " << repeat_count << " times..." << std::endl << std::endl;
+
+    {
+        // passthrough
+
+        sum_time_passthrough = 0;
+
+        for (int i = 0; i < repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
+            
+            alloc::libc<std::byte> alloc_byte;
+
+            auto time_start = clock::now();
+            gaos::tests::test_small_vector(alloc_byte);
+            auto time_end   = clock::now();
+
+            sum_time_passthrough  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_passthrough  = gaos::memory::count_malloc;
+            max_mem_passthrough    = gaos::memory::size_malloc_peak;
+        }
+
+        // stack
+
+        sum_time_stack_buffer = 0;
+
+        for (int i = 0; i < repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
+            
+            using stack = gaos::allocators::stack<1 << 14, gaos::allocators::libc<std::byte>>;
+            stack stack_buf0;
+            alloc::ptr<std::byte, stack> alloc_byte(&stack_buf0);
+
+            auto time_start = clock::now();
+            gaos::tests::test_small_vector(alloc_byte);
+            auto time_end   = clock::now();
+
+            sum_time_stack_buffer  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_stack_buffer  = gaos::memory::count_malloc;
+            max_mem_stack_buffer    = gaos::memory::size_malloc_peak;
+        }
+
+        // reuse
+
+        sum_time_reuse = 0;
+
+        for (int i = 0; i < repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
+            
+            using pools = alloc::pool_registry<alloc::libc<std::byte>>;
+            pools reuse_pools;
+            alloc::typed<std::byte, pools> alloc_byte(&reuse_pools);
+
+            auto time_start = clock::now();
+            gaos::tests::test_small_vector(alloc_byte);
+            auto time_end   = clock::now();
+
+            sum_time_reuse  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_reuse  = gaos::memory::count_malloc;
+            max_mem_reuse    = gaos::memory::size_malloc_peak;
+        }
+
+        // linear_pushpop
+
+        sum_time_linear_pushpop = 0;
+
+        for (int i = 0; i < repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
+            
+            using linear_pushpop = gaos::allocators::linear_pushpop<1 << 14, gaos::allocators::libc<std::byte>>;
+
+            linear_pushpop pushpop;
+            alloc::ptr<std::byte, linear_pushpop> alloc_byte(&pushpop);
+
+            auto time_start = clock::now();
+            gaos::tests::test_small_vector(alloc_byte);
+            auto time_end   = clock::now();
+
+            sum_time_linear_pushpop  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_linear_pushpop  = gaos::memory::count_malloc;
+            max_mem_linear_pushpop    = gaos::memory::size_malloc_peak;
+        }
+    }
+    
     std::cout
       << "passthrough    "
         <<                 std::setw(6) << (sum_time_passthrough / repeat_count) << "us"
@@ -199,16 +345,9 @@ void main_speed_test()
         for (int i = 0; i < repeat_count; ++i) {
             gaos::memory::reset_meta_stats();
             
-            constexpr std::size_t node_size =
-            #ifdef _MSC_VER
-              24;
-            #else
-              sizeof(std::unordered_map<const int, int>::node_type);
-            #endif
-
-            using reuse = gaos::allocators::reuse<node_size, gaos::allocators::libc<std::byte>>;
-            reuse reuse_allocator;
-            alloc::ptr<std::pair<const int, int>, reuse> alloc_pair_int_int(&reuse_allocator);
+            using pools = alloc::pool_registry<alloc::libc<std::byte>>;
+            pools reuse_pools;
+            alloc::typed<std::pair<const int, int>, pools> alloc_pair_int_int(&reuse_pools);
 
             auto time_start = clock::now();
             gaos::tests::test_map(alloc_pair_int_int);
@@ -261,126 +400,444 @@ void main_speed_test()
         <<                 std::setw(6) << (sum_time_linear_pushpop / repeat_count) << "us"
         << " | malloc " << std::setw(6) << max_alloc_linear_pushpop << "x"
         << " | peak   " << std::setw(6) << max_mem_linear_pushpop << "B"
+        << std::endl
         << std::endl;
-}
-
-
-void main_long_log()
-{
-    namespace alloc   = gaos::allocators;
 
     std::cout
-      << "## " << std::endl
-      << "## passthrough" << std::endl
-      << "##" << std::endl;
+      << "running flat map experiment " << repeat_count << " times..." << std::endl << std::endl;
 
     {
-        gaos::memory::reset_meta_stats();
+        // passthrough
 
-        alloc::libc<int> alloc_int;
-        gaos::tests::test_vector(alloc_int);
+        sum_time_passthrough = 0;
 
-        gaos::memory::log_flush(true);
-    
-        alloc::libc<std::pair<const int, int>> alloc_pair_int_int;
-        gaos::tests::test_map(alloc_pair_int_int);
+        for (int i = 0; i < repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
+            
+            alloc::libc<std::byte> alloc_byte;
 
-        gaos::memory::log_flush(true);
+            auto time_start = clock::now();
+            gaos::tests::test_flat_map(alloc_byte);
+            auto time_end   = clock::now();
 
-        std::cout << std::endl << "---------" << std::endl;
-        gaos::memory::log_meta_stats();
+            sum_time_passthrough  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_passthrough  = gaos::memory::count_malloc;
+            max_mem_passthrough    = gaos::memory::size_malloc_peak;
+        }
 
-        std::cout << std::endl;
-    }
+        // stack
 
-    std::cout
-      << "## " << std::endl
-      << "## stack_buffer" << std::endl
-      << "##" << std::endl;
+        sum_time_stack_buffer = 0;
 
-    {
-        gaos::memory::reset_meta_stats();
+        for (int i = 0; i < repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
+            
+            using stack = gaos::allocators::stack<1 << 14, gaos::allocators::libc<std::byte>>;
+            stack stack_buf0;
+            alloc::ptr<std::byte, stack> alloc_byte(&stack_buf0);
 
-        using stack = gaos::allocators::stack<1024, gaos::allocators::libc<std::byte>>;
+            auto time_start = clock::now();
+            gaos::tests::test_flat_map(alloc_byte);
+            auto time_end   = clock::now();
 
-        stack stack_buf0, stack_buf1;
+            sum_time_stack_buffer  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_stack_buffer  = gaos::memory::count_malloc;
+            max_mem_stack_buffer    = gaos::memory::size_malloc_peak;
+        }
 
-        alloc::ptr<int, stack> alloc_int(&stack_buf0);
-        gaos::tests::test_vector(alloc_int);
+        // reuse
 
-        gaos::memory::log_flush(true);
-   
-        alloc::ptr<std::pair<const int, int>, stack> alloc_pair_int_int(&stack_buf1);
-        gaos::tests::test_map(alloc_pair_int_int);
+        sum_time_reuse = 0;
 
-        gaos::memory::log_flush(true);
-        
-        std::cout << std::endl << "---------" << std::endl;
-        gaos::memory::log_meta_stats();
+        for (int i = 0; i < repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
+            
+            using pools = alloc::pool_registry<alloc::libc<std::byte>>;
+            pools reuse_pools;
+            alloc::typed<std::byte, pools> alloc_byte(&reuse_pools);
 
-        std::cout << std::endl;
-    }
+            auto time_start = clock::now();
+            gaos::tests::test_flat_map(alloc_byte);
+            auto time_end   = clock::now();
 
-    std::cout
-      << "## " << std::endl
-      << "## reuse" << std::endl
-      << "##" << std::endl;
+            sum_time_reuse  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_reuse  = gaos::memory::count_malloc;
+            max_mem_reuse    = gaos::memory::size_malloc_peak;
+        }
 
-    {
-        {
-            gaos::memory::reset_meta_stats();
+        // linear_pushpop
 
-            constexpr std::size_t node_size =
-            #ifdef _MSC_VER
-              24;
-            #else
-              sizeof(std::unordered_map<const int, int>::node_type);
-            #endif
+        sum_time_linear_pushpop = 0;
+
+        for (int i = 0; i < repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
             
-            using reuse = gaos::allocators::reuse<node_size, gaos::allocators::libc<std::byte>>;
-            reuse reuse_allocator;
+            using linear_pushpop = gaos::allocators::linear_pushpop<1 << 14, gaos::allocators::libc<std::byte>>;
 
-            alloc::ptr<int, reuse> alloc_int(&reuse_allocator);
-            gaos::tests::test_vector(alloc_int);
+            linear_pushpop pushpop;
+            alloc::ptr<std::byte, linear_pushpop> alloc_byte(&pushpop);
 
-            gaos::memory::log_flush(true);
+            auto time_start = clock::now();
+            gaos::tests::test_flat_map(alloc_byte);
+            auto time_end   = clock::now();
 
-            alloc::ptr<std::pair<const int, int>, reuse> alloc_pair_int_int(&reuse_allocator);
-            gaos::tests::test_map(alloc_pair_int_int);
-            
-            gaos::memory::log_flush(true);
+            sum_time_linear_pushpop  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_linear_pushpop  = gaos::memory::count_malloc;
+            max_mem_linear_pushpop    = gaos::memory::size_malloc_peak;
         }
+    }
+    
+    std::cout
+      << "passthrough    "
+        <<                 std::setw(6) << (sum_time_passthrough / repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_passthrough << "x"
+        << " | peak   " << std::setw(6) << max_mem_passthrough << "B"
+        << std::endl
+      << "stack_buffer   "
+        <<                 std::setw(6) << (sum_time_stack_buffer / repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_stack_buffer << "x"
+        << " | peak   " << std::setw(6) << max_mem_stack_buffer << "B"
+        << std::endl
+      << "reuse          "
+        <<                 std::setw(6) << (sum_time_reuse / repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_reuse << "x"
+        << " | peak   " << std::setw(6) << max_mem_reuse << "B"
+        << std::endl
+      << "linear_pushpop "
+        <<                 std::setw(6) << (sum_time_linear_pushpop / repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_linear_pushpop << "x"
+        << " | peak   " << std::setw(6) << max_mem_linear_pushpop << "B"
+        << std::endl
+        << std::endl;
 
-        gaos::memory::log_flush(true);
-
-        std::cout << std::endl << "---------" << std::endl;
-        gaos::memory::log_meta_stats();
+    int grow_repeat_count = 10;
+    std::size_t grow_max_size = std::size_t(1) << 27;
 
-        std::cout << std::endl;
-    }
+    std::uint64_t sum_time_large_object  = 0;
+    std::uint64_t max_alloc_large_object = 0;
+    std::uint64_t max_mem_large_object   = 0;
 
     std::cout
-      << "## " << std::endl
-      << "## linear_pushpop" << std::endl
-      << "##" << std::endl;
+      << "running grow experiment " << grow_repeat_count << " times..." << std::endl << std::endl;
 
     {
-        {
+        // passthrough
+
+        sum_time_passthrough = 0;
+
+        for (int i = 0; i < grow_repeat_count; ++i) {
             gaos::memory::reset_meta_stats();
+            
+            alloc::libc<std::byte> alloc_byte;
 
-            using linear_pushpop = gaos::allocators::linear_pushpop<1 << 16, gaos::allocators::libc<std::byte>>;
-            linear_pushpop pushpop;
+            auto time_start = clock::now();
+            gaos::tests::test_grow_buffer(alloc_byte, grow_max_size);
+            auto time_end   = clock::now();
 
-            {
-                auto scoped_pushpop = pushpop.get_scoped_pushpop();
+            sum_time_passthrough  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_passthrough  = gaos::memory::count_malloc;
+            max_mem_passthrough    = gaos::memory::size_malloc_peak;
+        }
 
-                alloc::ptr<int, linear_pushpop> alloc_int(&pushpop);
-                gaos::tests::test_vector(alloc_int);
+        // large_object
 
-                gaos::memory::log_flush(true);
-            }
+        sum_time_large_object = 0;
+
+        for (int i = 0; i < grow_repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
             
-            gaos::memory::log_flush(true);
+            using large_object = gaos::allocators::large_object<1 << 20, gaos::allocators::libc<std::byte>>;
+            large_object alloc_byte;
+
+            auto time_start = clock::now();
+            gaos::tests::test_grow_buffer(alloc_byte, grow_max_size);
+            auto time_end   = clock::now();
+
+            sum_time_large_object  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_large_object  = gaos::memory::count_malloc;
+            max_mem_large_object    = gaos::memory::size_malloc_peak;
+        }
+    }
+    
+    std::cout
+      << "passthrough    "
+        <<                 std::setw(6) << (sum_time_passthrough / grow_repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_passthrough << "x"
+        << " | peak   " << std::setw(6) << max_mem_passthrough << "B"
+        << std::endl
+      << "large_object   "
+        <<                 std::setw(6) << (sum_time_large_object / grow_repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_large_object << "x"
+        << " | peak   " << std::setw(6) << max_mem_large_object << "B"
+        << std::endl
+        << std::endl;
+
+    std::size_t sparse_size = std::size_t(1) << 27;
+
+    std::uint64_t sum_time_memset  = 0
+                , sum_time_calloc  = 0;
+    std::uint64_t max_alloc_memset = 0
+                , max_alloc_calloc = 0;
+    std::uint64_t max_mem_memset   = 0
+                , max_mem_calloc   = 0;
+
+    std::cout
+      << "running sparse table experiment " << grow_repeat_count << " times..." << std::endl << std::endl;
+
+    {
+        // memset
+
+        sum_time_memset = 0;
+
+        for (int i = 0; i < grow_repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
+            
+            alloc::libc<std::byte> alloc_byte;
+
+            auto time_start = clock::now();
+            gaos::tests::test_sparse_table(alloc_byte, sparse_size, false);
+            auto time_end   = clock::now();
+
+            sum_time_memset  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_memset  = gaos::memory::count_malloc;
+            max_mem_memset    = gaos::memory::size_malloc_peak;
+        }
+
+        // calloc
+
+        sum_time_calloc = 0;
+
+        for (int i = 0; i < grow_repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
+            
+            alloc::libc<std::byte> alloc_byte;
+
+            auto time_start = clock::now();
+            gaos::tests::test_sparse_table(alloc_byte, sparse_size, true);
+            auto time_end   = clock::now();
+
+            sum_time_calloc  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_calloc  = gaos::memory::count_malloc;
+            max_mem_calloc    = gaos::memory::size_malloc_peak;
+        }
+
+        // large_object
+
+        sum_time_large_object = 0;
+
+        for (int i = 0; i < grow_repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
+            
+            using large_object = gaos::allocators::large_object<1 << 20, gaos::allocators::libc<std::byte>>;
+            large_object alloc_byte;
+
+            auto time_start = clock::now();
+            gaos::tests::test_sparse_table(alloc_byte, sparse_size, true);
+            auto time_end   = clock::now();
+
+            sum_time_large_object  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_large_object  = gaos::memory::count_malloc;
+            max_mem_large_object    = gaos::memory::size_malloc_peak;
+        }
+
+        // linear_pushpop
+
+        sum_time_linear_pushpop = 0;
+
+        for (int i = 0; i < grow_repeat_count; ++i) {
+            gaos::memory::reset_meta_stats();
+            
+            using large_object   = gaos::allocators::large_object<1 << 20, gaos::allocators::libc<std::byte>>;
+            using linear_pushpop = gaos::allocators::linear_pushpop<1 << 14, large_object>;
+
+            linear_pushpop pushpop;
+
+            auto time_start = clock::now();
+            gaos::tests::test_sparse_table(pushpop, sparse_size, true);
+            auto time_end   = clock::now();
+
+            sum_time_linear_pushpop  += std::chrono::duration_cast<us>(time_end - time_start).count();
+            max_alloc_linear_pushpop  = gaos::memory::count_malloc;
+            max_mem_linear_pushpop    = gaos::memory::size_malloc_peak;
+        }
+    }
+    
+    std::cout
+      << "memset         "
+        <<                 std::setw(6) << (sum_time_memset / grow_repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_memset << "x"
+        << " | peak   " << std::setw(6) << max_mem_memset << "B"
+        << std::endl
+      << "calloc         "
+        <<                 std::setw(6) << (sum_time_calloc / grow_repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_calloc << "x"
+        << " | peak   " << std::setw(6) << max_mem_calloc << "B"
+        << std::endl
+      << "large_object   "
+        <<                 std::setw(6) << (sum_time_large_object / grow_repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_large_object << "x"
+        << " | peak   " << std::setw(6) << max_mem_large_object << "B"
+        << std::endl
+      << "linear_pushpop "
+        <<                 std::setw(6) << (sum_time_linear_pushpop / grow_repeat_count) << "us"
+        << " | malloc " << std::setw(6) << max_alloc_linear_pushpop << "x"
+        << " | peak   " << std::setw(6) << max_mem_linear_pushpop << "B"
+        << std::endl
+        << std::endl;
+
+    int coroutine_repeat_count = 100;
+    int coroutine_depth        = 14;
+
+    std::uint64_t sum_time_global_frame = 0
+                , sum_time_pooled_frame = 0;
+    std::size_t   frame_count           = 0;
+
+    std::cout
+      << "running coroutine experiment " << coroutine_repeat_count << " times..." << std::endl << std::endl;
+
+    {
+        // global operator new
+
+        for (int i = 0; i < coroutine_repeat_count; ++i) {
+            auto time_start = clock::now();
+            frame_count = gaos::tests::test_coroutines<gaos::coroutines::global_frame>(coroutine_depth);
+            auto time_end   = clock::now();
+
+            sum_time_global_frame += std::chrono::duration_cast<us>(time_end - time_start).count();
+        }
+
+        // frame pool
+
+        for (int i = 0; i < coroutine_repeat_count; ++i) {
+            auto time_start = clock::now();
+            frame_count = gaos::tests::test_coroutines<gaos::coroutines::pooled_frame<>>(coroutine_depth);
+            auto time_end   = clock::now();
+
+            sum_time_pooled_frame += std::chrono::duration_cast<us>(time_end - time_start).count();
+        }
+    }
+
+    std::cout
+      << "global new     "
+        <<                 std::setw(6) << (sum_time_global_frame / coroutine_repeat_count) << "us"
+        << " | frames " << std::setw(6) << frame_count << "x"
+        << std::endl
+      << "frame pool     "
+        <<                 std::setw(6) << (sum_time_pooled_frame / coroutine_repeat_count) << "us"
+        << " | frames " << std::setw(6) << frame_count << "x"
+        << std::endl;
+}
+
+
+void main_long_log()
+{
+    namespace alloc   = gaos::allocators;
+
+    std::cout
+      << "## " << std::endl
+      << "## passthrough" << std::endl
+      << "##" << std::endl;
+
+    {
+        gaos::memory::reset_meta_stats();
+
+        alloc::libc<int> alloc_int;
+        gaos::tests::test_vector(alloc_int);
+
+        gaos::memory::log_flush(true);
+    
+        alloc::libc<std::pair<const int, int>> alloc_pair_int_int;
+        gaos::tests::test_map(alloc_pair_int_int);
+
+        gaos::memory::log_flush(true);
+
+        std::cout << std::endl << "---------" << std::endl;
+        gaos::memory::log_meta_stats();
+
+        std::cout << std::endl;
+    }
+
+    std::cout
+      << "## " << std::endl
+      << "## stack_buffer" << std::endl
+      << "##" << std::endl;
+
+    {
+        gaos::memory::reset_meta_stats();
+
+        using stack = gaos::allocators::stack<1024, gaos::allocators::libc<std::byte>>;
+
+        stack stack_buf0, stack_buf1;
+
+        alloc::ptr<int, stack> alloc_int(&stack_buf0);
+        gaos::tests::test_vector(alloc_int);
+
+        gaos::memory::log_flush(true);
+   
+        alloc::ptr<std::pair<const int, int>, stack> alloc_pair_int_int(&stack_buf1);
+        gaos::tests::test_map(alloc_pair_int_int);
+
+        gaos::memory::log_flush(true);
+        
+        std::cout << std::endl << "---------" << std::endl;
+        gaos::memory::log_meta_stats();
+
+        std::cout << std::endl;
+    }
+
+    std::cout
+      << "## " << std::endl
+      << "## reuse" << std::endl
+      << "##" << std::endl;
+
+    {
+        {
+            gaos::memory::reset_meta_stats();
+
+            using pools = alloc::pool_registry<alloc::libc<std::byte>>;
+            pools reuse_pools;
+
+            alloc::typed<int, pools> alloc_int(&reuse_pools);
+            gaos::tests::test_vector(alloc_int);
+
+            gaos::memory::log_flush(true);
+
+            alloc::typed<std::pair<const int, int>, pools> alloc_pair_int_int(&reuse_pools);
+            gaos::tests::test_map(alloc_pair_int_int);
+            
+            gaos::memory::log_flush(true);
+        }
+
+        gaos::memory::log_flush(true);
+
+        std::cout << std::endl << "---------" << std::endl;
+        gaos::memory::log_meta_stats();
+
+        std::cout << std::endl;
+    }
+
+    std::cout
+      << "## " << std::endl
+      << "## linear_pushpop" << std::endl
+      << "##" << std::endl;
+
+    {
+        {
+            gaos::memory::reset_meta_stats();
+
+            using linear_pushpop = gaos::allocators::linear_pushpop<1 << 16, gaos::allocators::libc<std::byte>>;
+            linear_pushpop pushpop;
+
+            {
+                auto scoped_pushpop = pushpop.get_scoped_pushpop();
+
+                alloc::ptr<int, linear_pushpop> alloc_int(&pushpop);
+                gaos::tests::test_vector(alloc_int);
+
+                gaos::memory::log_flush(true);
+            }
+            
+            gaos::memory::log_flush(true);
 
             {
                 auto scoped_pushpop = pushpop.get_scoped_pushpop();
@@ -402,7 +859,1853 @@ void main_long_log()
 }
 
 
-int main()
+// Run the map test through a sampling heap profiler, to see both what
+// the profiler costs and what it reports; the profiles are written as
+// heap.prof and heap_peak.prof, which pprof can read
+void main_heap_profile()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using profiled = alloc::profiled<alloc::libc<std::byte>>;
+
+    int repeat_count = 1000;
+
+    std::uint64_t sum_time_plain    = 0
+                , sum_time_profiled = 0;
+
+    // The tables are large, so the profiler does not live on the stack
+    static gaos::memory::heap_profiler profiler(1 << 12);
+
+    std::cout
+      << "running map experiment with heap profiler " << repeat_count << " times..." << std::endl << std::endl;
+
+    for (int i = 0; i < repeat_count; ++i) {
+        alloc::libc<std::pair<const int, int>> alloc_pair_int_int;
+
+        auto time_start = clock::now();
+        gaos::tests::test_map(alloc_pair_int_int);
+        auto time_end   = clock::now();
+
+        sum_time_plain += std::chrono::duration_cast<us>(time_end - time_start).count();
+    }
+
+    for (int i = 0; i < repeat_count; ++i) {
+        profiled profiled_allocator(&profiler);
+        alloc::ptr<std::pair<const int, int>, profiled> alloc_pair_int_int(&profiled_allocator);
+
+        auto time_start = clock::now();
+        gaos::tests::test_map(alloc_pair_int_int);
+        auto time_end   = clock::now();
+
+        sum_time_profiled += std::chrono::duration_cast<us>(time_end - time_start).count();
+    }
+
+    profiler.write_profile("heap.prof");
+    profiler.write_profile("heap_peak.prof", true);
+
+    std::cout
+      << "unprofiled     "
+        <<                 std::setw(6) << (sum_time_plain / repeat_count) << "us"
+        << std::endl
+      << "profiled       "
+        <<                 std::setw(6) << (sum_time_profiled / repeat_count) << "us"
+        << " | sites  " << std::setw(6) << profiler.site_count
+        << " | peak   " << std::setw(6) << profiler.peak_bytes << "B sampled"
+        << std::endl;
+}
+
+
+// Build a map and a vector in a shared region, then have forked processes
+// map the region again (at another address) and read both in place,
+// while they also allocate from the region themselves
+void main_shared_arena()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using shared_map    = gaos::containers::flat_map<int, int, alloc::shared<std::byte>>;
+    using shared_vector = std::vector<int, alloc::shared<int>>;
+
+    int element_count = 1 << 16;
+    int process_count = 4;
+
+    alloc::shared_arena arena(std::size_t(1) << 30);
+    if (!arena.valid()) {
+        std::cout << "could not create a shared arena" << std::endl;
+        return;
+    }
+
+  #if defined(__unix__) || defined(__APPLE__)
+    std::cout
+      << "running shared arena experiment with " << process_count << " processes..." << std::endl << std::endl;
+
+    auto time_start = clock::now();
+
+    shared_map    *map    = arena.region->construct<shared_map>("map", alloc::shared<std::byte>(arena));
+    shared_vector *vector = arena.region->construct<shared_vector>("vector", alloc::shared<int>(arena));
+    for (int i = 0; i < element_count; ++i) {
+        (*map)[i] = i * 3;
+        vector->push_back(i);
+    }
+
+    auto time_built = clock::now();
+
+    std::uint64_t bytes_built = arena.region->bytes_in_use;
+
+    for (int p = 0; p < process_count; ++p) {
+        if (fork() != 0)
+          continue;
+
+        // A fresh mapping of the same region, so nothing lines up with
+        // the addresses the parent used
+        alloc::shared_arena view(alloc::shared_arena::from_fd{ arena.fd });
+        if (!view.valid())
+          _exit(2);
+
+        shared_map    *view_map    = view.region->find<shared_map>("map");
+        shared_vector *view_vector = view.region->find<shared_vector>("vector");
+        if (view_map == nullptr || view_vector == nullptr || (void*)view_map == (void*)map)
+          _exit(3);
+
+        bool ok = view_map->size() == (std::size_t)element_count && view_vector->size() == (std::size_t)element_count;
+        for (int i = 0; ok && i < element_count; ++i) {
+            auto found = view_map->find((*view_vector)[i]);
+            ok = found != view_map->end() && found->second == i * 3;
+        }
+
+        // Allocate alongside the other processes
+        std::byte *blocks[64];
+        for (int round = 0; ok && round < 1000; ++round) {
+            for (int b = 0; b < 64; ++b)
+              blocks[b] = view.allocate(16 + b * 8);
+            for (int b = 0; b < 64; ++b)
+              view.deallocate(blocks[b], 16 + b * 8);
+        }
+
+        _exit(ok ? 0 : 1);
+    }
+
+    int failed_count = 0;
+    for (int p = 0; p < process_count; ++p) {
+        int status = 0;
+        wait(&status);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+          ++failed_count;
+    }
+
+    auto time_read = clock::now();
+
+    std::uint64_t bytes_after = arena.region->bytes_in_use;
+
+    arena.region->destroy<shared_map>("map");
+    arena.region->destroy<shared_vector>("vector");
+
+    std::cout
+      << "build          "
+        <<                 std::setw(6) << std::chrono::duration_cast<us>(time_built - time_start).count() << "us"
+        << " | in use " << std::setw(6) << bytes_built << "B"
+        << std::endl
+      << "read in place  "
+        <<                 std::setw(6) << std::chrono::duration_cast<us>(time_read - time_built).count() << "us"
+        << " | in use " << std::setw(6) << bytes_after << "B"
+        << " | failed " << std::setw(6) << failed_count
+        << std::endl
+      << "destroyed      "
+        << "        "
+        << " | in use " << std::setw(6) << arena.region->bytes_in_use << "B"
+        << std::endl;
+  #endif
+}
+
+#if defined(__linux__)
+// How much of the mapping at address has been copied on write, from the
+// Anonymous line of its entry in /proc/self/smaps
+auto copied_bytes(void const *address) -> std::size_t
+{
+    std::FILE *file = std::fopen("/proc/self/smaps", "r");
+    if (file == nullptr)
+      return 0;
+
+    char          line[256];
+    bool          found  = false;
+    unsigned long copied = 0;
+    while (std::fgets(line, sizeof(line), file) != nullptr) {
+        unsigned long begin, end;
+        if (std::sscanf(line, "%lx-%lx ", &begin, &end) == 2)
+          found = begin == (unsigned long)address;
+        else if (found && std::sscanf(line, "Anonymous: %lu kB", &copied) == 1)
+          break;
+    }
+
+    std::fclose(file);
+    return (std::size_t)copied << 10;
+}
+#endif
+
+
+// Build a map in a shared arena, and then work on it speculatively: once
+// on a deep copy, once on an O(1) fork which only copies the pages it
+// changes; the fork is then saved, loaded again and checked
+void main_snapshot()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using shared_map = gaos::containers::flat_map<int, int, alloc::shared<std::byte>>;
+
+    int entry_count  = 1 << 22;
+    int change_every = 1000;
+
+    alloc::shared_arena arena(std::size_t(1) << 30);
+    if (!arena.valid()) {
+        std::cout << "could not create a shared arena" << std::endl;
+        return;
+    }
+
+  #if defined(__linux__)
+    std::cout
+      << "running snapshot experiment with " << entry_count << " entries..." << std::endl << std::endl;
+
+    shared_map *map = arena.region->construct<shared_map>("map", alloc::shared<std::byte>(arena));
+    for (int i = 0; i < entry_count; ++i)
+      (*map)[i] = i;
+
+    std::size_t state_size = arena.region->top;
+
+    // Change every so many entries of a map, wherever it is mapped
+    auto speculate = [&](shared_map &what_if) {
+        for (int i = 0; i < entry_count; i += change_every)
+          what_if[i] = -i;
+    };
+
+    auto check = [&](shared_map &checked, bool changed) {
+        bool ok = checked.size() == (std::size_t)entry_count;
+        for (int i = 0; ok && i < entry_count; ++i)
+          ok = checked.find(i)->second == ((changed && i % change_every == 0) ? -i : i);
+        return ok;
+    };
+
+    // A deep copy of the state, made and dropped the usual way
+    auto time_copy_start = clock::now();
+    std::byte *copy = (std::byte*)std::malloc(state_size);
+    std::memcpy(copy, arena.region, state_size);
+    auto time_copy_end   = clock::now();
+    std::free(copy);
+
+    // The same as a fork
+    std::optional<alloc::shared_arena> fork;
+
+    auto time_fork_start = clock::now();
+    fork.emplace(alloc::shared_arena::fork_of{ arena });
+    auto time_fork_end   = clock::now();
+
+    shared_map *fork_map = fork->region->find<shared_map>("map");
+    speculate(*fork_map);
+
+    std::size_t copied = copied_bytes(fork->region);
+    bool fork_ok     = check(*fork_map, true);
+    bool original_ok = check(*map, false);
+
+    // Save what the fork sees and load it back
+    char path[64];
+    std::snprintf(path, sizeof(path), "/tmp/gaos_snapshot_%d", (int)getpid());
+
+    auto time_save_start = clock::now();
+    bool saved = fork->save(path);
+    auto time_save_end   = clock::now();
+
+    alloc::shared_arena loaded(alloc::shared_arena::from_file{ path });
+    std::remove(path);
+    bool loaded_ok = saved && loaded.valid() && check(*loaded.region->find<shared_map>("map"), true);
+
+    auto time_drop_start = clock::now();
+    fork.reset();
+    auto time_drop_end   = clock::now();
+
+    arena.region->destroy<shared_map>("map");
+
+    std::cout
+      << "state          " << std::setw(10) << state_size << "B" << std::endl
+      << "deep copy      " << std::setw(10) << std::chrono::duration_cast<us>(time_copy_end - time_copy_start).count() << "us" << std::endl
+      << "fork           " << std::setw(10) << std::chrono::duration_cast<us>(time_fork_end - time_fork_start).count() << "us"
+        << " | changing 1 in " << change_every << " entries copied " << copied << "B" << std::endl
+      << "drop fork      " << std::setw(10) << std::chrono::duration_cast<us>(time_drop_end - time_drop_start).count() << "us" << std::endl
+      << "save fork      " << std::setw(10) << std::chrono::duration_cast<us>(time_save_end - time_save_start).count() << "us" << std::endl
+      << "checks         " << (fork_ok ? "fork ok" : "fork FAILED")
+        << " | " << (original_ok ? "original ok" : "original FAILED")
+        << " | " << (loaded_ok ? "loaded ok" : "loaded FAILED") << std::endl;
+  #endif
+}
+
+
+// Keep the first field of every line of a text, as views into where
+// they are; returns how many lines there were
+auto first_fields(std::string_view text, std::vector<std::string_view> &fields) -> std::size_t
+{
+    std::size_t line_count = 0;
+    for (std::size_t start = 0; start < text.size(); ++line_count) {
+        std::size_t end = std::min(text.find('\n', start), text.size());
+        std::string_view line = text.substr(start, end - start);
+        fields.push_back(line.substr(0, line.find(',')));
+        start = end + 1;
+    }
+    return line_count;
+}
+
+
+// Load a file the way loaders usually do -- read into a malloc buffer,
+// copy what we keep into an arena -- and ingested straight into the
+// arena, buffered and with O_DIRECT; then stream it through a pool of
+// aligned I/O buffers, two at a time with preadv
+void main_ingest()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using arena_t = alloc::linear_pushpop<1 << 20, alloc::libc<std::byte>>;
+
+  #if defined(__unix__) || defined(__APPLE__)
+    char path[64];
+    std::snprintf(path, sizeof(path), "/tmp/gaos_ingest_%d", (int)getpid());
+
+    std::FILE *file = std::fopen(path, "wb");
+    if (file == nullptr) {
+        std::cout << "could not write " << path << std::endl;
+        return;
+    }
+    for (int line = 0; line < 1 << 19; ++line)
+      std::fprintf(file, "record_%d,%d,%d,field_value_%d\n", line, line * 7, line % 1000, line * 13);
+    std::fclose(file);
+
+    std::cout
+      << "running ingest experiment..." << std::endl << std::endl;
+
+    std::vector<std::string_view> fields;
+    std::size_t                   copied = 0;
+
+    // Read into a buffer, copy the fields we keep into the arena
+    arena_t copy_arena;
+    auto    time_copy_start = clock::now();
+    {
+        int         fd     = open(path, O_RDONLY | O_CLOEXEC);
+        off_t       size   = lseek(fd, 0, SEEK_END);
+        char       *buffer = (char*)std::malloc((std::size_t)size);
+        std::size_t done   = 0;
+        for (ssize_t got; done < (std::size_t)size && (got = pread(fd, buffer + done, (std::size_t)size - done, (off_t)done)) > 0;)
+          done += (std::size_t)got;
+        close(fd);
+
+        std::vector<std::string_view> in_buffer;
+        first_fields(std::string_view(buffer, done), in_buffer);
+        for (std::string_view field : in_buffer) {
+            char *kept = (char*)copy_arena.allocate(field.size());
+            std::memcpy(kept, field.data(), field.size());
+            fields.emplace_back(kept, field.size());
+            copied += field.size();
+        }
+        std::free(buffer);
+    }
+    auto time_copy_end = clock::now();
+
+    std::size_t copied_count = fields.size();
+
+    auto ingest = [&](gaos::memory::ingest_mode mode) {
+        arena_t arena;
+        fields.clear();
+
+        auto time_start = clock::now();
+        std::string_view text = gaos::memory::ingest_file(arena, path, mode);
+        first_fields(text, fields);
+        auto time_end   = clock::now();
+
+        bool same = fields.size() == copied_count && fields.back() == "record_" + std::to_string(copied_count - 1);
+        return std::make_pair(std::chrono::duration_cast<us>(time_end - time_start).count(), same);
+    };
+
+    auto buffered = ingest(gaos::memory::ingest_mode::buffered);
+    auto direct   = ingest(gaos::memory::ingest_mode::direct);
+
+    // Stream the file in chunks through pooled buffers; after the first
+    // pass every buffer comes from the pool
+    constexpr std::size_t chunk_size = 1 << 19;
+
+    alloc::io_buffers<> buffers;
+    std::size_t         line_count = 0;
+    auto time_stream_start = clock::now();
+    for (int pass = 0; pass < 4; ++pass) {
+        int   fd     = open(path, O_RDONLY | O_CLOEXEC);
+        off_t offset = 0;
+        for (;;) {
+            std::byte *first  = buffers.allocate(chunk_size);
+            std::byte *second = buffers.allocate(chunk_size);
+
+            iovec   chunks[2] = { { first, chunk_size }, { second, chunk_size } };
+            ssize_t got       = preadv(fd, chunks, 2, offset);
+            if (got > 0) {
+                std::size_t in_first = std::min((std::size_t)got, chunk_size);
+                line_count += (std::size_t)std::count((char*)first,  (char*)first  + in_first, '\n');
+                line_count += (std::size_t)std::count((char*)second, (char*)second + ((std::size_t)got - in_first), '\n');
+                offset     += got;
+            }
+
+            buffers.deallocate(second, chunk_size);
+            buffers.deallocate(first,  chunk_size);
+            if (got <= 0)
+              break;
+        }
+        close(fd);
+    }
+    auto time_stream_end = clock::now();
+
+    std::remove(path);
+
+    std::cout
+      << "malloc + copy  " << std::setw(8) << std::chrono::duration_cast<us>(time_copy_end - time_copy_start).count() << "us"
+        << " | copied " << copied << "B out of the read buffer" << std::endl
+      << "ingest         " << std::setw(8) << buffered.first << "us"
+        << " | copied 0B, " << (buffered.second ? "fields match" : "fields DIFFER") << std::endl
+      << "ingest direct  " << std::setw(8) << direct.first << "us"
+        << " | copied 0B, " << (direct.second ? "fields match" : "fields DIFFER") << std::endl
+      << "io buffers     " << std::setw(8) << std::chrono::duration_cast<us>(time_stream_end - time_stream_start).count() / 4 << "us per pass"
+        << " | " << line_count / 4 << " lines, " << buffers.hit_count << " buffers from the pool, " << buffers.miss_count << " mapped" << std::endl;
+  #endif
+}
+
+
+// Fill a linear_pushpop (backed by large_object, so its blobs are their
+// own mappings) and a reuse list, let go of it all, and then have a trim
+// thread pass on simulated pressure to both
+void main_trim()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using large_object   = alloc::large_object<1 << 20, alloc::libc<std::byte>>;
+    using linear_pushpop = alloc::linear_pushpop<1 << 20, large_object>;
+    using reuse          = alloc::reuse<64, alloc::libc<std::byte>>;
+
+    std::cout
+      << "running trim experiment..." << std::endl << std::endl;
+
+    linear_pushpop pushpop;
+    reuse          reuse_allocator;
+
+    gaos::memory::trim_registry          &registry = gaos::memory::trim_registry::global();
+    gaos::memory::trim_registry::handle   pushpop_handle = registry.add();
+    gaos::memory::trim_registry::handle   reuse_handle   = registry.add();
+
+    std::size_t resident_start = gaos::memory::resident_bytes();
+
+    {
+        auto scoped_pushpop = pushpop.get_scoped_pushpop();
+        for (int i = 0; i < 256; ++i)
+          std::memset(pushpop.allocate(1 << 19), 1, 1 << 19);
+    }
+
+    {
+        std::vector<void*> nodes(1 << 20);
+        for (auto &node : nodes)
+          std::memset(node = reuse_allocator.allocate(64), 1, 64);
+        for (auto node : nodes)
+          reuse_allocator.deallocate(node, 64);
+    }
+
+    std::size_t resident_cached = gaos::memory::resident_bytes();
+
+    gaos::memory::simulated_pressure pressure;
+    std::size_t released = 0;
+    {
+        gaos::memory::trim_thread<gaos::memory::simulated_pressure> trimmer(pressure, registry, std::chrono::milliseconds(1));
+        pressure.request(std::size_t(1) << 30);
+
+        // The owners poll where it suits them; here, until both were asked
+        while (released == 0 || pushpop_handle.pending() || reuse_handle.pending()) {
+            released += pushpop_handle.poll(pushpop);
+            released += reuse_handle.poll(reuse_allocator);
+            std::this_thread::yield();
+        }
+    }
+
+    std::size_t resident_trimmed = gaos::memory::resident_bytes();
+
+    std::cout
+      << "start          " << std::setw(10) << resident_start   << "B resident" << std::endl
+      << "cached         " << std::setw(10) << resident_cached  << "B resident" << std::endl
+      << "trimmed        " << std::setw(10) << resident_trimmed << "B resident"
+        << " | released " << released << "B"
+        << std::endl;
+}
+
+
+// Run the map test once on a cold linear_pushpop, and once on one which
+// reserved (and faulted in) what the cold run got from its backing
+// allocator -- with backing allocations forbidden, to check the warm
+// run never falls through to malloc; then the same for coroutine frames
+void main_warm_start()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using large_object   = alloc::large_object<1 << 16, alloc::libc<std::byte>>;
+    using linear_pushpop = alloc::linear_pushpop<1 << 16, large_object>;
+
+    std::cout
+      << "running warm start experiment..." << std::endl << std::endl;
+
+    std::uint64_t time_cold = 0, time_warm = 0;
+    std::size_t   cold_backing_bytes = 0, cold_malloc_count = 0, warm_violations = 0;
+
+    {
+        linear_pushpop pushpop;
+        alloc::ptr<std::pair<const int, int>, linear_pushpop> alloc_pair_int_int(&pushpop);
+
+        gaos::memory::reset_meta_stats();
+
+        auto time_start = clock::now();
+        gaos::tests::test_map(alloc_pair_int_int);
+        auto time_end   = clock::now();
+
+        time_cold          = std::chrono::duration_cast<us>(time_end - time_start).count();
+        cold_backing_bytes = gaos::memory::size_malloc_peak;
+        cold_malloc_count  = gaos::memory::count_malloc;
+    }
+
+    {
+        linear_pushpop pushpop;
+        pushpop.reserve(cold_backing_bytes, gaos::memory::residency::populate);
+        alloc::ptr<std::pair<const int, int>, linear_pushpop> alloc_pair_int_int(&pushpop);
+
+        gaos::memory::forbid_malloc forbid(false);
+
+        auto time_start = clock::now();
+        gaos::tests::test_map(alloc_pair_int_int);
+        auto time_end   = clock::now();
+
+        time_warm       = std::chrono::duration_cast<us>(time_end - time_start).count();
+        warm_violations = forbid.violations();
+    }
+
+    std::size_t coroutine_violations = 0;
+    {
+        gaos::coroutines::frame_pool::local().prefill(16);
+
+        gaos::memory::forbid_malloc forbid(false);
+        gaos::tests::test_coroutines<gaos::coroutines::pooled_frame<>>(14);
+        coroutine_violations = forbid.violations();
+    }
+
+    std::cout
+      << "cold map       "
+        <<                 std::setw(6) << time_cold << "us"
+        << " | malloc " << std::setw(6) << cold_malloc_count << "x"
+        << " | peak   " << std::setw(6) << cold_backing_bytes << "B"
+        << std::endl
+      << "warm map       "
+        <<                 std::setw(6) << time_warm << "us"
+        << " | forbidden mallocs " << warm_violations
+        << std::endl
+      << "warm coroutines"
+        << " forbidden mallocs " << coroutine_violations
+        << std::endl;
+}
+
+
+// Fill a large request-scoped map on a linear_pushpop, then time its
+// teardown: destroying it visits every node just to deallocate into the
+// arena, while giving it up through arena_owned costs nothing -- in both
+// cases the scoped pushpop is what actually frees the memory
+void main_teardown()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using large_object   = alloc::large_object<1 << 20, alloc::libc<std::byte>>;
+    using linear_pushpop = alloc::linear_pushpop<1 << 20, large_object>;
+    using alloc_pair_t   = alloc::ptr<std::pair<const int, int>, linear_pushpop>;
+    using map_t          = std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, alloc_pair_t>;
+
+    static_assert(gaos::containers::can_abandon_v<map_t>);
+
+    int entry_count = 1 << 21;
+
+    linear_pushpop pushpop;
+    alloc_pair_t   alloc_pair_int_int(&pushpop);
+
+    std::cout
+      << "running teardown experiment with " << entry_count << " entries..." << std::endl << std::endl;
+
+    std::uint64_t time_destroy = 0, time_abandon = 0;
+
+    {
+        [[maybe_unused]] auto scope_pushpop = pushpop.get_scoped_pushpop();
+
+        std::optional<map_t> map(std::in_place, alloc_pair_int_int);
+        for (int i = 0; i < entry_count; ++i)
+          (*map)[i] = i;
+
+        auto time_start = clock::now();
+        map.reset();
+        auto time_end   = clock::now();
+
+        time_destroy = std::chrono::duration_cast<us>(time_end - time_start).count();
+    }
+
+    {
+        [[maybe_unused]] auto scope_pushpop = pushpop.get_scoped_pushpop();
+
+        std::optional<gaos::containers::arena_owned<map_t>> map(std::in_place, alloc_pair_int_int);
+        for (int i = 0; i < entry_count; ++i)
+          (**map)[i] = i;
+
+        auto time_start = clock::now();
+        map.reset();
+        auto time_end   = clock::now();
+
+        time_abandon = std::chrono::duration_cast<us>(time_end - time_start).count();
+    }
+
+    std::cout
+      << "destroy        " << std::setw(8) << time_destroy << "us" << std::endl
+      << "arena_owned    " << std::setw(8) << time_abandon << "us" << std::endl;
+}
+
+
+using scratch_arena = gaos::allocators::thread_scratch::arena_t;
+
+template<typename T>
+using scratch_vector = std::vector<T, gaos::allocators::ptr<T, scratch_arena>>;
+using scratch_string = std::basic_string<char, std::char_traits<char>, gaos::allocators::ptr<char, scratch_arena>>;
+
+
+// A field without spaces and in lower case, copied into out; it is
+// built in scratch memory first
+auto normalise(std::string_view field, scratch_arena *out) -> std::string_view
+{
+    auto temp = gaos::allocators::scratch(out);
+
+    scratch_string built(temp.allocator<char>());
+    for (char c : field) {
+        if (c != ' ')
+          built += (char)std::tolower((unsigned char)c);
+    }
+
+    char *copy = (char*)out->allocate(built.size());
+    std::memcpy(copy, built.data(), built.size());
+    return std::string_view(copy, built.size());
+}
+
+
+// The normalised fields of a line, in out; the fields are split off
+// into scratch memory first
+auto split_fields(std::string_view line, scratch_arena *out) -> scratch_vector<std::string_view>
+{
+    auto temp = gaos::allocators::scratch(out);
+
+    scratch_vector<std::string_view> pieces(temp.allocator<std::string_view>());
+    for (std::size_t start = 0; start <= line.size();) {
+        std::size_t end = std::min(line.find(',', start), line.size());
+        pieces.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+
+    scratch_vector<std::string_view> fields{ gaos::allocators::ptr<std::string_view, scratch_arena>(out) };
+    fields.reserve(pieces.size());
+    for (std::string_view piece : pieces)
+      fields.push_back(normalise(piece, out));
+    return fields;
+}
+
+
+// How many fields of the text are distinct, in out; all lines are
+// split into scratch memory first
+auto count_distinct(std::string_view text, scratch_arena *out) -> std::size_t *
+{
+    auto temp = gaos::allocators::scratch(out);
+
+    scratch_vector<std::string_view> all(temp.allocator<std::string_view>());
+    for (std::size_t start = 0; start < text.size();) {
+        std::size_t end = std::min(text.find('\n', start), text.size());
+        for (std::string_view field : split_fields(text.substr(start, end - start), temp.arena))
+          all.push_back(field);
+        start = end + 1;
+    }
+
+    std::sort(all.begin(), all.end());
+
+    std::size_t *count = (std::size_t*)out->allocate(sizeof(std::size_t));
+    *count = (std::size_t)(std::unique(all.begin(), all.end()) - all.begin());
+    return count;
+}
+
+
+// The same on the global heap, to compare with
+auto count_distinct_heap(std::string_view text) -> std::size_t
+{
+    std::vector<std::string> all;
+    for (std::size_t start = 0; start < text.size();) {
+        std::size_t end = std::min(text.find('\n', start), text.size());
+        std::string_view line = text.substr(start, end - start);
+
+        std::vector<std::string_view> pieces;
+        for (std::size_t field_start = 0; field_start <= line.size();) {
+            std::size_t field_end = std::min(line.find(',', field_start), line.size());
+            pieces.push_back(line.substr(field_start, field_end - field_start));
+            field_start = field_end + 1;
+        }
+
+        for (std::string_view piece : pieces) {
+            std::string built;
+            for (char c : piece) {
+                if (c != ' ')
+                  built += (char)std::tolower((unsigned char)c);
+            }
+            all.push_back(std::move(built));
+        }
+        start = end + 1;
+    }
+
+    std::sort(all.begin(), all.end());
+    return (std::size_t)(std::unique(all.begin(), all.end()) - all.begin());
+}
+
+
+// How many blobs an arena holds, which stays one as long as its
+// pushes and pops keep it from growing
+auto blob_count(scratch_arena const &arena) -> std::size_t
+{
+    std::size_t count = 1;
+    for (auto *blob = arena.current_stack_data.blob; blob->previous != nullptr; blob = blob->previous)
+      ++count;
+    for (auto *blob = arena.current_stack_data.blob; blob->next != nullptr; blob = blob->next)
+      ++count;
+    return count;
+}
+
+
+// Functions which return their result in an arena of their caller and
+// take their temporaries from the other scratch arena, three levels deep,
+// against the same on the global heap
+void main_scratch()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    constexpr int repeat_count = 100;
+
+    std::cout
+      << "running scratch experiment..." << std::endl << std::endl;
+
+    std::string   text;
+    std::uint64_t state = 0x9e3779b97f4a7c15;
+    for (int line = 0; line < 200; ++line) {
+        for (int field = 0; field < 8; ++field) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            text += (state >> 60) % 2 ? " Value " : "VALUE";
+            text += std::to_string((state >> 33) % 500);
+            text += (field == 7) ? '\n' : ',';
+        }
+    }
+
+    alloc::thread_scratch &scratch = alloc::thread_scratch::local();
+
+    std::size_t distinct_scratch = 0, distinct_heap = 0;
+
+    auto time_start = clock::now();
+    for (int repeat = 0; repeat < repeat_count; ++repeat) {
+        auto result = alloc::scratch();
+        distinct_scratch = *count_distinct(text, result.arena);
+    }
+    auto time_mid   = clock::now();
+    for (int repeat = 0; repeat < repeat_count; ++repeat)
+      distinct_heap = count_distinct_heap(text);
+    auto time_end   = clock::now();
+
+    std::cout
+      << "distinct fields " << distinct_scratch << " in scratch, " << distinct_heap << " on the heap" << std::endl
+      << "scratch        " << std::setw(8) << std::chrono::duration_cast<us>(time_mid - time_start).count() / repeat_count << "us" << std::endl
+      << "heap           " << std::setw(8) << std::chrono::duration_cast<us>(time_end - time_mid).count() / repeat_count << "us" << std::endl
+      << "scratch blobs  " << std::setw(8) << blob_count(scratch.arenas[0]) << " + " << blob_count(scratch.arenas[1]) << std::endl;
+}
+
+
+// Serve requests which each build a map and then tear it down, timing
+// just the teardown, as seen by the request; prints the median, the p99
+// and the worst of them
+template<typename map_t, typename teardown_t>
+void time_teardowns(char const *name, map_t const &prototype, teardown_t teardown)
+{
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    constexpr int request_count = 200;
+    constexpr int entry_count   = 1 << 14;
+
+    std::vector<std::int64_t> times;
+    for (int request = 0; request < request_count; ++request) {
+        map_t map(prototype);
+        for (int i = 0; i < entry_count; ++i)
+          map[i] = i;
+
+        auto time_start = clock::now();
+        teardown(map);
+        auto time_end   = clock::now();
+
+        times.push_back(std::chrono::duration_cast<us>(time_end - time_start).count());
+    }
+
+    std::sort(times.begin(), times.end());
+    std::cout
+      << name
+        << " p50 " << std::setw(6) << times[times.size() / 2] << "us"
+        << " | p99 " << std::setw(6) << times[times.size() * 99 / 100] << "us"
+        << " | max " << std::setw(6) << times.back() << "us" << std::endl;
+}
+
+
+// Tear down maps on the request thread, through a deferred allocator
+// and by handing them to the reclaimer whole; then clear a long reuse
+// list, and overrun a reclaimer with a short queue
+void main_reclaimer()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using libc          = alloc::libc<std::byte>;
+    using deferred      = alloc::deferred<libc>;
+    using map_t         = std::unordered_map<int, int>;
+    using deferred_pair = alloc::ptr<std::pair<const int, int>, deferred>;
+    using deferred_map  = std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, deferred_pair>;
+
+    std::cout
+      << "running reclaimer experiment..." << std::endl << std::endl;
+
+    gaos::memory::reclaimer later;
+    deferred                deferred_frees(&later);
+
+    time_teardowns("destroy       ", map_t(), [](map_t &map) {
+        map_t dropped(std::move(map));
+    });
+    time_teardowns("deferred      ", deferred_map(deferred_pair(&deferred_frees)), [](deferred_map &map) {
+        deferred_map dropped(std::move(map));
+    });
+    deferred_frees.flush();
+    later.drain();
+    time_teardowns("defer_destroy ", map_t(), [&](map_t &map) {
+        later.defer_destroy(std::move(map));
+    });
+    later.drain();
+
+    constexpr std::size_t node_count = 1 << 18;
+
+    alloc::reuse<64, libc> list;
+    list.prefill(node_count);
+    auto time_start = clock::now();
+    list.clear();
+    auto time_mid   = clock::now();
+    list.prefill(node_count);
+    auto time_deferred = clock::now();
+    list.clear(later);
+    auto time_end   = clock::now();
+
+    later.drain();
+
+    std::cout
+      << std::endl
+      << "reuse clear of " << node_count << " nodes" << std::endl
+      << "  clear()      " << std::setw(8) << std::chrono::duration_cast<us>(time_mid - time_start).count() << "us" << std::endl
+      << "  clear(later) " << std::setw(8) << std::chrono::duration_cast<us>(time_end - time_deferred).count() << "us" << std::endl
+      << "  inline       " << std::setw(8) << later.inline_count.load() << " jobs of " << later.submitted.load() + later.inline_count.load() << " run inline" << std::endl;
+
+    // More teardowns at once than the queue takes: the rest run inline
+    gaos::memory::reclaimer short_queue(4);
+    for (int i = 0; i < 64; ++i) {
+        map_t map;
+        for (int entry = 0; entry < 1024; ++entry)
+          map[entry] = entry;
+        short_queue.defer_destroy(std::move(map));
+    }
+    short_queue.drain();
+
+    std::cout
+      << std::endl
+      << "back-pressure  " << std::setw(8) << short_queue.inline_count.load() << " of 64 teardowns ran inline, queue of 4" << std::endl;
+}
+
+
+// Hand out memory from a page mapped linear_pushpop, stack buffer and
+// batched reuse, and some from malloc, then find the owner of every pointer from
+// the page map and give them all back through routed_free, without sizes
+void main_page_map()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using ns    = std::chrono::nanoseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using libc  = alloc::libc<std::byte>;
+    using reuse = alloc::reuse<64, libc, alloc::reuse_policy<false, 0, 64, true>>;
+
+    constexpr int pointer_count = 1000;
+
+    std::cout
+      << "running page map experiment..." << std::endl << std::endl;
+
+    gaos::memory::page_map &map = gaos::memory::page_map::global();
+
+    alloc::linear_pushpop<1 << 16, libc, true> pushpop;
+    alloc::stack<1 << 14, libc, true>          stack;
+    reuse                                      reuse_allocator;
+
+    struct owned {
+        void *ptr;
+        void *owner;
+    };
+    std::vector<owned> pointers;
+    for (int i = 0; i < pointer_count; ++i) {
+        pointers.push_back({ pushpop.allocate(48),          &pushpop });
+        pointers.push_back({ stack.allocate(8),             &stack });
+        pointers.push_back({ reuse_allocator.allocate(64),  &reuse_allocator });
+        pointers.push_back({ std::malloc(32),               nullptr });
+    }
+
+    int wrong_count = 0;
+    for (owned const &o : pointers) {
+        if (map.owner_of(o.ptr) != o.owner)
+          ++wrong_count;
+        if (o.owner == &reuse_allocator && map.size_of(o.ptr) != 64)
+          ++wrong_count;
+    }
+
+    constexpr int repeat_count = 100;
+    std::size_t   owned_count  = 0;
+
+    auto time_start = clock::now();
+    for (int repeat = 0; repeat < repeat_count; ++repeat) {
+        for (owned const &o : pointers)
+          owned_count += map.owns(o.ptr);
+    }
+    auto time_end   = clock::now();
+
+    std::size_t free_before = reuse_allocator.free_count;
+    for (owned const &o : pointers)
+      gaos::memory::routed_free(o.ptr);
+
+    std::cout
+      << "owners wrong   " << std::setw(8) << wrong_count << std::endl
+      << "owns()         " << std::setw(8) << std::chrono::duration_cast<ns>(time_end - time_start).count() / (std::int64_t)(repeat_count * pointers.size()) << "ns"
+        << " | owned " << owned_count / repeat_count << " of " << pointers.size() << std::endl
+      << "routed_free    " << std::setw(8) << reuse_allocator.free_count - free_before << " back on the reuse list" << std::endl;
+}
+
+// Stream messages of mixed sizes through an allocator, keeping a window
+// of them alive and freeing mostly the oldest, now and then the one after
+// it first; returns the time per message, or -1 when one was corrupted
+template<typename allocator_t>
+auto stream_messages(allocator_t &allocator, int message_count) -> std::int64_t
+{
+    using ns    = std::chrono::nanoseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    constexpr std::size_t window_size = 256;
+
+    struct message {
+        std::uint32_t *words;
+        std::size_t    size;
+    };
+
+    std::mt19937         random(7);
+    std::vector<message> window;
+    bool                 ok = true;
+
+    auto retire = [&](std::size_t index) {
+        message m = window[index];
+        if (m.words[0] != (std::uint32_t)m.size || m.words[m.size / 4 - 1] != (std::uint32_t)m.size)
+          ok = false;
+        allocator.deallocate((std::byte*)m.words, m.size);
+        window.erase(window.begin() + index);
+    };
+
+    auto time_start = clock::now();
+    for (int i = 0; i < message_count; ++i) {
+        std::size_t size  = std::size_t(64) << (random() % 6);
+        auto        words = (std::uint32_t*)allocator.allocate(size);
+        if (words == nullptr)
+          return -1;
+
+        words[0] = words[size / 4 - 1] = (std::uint32_t)size;
+        window.push_back({ words, size });
+
+        if (window.size() == window_size)
+          retire((random() % 8 == 0) ? 1 : 0);
+    }
+    while (!window.empty())
+      retire(0);
+    auto time_end   = clock::now();
+
+    return ok ? std::chrono::duration_cast<ns>(time_end - time_start).count() / message_count : -1;
+}
+
+
+// A network thread allocating messages and a worker freeing them, handing
+// them over through a small lock-free queue; the network thread waits
+// while the allocator is full. Returns the time per message, or -1 when
+// one arrived corrupted
+template<typename allocator_t>
+auto hand_over_messages(allocator_t &allocator, int message_count) -> std::int64_t
+{
+    using ns    = std::chrono::nanoseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    constexpr std::size_t queue_size = 1024;
+
+    struct message {
+        std::uint32_t *words;
+        std::size_t    size;
+    };
+
+    message                  queue[queue_size];
+    std::atomic<std::size_t> pushed { 0 };
+    std::atomic<std::size_t> popped { 0 };
+    std::atomic<bool>        ok     { true };
+
+    auto network = [&]() {
+        for (int i = 0; i < message_count; ++i) {
+            std::size_t    size  = std::size_t(64) << (i % 6);
+            std::uint32_t *words;
+            while ((words = (std::uint32_t*)allocator.allocate(size)) == nullptr)
+              std::this_thread::yield();
+
+            words[0] = words[size / 4 - 1] = (std::uint32_t)i;
+
+            std::size_t at = pushed.load(std::memory_order_relaxed);
+            while (at - popped.load(std::memory_order_acquire) == queue_size)
+              std::this_thread::yield();
+            queue[at % queue_size] = { words, size };
+            pushed.store(at + 1, std::memory_order_release);
+        }
+    };
+
+    auto worker = [&]() {
+        for (int i = 0; i < message_count; ++i) {
+            std::size_t at = popped.load(std::memory_order_relaxed);
+            while (pushed.load(std::memory_order_acquire) == at)
+              std::this_thread::yield();
+            message m = queue[at % queue_size];
+            popped.store(at + 1, std::memory_order_release);
+
+            if (m.words[0] != (std::uint32_t)i || m.words[m.size / 4 - 1] != (std::uint32_t)i)
+              ok = false;
+            allocator.deallocate((std::byte*)m.words, m.size);
+        }
+    };
+
+    auto time_start = clock::now();
+    std::thread network_thread(network);
+    std::thread worker_thread(worker);
+    network_thread.join();
+    worker_thread.join();
+    auto time_end   = clock::now();
+
+    return ok ? std::chrono::duration_cast<ns>(time_end - time_start).count() / message_count : -1;
+}
+
+
+// Messages which are freed in about the order they arrived, on libc and
+// on rings: fixed, growable from a single page, and shared between a
+// network thread and a worker
+void main_ring()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using libc = alloc::libc<std::byte>;
+
+    constexpr int message_count = 1 << 20;
+
+    std::cout
+      << "running ring experiment..." << std::endl << std::endl;
+
+    libc        base;
+    alloc::ring fixed(1 << 20);
+    alloc::ring growable(1, true);
+    alloc::ring shared(1 << 16);
+
+    if (!fixed.valid() || !growable.valid() || !shared.valid()) {
+        std::cout
+          << "could not map a ring region" << std::endl;
+        return;
+    }
+
+    std::cout
+      << "stream, one thread" << std::endl
+      << "  libc           " << std::setw(6) << stream_messages(base,     message_count) << "ns per message" << std::endl
+      << "  ring fixed     " << std::setw(6) << stream_messages(fixed,    message_count) << "ns per message" << std::endl
+      << "  ring growable  " << std::setw(6) << stream_messages(growable, message_count) << "ns per message"
+        << " | grew to " << growable.current->capacity << "B" << std::endl;
+
+    std::cout
+      << std::endl
+      << "network thread to worker" << std::endl
+      << "  libc           " << std::setw(6) << hand_over_messages(base,   message_count) << "ns per message" << std::endl
+      << "  ring fixed     " << std::setw(6) << hand_over_messages(shared, message_count) << "ns per message" << std::endl;
+}
+
+// Have thread_count threads allocate and free blocks of mixed sizes at
+// the same time, checking no block is handed to two threads at once;
+// returns the time per allocation, or -1 when a check failed
+template<typename allocator_t>
+auto churn_threads(allocator_t &allocator, int thread_count) -> std::int64_t
+{
+    using ns    = std::chrono::nanoseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    constexpr int block_count = 256;
+    constexpr int round_count = 500;
+
+    std::atomic<bool> ok { true };
+
+    auto run = [&](int thread) {
+        std::byte   *blocks[block_count];
+        std::size_t  sizes[block_count];
+        for (int round = 0; round < round_count; ++round) {
+            for (int b = 0; b < block_count; ++b) {
+                sizes[b]  = std::size_t(16) << ((b + round) % 7);
+                blocks[b] = allocator.allocate(sizes[b]);
+                blocks[b][0] = blocks[b][sizes[b] - 1] = std::byte(thread);
+            }
+            for (int b = 0; b < block_count; ++b) {
+                if (blocks[b][0] != std::byte(thread) || blocks[b][sizes[b] - 1] != std::byte(thread))
+                  ok = false;
+                allocator.deallocate(blocks[b], sizes[b]);
+            }
+        }
+    };
+
+    auto time_start = clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t)
+      threads.emplace_back(run, t);
+    for (auto &thread : threads)
+      thread.join();
+    auto time_end   = clock::now();
+
+    std::int64_t operation_count = (std::int64_t)thread_count * block_count * round_count;
+    return ok ? std::chrono::duration_cast<ns>(time_end - time_start).count() / operation_count : -1;
+}
+
+
+// Many threads on one allocator: libc, a single reuse list behind a
+// lock, and the per-CPU caches, with and without restartable sequences
+void main_per_cpu()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using libc    = alloc::libc<std::byte>;
+    using per_cpu = alloc::per_cpu<libc>;
+    using locked  = alloc::locked<alloc::reuse<1024, libc>>;
+
+    std::cout
+      << "running per cpu experiment, rseq " << (per_cpu::rseq_available() ? "available" : "not available") << "..." << std::endl;
+
+    for (int thread_count : { 1, 8, 64 }) {
+        libc    base;
+        locked  shared_reuse;
+        per_cpu cached_rseq;
+        per_cpu cached_locked({}, false);
+
+        std::cout
+          << std::endl
+          << thread_count << " threads" << std::endl
+          << "  libc           " << std::setw(6) << churn_threads(base,          thread_count) << "ns per allocation" << std::endl
+          << "  locked reuse   " << std::setw(6) << churn_threads(shared_reuse,  thread_count) << "ns per allocation" << std::endl
+          << "  per_cpu rseq   " << std::setw(6) << churn_threads(cached_rseq,   thread_count) << "ns per allocation" << std::endl
+          << "  per_cpu locked " << std::setw(6) << churn_threads(cached_locked, thread_count) << "ns per allocation" << std::endl;
+    }
+
+    per_cpu cached;
+    std::cout
+      << std::endl
+      << "per_cpu caches at most " << cached.max_cached_bytes() << "B over " << cached.cpu_count << " cpus, however many threads" << std::endl;
+}
+
+// Leave a few allocators in the state a workload leaves them in -- an
+// arena full of erased map nodes and a perfect-fit blob, reuse lists
+// after random frees with and without sorting, a stack buffer and the
+// caches of per_cpu -- and write their snapshots to a heap map for the
+// heap_analyzer tool
+void main_heap_map(int argc, char **argv)
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using libc      = alloc::libc<std::byte>;
+    using pushpop_t = alloc::linear_pushpop<1 << 14, libc>;
+    using pair_t    = std::pair<const int, int>;
+    using map_t     = std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, alloc::ptr<pair_t, pushpop_t>>;
+
+    char const *path = (argc > 2) ? argv[2] : "heap_map.bin";
+
+    std::cout
+      << "running heap map experiment..." << std::endl << std::endl;
+
+    gaos::memory::heap_map map;
+
+    // The map erases half its entries, and rehashes as it grows
+    pushpop_t pushpop;
+    {
+        map_t erased{ alloc::ptr<pair_t, pushpop_t>(&pushpop) };
+        for (int i = 0; i < 20000; ++i)
+          erased[i] = i;
+        for (int i = 0; i < 20000; i += 2)
+          erased.erase(i);
+        pushpop.allocate(1 << 16);
+
+        pushpop.snapshot(map, "linear_pushpop, map with half erased");
+    }
+
+    // Random frees scatter a list; sorting puts it back in order
+    auto churn = [](auto &list) {
+        std::vector<void*> nodes;
+        for (int i = 0; i < 1 << 14; ++i)
+          nodes.push_back(list.allocate(64));
+        std::shuffle(nodes.begin(), nodes.end(), std::mt19937(3));
+        for (void *node : nodes)
+          list.deallocate(node, 64);
+    };
+
+    alloc::reuse<64, libc>                       lifo;
+    alloc::reuse<64, libc, alloc::reuse_sorted>  sorted;
+    alloc::reuse<64, libc, alloc::reuse_batched> batched;
+    churn(lifo);
+    churn(sorted);
+    churn(batched);
+    void *kept = batched.allocate(64);
+
+    lifo.snapshot(map, "reuse lifo, after random frees");
+    sorted.snapshot(map, "reuse sorted, after random frees");
+    batched.snapshot(map, "reuse batched, after random frees");
+    batched.deallocate(kept, 64);
+
+    alloc::stack<1 << 14, libc> stack;
+    {
+        std::vector<int, alloc::ptr<int, alloc::stack<1 << 14, libc>>> grown{ alloc::ptr<int, alloc::stack<1 << 14, libc>>(&stack) };
+        for (int i = 0; i < 1000; ++i)
+          grown.push_back(i);
+    }
+    stack.snapshot(map, "stack, after a growing vector");
+
+    alloc::per_cpu<libc> cached;
+    churn_threads(cached, 4);
+    cached.snapshot(map, "per_cpu, after four threads");
+
+    if (!map.write(path)) {
+        std::cout << "could not write " << path << std::endl;
+        return;
+    }
+
+    std::cout
+      << "wrote " << map.allocators.size() << " allocators to " << path << "; see heap_analyzer " << path << std::endl;
+}
+
+
+// One tenant with two requests, each request with its own arena; the
+// first request runs away and is stopped by its own hard limit, the
+// second by the tenant's, and going past the tenant's soft limit asks
+// the arenas to trim -- then the cost of the check on small allocations
+void main_budgets()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    using ns    = std::chrono::nanoseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using budgeted       = alloc::budgeted<alloc::libc<std::byte>>;
+    using linear_pushpop = alloc::linear_pushpop<1 << 20, alloc::ptr<std::byte, budgeted>>;
+
+    constexpr std::size_t mb = 1 << 20;
+
+    std::cout
+      << "running budget experiment..." << std::endl << std::endl;
+
+    gaos::memory::trim_registry registry;
+
+    gaos::memory::budget tenant(48 * mb, 32 * mb);
+    tenant.trim_target   = &registry;
+    tenant.on_soft_limit = [](gaos::memory::budget&, std::size_t used, void*) {
+        std::cout << "  tenant over its soft limit at " << used / mb << "MB, asking to trim" << std::endl;
+    };
+
+    gaos::memory::budget request_a(32 * mb, gaos::memory::budget::unlimited, &tenant);
+    gaos::memory::budget request_b(32 * mb, gaos::memory::budget::unlimited, &tenant);
+
+    budgeted budgeted_a(&request_a);
+    budgeted budgeted_b(&request_b);
+
+    linear_pushpop arena_a{ alloc::ptr<std::byte, budgeted>(&budgeted_a) };
+    linear_pushpop arena_b{ alloc::ptr<std::byte, budgeted>(&budgeted_b) };
+
+    gaos::memory::trim_registry::handle handle_a = registry.add();
+    gaos::memory::trim_registry::handle handle_b = registry.add();
+
+    // Allocate until refused, returning how much we got
+    auto run_away = [](linear_pushpop &arena) -> std::size_t {
+        std::size_t got = 0;
+        while (arena.allocate(64 << 10) != nullptr)
+          got += 64 << 10;
+        return got;
+    };
+
+    {
+        [[maybe_unused]] auto scope_pushpop_a = arena_a.get_scoped_pushpop();
+        std::size_t got_a = run_away(arena_a);
+
+        [[maybe_unused]] auto scope_pushpop_b = arena_b.get_scoped_pushpop();
+        std::size_t got_b = run_away(arena_b);
+
+        std::cout
+          << "  request a got " << std::setw(4) << got_a / mb << "MB"
+            << " | refused " << request_a.refused_count << "x" << std::endl
+          << "  request b got " << std::setw(4) << got_b / mb << "MB"
+            << " | refused " << request_b.refused_count << "x"
+            << " | tenant refused " << tenant.refused_count << "x" << std::endl;
+    }
+
+    // The scopes are popped, so what the arenas hold past their first blob
+    // is cached, and trimming gives it back to the budgets
+    std::size_t released = handle_a.poll(arena_a) + handle_b.poll(arena_b);
+    budgeted_a.flush();
+    budgeted_b.flush();
+
+    std::cout
+      << "  trimmed " << released / mb << "MB"
+        << " | tenant now uses " << tenant.used / mb << "MB"
+        << " | peak " << tenant.peak / mb << "MB" << std::endl << std::endl;
+
+    // The cost of the check, against the same allocations without it
+    constexpr int         operation_count = 1 << 22;
+    constexpr std::size_t node_size       = 64;
+
+    std::vector<void*> nodes(1024);
+    auto churn = [&](auto &allocator) -> std::int64_t {
+        auto time_start = clock::now();
+        for (int i = 0; i < operation_count; i += (int)nodes.size()) {
+            for (auto &node : nodes)
+              node = allocator.allocate(node_size);
+            for (auto node : nodes)
+              allocator.deallocate((std::byte*)node, node_size);
+        }
+        auto time_end   = clock::now();
+        return std::chrono::duration_cast<ns>(time_end - time_start).count() / operation_count;
+    };
+
+    alloc::libc<std::byte> libc;
+    std::int64_t time_libc     = churn(libc);
+    std::int64_t time_budgeted = churn(budgeted_a);
+
+    std::cout
+      << "libc           " << std::setw(6) << time_libc     << "ns per allocation" << std::endl
+      << "budgeted libc  " << std::setw(6) << time_budgeted << "ns per allocation" << std::endl;
+}
+
+// Run a list through a fill, a churn in random order and a refill, for
+// each reuse policy, then time iterating what the refill built -- with
+// a plain LIFO list, the refilled nodes come back in shuffled order
+template<typename policy_t>
+void run_reuse_policy(char const *policy_name, int entry_count)
+{
+    namespace alloc = gaos::allocators;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using reuse_t = alloc::reuse<32, alloc::libc<std::byte>, policy_t>;
+    using list_t  = std::list<int, alloc::ptr<int, reuse_t>>;
+
+    reuse_t reuse;
+    list_t  list{ alloc::ptr<int, reuse_t>(&reuse) };
+
+    auto time_fill_start = clock::now();
+    for (int i = 0; i < entry_count; ++i)
+      list.push_back(i);
+    auto time_fill_end   = clock::now();
+
+    std::vector<typename list_t::iterator> order;
+    order.reserve(entry_count);
+    for (auto it = list.begin(); it != list.end(); ++it)
+      order.push_back(it);
+    std::shuffle(order.begin(), order.end(), std::mt19937(entry_count));
+
+    auto time_churn_start = clock::now();
+    for (auto it : order)
+      list.erase(it);
+    for (int i = 0; i < entry_count; ++i)
+      list.push_back(i);
+    auto time_churn_end   = clock::now();
+
+    std::int64_t sum = 0;
+    auto time_iterate_start = clock::now();
+    for (int repeat = 0; repeat < 10; ++repeat) {
+        for (int value : list)
+          sum += value;
+    }
+    auto time_iterate_end   = clock::now();
+
+    std::cout
+      << std::left << std::setw(16) << policy_name << std::right
+      << " | fill "    << std::setw(8) << std::chrono::duration_cast<us>(time_fill_end - time_fill_start).count() << "us"
+      << " | churn "   << std::setw(8) << std::chrono::duration_cast<us>(time_churn_end - time_churn_start).count() << "us"
+      << " | iterate " << std::setw(8) << std::chrono::duration_cast<us>(time_iterate_end - time_iterate_start).count() << "us"
+      << " | sum "     << sum
+      << std::endl;
+}
+
+
+void main_reuse_policies()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    int entry_count = 1 << 20;
+
+    std::cout
+      << "running reuse policies with " << entry_count << " list entries..." << std::endl << std::endl;
+
+    run_reuse_policy<alloc::reuse_lifo>    ("lifo",     entry_count);
+    run_reuse_policy<alloc::reuse_prefetch>("prefetch", entry_count);
+    run_reuse_policy<alloc::reuse_sorted>  ("sorted",   entry_count);
+    run_reuse_policy<alloc::reuse_batched> ("batched",  entry_count);
+    run_reuse_policy<alloc::reuse_policy<true, 1 << 12, 64>>("all", entry_count);
+}
+
+// Allocate node_count nodes one by one and then in batches of 256 --
+// each on a fresh allocator, after a round which is not timed so the
+// heap under it has grown already -- writing to every node, and give
+// them back the same way
+template<typename allocator_t>
+void time_node_batches(char const *name, int node_count)
+{
+    namespace alloc = gaos::allocators;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    constexpr std::size_t node_size  = 48;
+    constexpr int         batch_size = 256;
+
+    std::vector<void*> nodes(node_count);
+
+    auto one_by_one = [&]() {
+        allocator_t allocator;
+
+        auto time_start = clock::now();
+        for (int i = 0; i < node_count; ++i) {
+            nodes[i] = allocator.allocate(node_size);
+            *(int*)nodes[i] = i;
+        }
+        for (int i = 0; i < node_count; ++i)
+          allocator.deallocate((decltype(allocator.allocate(0)))nodes[i], node_size);
+        auto time_end   = clock::now();
+
+        return std::chrono::duration_cast<us>(time_end - time_start).count();
+    };
+
+    auto batched = [&]() {
+        allocator_t allocator;
+
+        auto time_start = clock::now();
+        for (int i = 0; i < node_count; i += batch_size) {
+            alloc::allocate_batch(allocator, node_size, batch_size, nodes.data() + i);
+            for (int j = i; j < i + batch_size; ++j)
+              *(int*)nodes[j] = j;
+        }
+        for (int i = 0; i < node_count; i += batch_size)
+          alloc::deallocate_batch(allocator, nodes.data() + i, batch_size, node_size);
+        auto time_end   = clock::now();
+
+        return std::chrono::duration_cast<us>(time_end - time_start).count();
+    };
+
+    one_by_one();
+    std::int64_t time_single = one_by_one();
+    std::int64_t time_batch  = batched();
+
+    std::cout
+      << std::left << std::setw(16) << name << std::right
+      << " | one by one " << std::setw(8) << time_single << "us"
+      << " | batched "    << std::setw(8) << time_batch << "us"
+      << std::endl;
+}
+
+
+// Load a map of entry_count entries into an empty reuse and destroy it,
+// with its nodes from the reuse directly and through a bulk_stock; a
+// round which is not timed first grows the heap under them
+template<typename reuse_t>
+void time_bulk_map(char const *name, int entry_count)
+{
+    namespace alloc = gaos::allocators;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using pair_t  = std::pair<const int, int>;
+    using stock_t = alloc::bulk_stock<reuse_t>;
+
+    auto time_map = [entry_count](auto allocator) {
+        using map_t = std::map<int, int, std::less<int>, decltype(allocator)>;
+
+        auto time_start = clock::now();
+        std::optional<map_t> map(std::in_place, allocator);
+        for (int i = 0; i < entry_count; ++i)
+          map->emplace_hint(map->end(), i, i);
+        auto time_mid   = clock::now();
+        map.reset();
+        auto time_end   = clock::now();
+
+        return std::pair<std::int64_t, std::int64_t>(std::chrono::duration_cast<us>(time_mid - time_start).count(), std::chrono::duration_cast<us>(time_end - time_mid).count());
+    };
+
+    {
+        reuse_t reuse;
+        time_map(alloc::ptr<pair_t, reuse_t>(&reuse));
+    }
+
+    std::int64_t fill_ptr = 0, destroy_ptr = 0, fill_bulk = 0, destroy_bulk = 0;
+    {
+        reuse_t reuse;
+        std::tie(fill_ptr, destroy_ptr) = time_map(alloc::ptr<pair_t, reuse_t>(&reuse));
+    }
+    {
+        reuse_t reuse;
+        stock_t stock(&reuse);
+        std::tie(fill_bulk, destroy_bulk) = time_map(alloc::bulk<pair_t, stock_t>(&stock));
+    }
+
+    std::cout
+      << std::left << std::setw(16) << name << std::right
+      << " | ptr fill "   << std::setw(8) << fill_ptr << "us"
+      << " destroy "      << std::setw(8) << destroy_ptr << "us"
+      << " | bulk fill "  << std::setw(8) << fill_bulk << "us"
+      << " destroy "      << std::setw(8) << destroy_bulk << "us"
+      << std::endl;
+}
+
+
+void main_batch()
+{
+    gaos::memory::enable_logging = false;
+
+    namespace alloc = gaos::allocators;
+
+    int node_count = 1 << 20;
+
+    std::cout
+      << "running batch experiment with " << node_count << " nodes..." << std::endl << std::endl;
+
+    time_node_batches<alloc::libc<std::byte>>("libc", node_count);
+    time_node_batches<alloc::reuse<48, alloc::libc<std::byte>>>("reuse lifo", node_count);
+    time_node_batches<alloc::reuse<48, alloc::libc<std::byte>, alloc::reuse_batched>>("reuse batched", node_count);
+    time_node_batches<alloc::linear_pushpop<1 << 16, alloc::libc<std::byte>>>("linear_pushpop", node_count);
+
+    std::cout << std::endl;
+
+    time_bulk_map<alloc::reuse<48, alloc::libc<std::byte>>>("reuse lifo", node_count);
+    time_bulk_map<alloc::reuse<48, alloc::libc<std::byte>, alloc::reuse_batched>>("reuse batched", node_count);
+}
+
+
+// Keep a stream of tags as strings of their own and as interned ids:
+// how long it takes, how much memory it takes, how long it takes to
+// count the tags equal to one of them, and interning from a few threads
+void main_intern()
+{
+    gaos::memory::enable_logging = false;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using interner_t        = gaos::containers::string_interner<>;
+    using shared_interner_t = gaos::containers::string_interner<1 << 16, std::allocator<std::byte>, true>;
+
+    int distinct_count = 1 << 13;
+    int tag_count      = 1 << 20;
+    int thread_count   = 4;
+
+    // Tags are too long for the small string optimisation, and a few of
+    // them are far more common than the rest
+    std::vector<std::string> distinct;
+    distinct.reserve(distinct_count);
+    for (int i = 0; i < distinct_count; ++i)
+      distinct.push_back("service." + std::to_string(i % 97) + ".region-eu-west." + std::to_string(i));
+
+    std::mt19937                     random(tag_count);
+    std::vector<std::string_view>    stream;
+    stream.reserve(tag_count);
+    for (int i = 0; i < tag_count; ++i) {
+        double skewed = std::pow(std::uniform_real_distribution<double>(0, 1)(random), 3);
+        stream.push_back(distinct[(std::size_t)(skewed * distinct_count)]);
+    }
+
+    std::cout
+      << "running intern experiment with " << tag_count << " tags, " << distinct_count << " distinct..." << std::endl << std::endl;
+
+    // Strings of their own
+    auto time_strings_start = clock::now();
+    std::vector<std::string> strings(stream.begin(), stream.end());
+    auto time_strings_end   = clock::now();
+
+    std::size_t strings_bytes = 0;
+    for (std::string const &tag : strings)
+      strings_bytes += tag.capacity() + 1;
+
+    // Interned one by one, and in a batch
+    interner_t interner;
+    auto time_intern_start = clock::now();
+    std::vector<interner_t::id_t> ids(tag_count);
+    for (int i = 0; i < tag_count; ++i)
+      ids[i] = interner.intern(stream[i]);
+    auto time_intern_end   = clock::now();
+
+    interner_t batch_interner;
+    std::vector<interner_t::id_t> batch_ids(tag_count);
+    auto time_batch_start = clock::now();
+    batch_interner.intern_batch(stream.data(), stream.size(), batch_ids.data());
+    auto time_batch_end   = clock::now();
+
+    std::size_t interned_bytes = interner.bytes() + interner.table_bytes();
+
+    // Counting the tags equal to the most common one
+    auto time_compare_strings_start = clock::now();
+    std::size_t equal_strings = 0;
+    for (std::string const &tag : strings)
+      equal_strings += tag == strings[0];
+    auto time_compare_strings_end   = clock::now();
+
+    auto time_compare_ids_start = clock::now();
+    std::size_t equal_ids = 0;
+    for (interner_t::id_t id : ids)
+      equal_ids += id == ids[0];
+    auto time_compare_ids_end   = clock::now();
+
+    bool same = equal_ids == equal_strings && interner.size() == batch_interner.size();
+    for (int i = 0; same && i < tag_count; ++i)
+      same = interner.view(ids[i]) == stream[i] && batch_interner.view(batch_ids[i]) == stream[i];
+
+    // Threads interning the same stream, each from a different place
+    shared_interner_t shared_interner;
+    std::vector<std::thread> threads;
+    std::vector<std::size_t> mismatches(thread_count);
+    auto time_shared_start = clock::now();
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < tag_count; ++i) {
+                std::string_view tag = stream[(i + t * (tag_count / thread_count)) % tag_count];
+                mismatches[t] += shared_interner.view(shared_interner.intern(tag)) != tag;
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+      thread.join();
+    auto time_shared_end   = clock::now();
+
+    for (std::size_t mismatch : mismatches)
+      same &= mismatch == 0;
+    same &= shared_interner.size() == interner.size();
+
+    std::cout
+      << "strings          " << std::setw(8) << std::chrono::duration_cast<us>(time_strings_end - time_strings_start).count() << "us"
+        << " | " << std::setw(10) << strings_bytes << "B" << std::endl
+      << "intern           " << std::setw(8) << std::chrono::duration_cast<us>(time_intern_end - time_intern_start).count() << "us"
+        << " | " << std::setw(10) << interned_bytes << "B + ids " << tag_count * sizeof(interner_t::id_t) << "B" << std::endl
+      << "intern_batch     " << std::setw(8) << std::chrono::duration_cast<us>(time_batch_end - time_batch_start).count() << "us" << std::endl
+      << "compare strings  " << std::setw(8) << std::chrono::duration_cast<us>(time_compare_strings_end - time_compare_strings_start).count() << "us"
+        << " | " << equal_strings << " equal" << std::endl
+      << "compare ids      " << std::setw(8) << std::chrono::duration_cast<us>(time_compare_ids_end - time_compare_ids_start).count() << "us"
+        << " | " << equal_ids << " equal" << std::endl
+      << "shared, " << thread_count << " threads " << std::setw(8) << std::chrono::duration_cast<us>(time_shared_end - time_shared_start).count() << "us"
+        << " | " << shared_interner.size() << " distinct" << std::endl
+      << std::endl
+      << (same ? "all ids agree" : "ids DISAGREE") << std::endl;
+}
+
+
+// Run one workload on a fresh instance of every allocator, each used
+// through a ptr -- and for a threaded workload, through a locked too
+// Note the shared_arena counts its whole region as one malloc
+template<bool threaded, typename workload_t>
+void run_workload_on_allocators(char const *workload_name, std::size_t data_size, workload_t workload)
+{
+    namespace alloc = gaos::allocators;
+
+    using us    = std::chrono::microseconds;
+    using clock = std::chrono::high_resolution_clock;
+
+    using libc = alloc::libc<std::byte>;
+
+    std::cout
+      << std::endl << workload_name << " with " << data_size << "B" << std::endl;
+
+    auto use = [&](auto &base) {
+        using base_t = std::remove_reference_t<decltype(base)>;
+
+        if constexpr (threaded) {
+            using locked_t = alloc::locked<alloc::ptr<std::byte, base_t>>;
+
+            locked_t locked{ alloc::ptr<std::byte, base_t>(&base) };
+            alloc::ptr<std::byte, locked_t> allocator(&locked);
+            workload(allocator);
+        }
+        else {
+            alloc::ptr<std::byte, base_t> allocator(&base);
+            workload(allocator);
+        }
+    };
+
+    auto measure = [&](char const *allocator_name, auto run) {
+        gaos::memory::reset_meta_stats();
+
+        auto time_start = clock::now();
+        run();
+        auto time_end   = clock::now();
+
+        std::cout
+          << "  " << std::left << std::setw(32) << allocator_name << std::right
+          << " | "        << std::setw(9) << std::chrono::duration_cast<us>(time_end - time_start).count() << "us"
+          << " | malloc " << std::setw(9) << gaos::memory::count_malloc << "x"
+          << " | peak "   << std::setw(11) << gaos::memory::size_malloc_peak << "B"
+          << std::endl;
+    };
+
+    measure("libc", [&] {
+        libc base;
+        use(base);
+    });
+    measure("passthrough", [&] {
+        alloc::passthrough<libc> base;
+        use(base);
+    });
+    measure("stack 1 << 14", [&] {
+        alloc::stack<1 << 14, libc> base;
+        use(base);
+    });
+    measure("reuse 64", [&] {
+        alloc::reuse<64, libc> base;
+        use(base);
+    });
+    measure("linear_pushpop 1 << 16", [&] {
+        alloc::linear_pushpop<1 << 16, libc> base;
+        use(base);
+    });
+    measure("large_object 1 << 16", [&] {
+        alloc::large_object<1 << 16, libc> base;
+        use(base);
+    });
+    measure("linear_pushpop on large_object", [&] {
+        alloc::linear_pushpop<1 << 16, alloc::large_object<1 << 16, libc>> base;
+        use(base);
+    });
+    measure("profiled", [&] {
+        static gaos::memory::heap_profiler profiler;
+        alloc::profiled<libc> base(&profiler);
+        use(base);
+    });
+    measure("shared_arena", [&] {
+        alloc::shared_arena base(std::max<std::size_t>(data_size * 16, 1 << 26));
+        use(base);
+    });
+}
+
+
+// Sizes are given in bytes, or with a K, M or G suffix
+auto parse_data_size(char const *text) -> std::size_t
+{
+    char        *suffix;
+    std::size_t  size = (std::size_t)std::strtoull(text, &suffix, 10);
+
+    switch (*suffix) {
+        case 'K': case 'k': return size << 10;
+        case 'M': case 'm': return size << 20;
+        case 'G': case 'g': return size << 30;
+        default:            return size;
+    }
+}
+
+
+// core workloads [data size] [workload] -- run the workloads in tests.h
+// (or just the one named) against all allocators
+void main_workloads(int argc, char **argv)
+{
+    gaos::memory::enable_logging = false;
+
+    std::size_t  data_size = (argc > 2) ? parse_data_size(argv[2]) : std::size_t(1) << 20;
+    char const  *workload  = (argc > 3) ? argv[3] : "all";
+
+    auto selected = [&](char const *name) {
+        return std::strcmp(workload, "all") == 0 || std::strcmp(workload, name) == 0;
+    };
+
+    std::cout
+      << "running workloads with " << data_size << "B each..." << std::endl;
+
+    if (selected("tree"))
+      run_workload_on_allocators<false>("tree", data_size, [data_size](auto &allocator) { gaos::tests::test_tree(allocator, data_size); });
+    if (selected("queue"))
+      run_workload_on_allocators<false>("queue", data_size, [data_size](auto &allocator) { gaos::tests::test_queue(allocator, data_size); });
+    if (selected("strings"))
+      run_workload_on_allocators<false>("strings", data_size, [data_size](auto &allocator) { gaos::tests::test_strings(allocator, data_size); });
+    if (selected("graph"))
+      run_workload_on_allocators<false>("graph", data_size, [data_size](auto &allocator) { gaos::tests::test_graph(allocator, data_size); });
+    if (selected("fragmentation"))
+      run_workload_on_allocators<false>("fragmentation", data_size, [data_size](auto &allocator) { gaos::tests::test_fragmentation(allocator, data_size); });
+    if (selected("producer_consumer"))
+      run_workload_on_allocators<true>("producer_consumer", data_size, [data_size](auto &allocator) { gaos::tests::test_producer_consumer(allocator, data_size); });
+}
+
+
+int main(int argc, char **argv)
 {
     namespace version = gaos::version;
 
@@ -418,7 +2721,44 @@ int main()
       << version::get_git_history() << std::endl
       << std::endl;
 
-    main_speed_test();
+    if (argc > 1 && std::strcmp(argv[1], "heap_profile") == 0)
+      main_heap_profile();
+    else if (argc > 1 && std::strcmp(argv[1], "shared_arena") == 0)
+      main_shared_arena();
+    else if (argc > 1 && std::strcmp(argv[1], "trim") == 0)
+      main_trim();
+    else if (argc > 1 && std::strcmp(argv[1], "warm_start") == 0)
+      main_warm_start();
+    else if (argc > 1 && std::strcmp(argv[1], "workloads") == 0)
+      main_workloads(argc, argv);
+    else if (argc > 1 && std::strcmp(argv[1], "teardown") == 0)
+      main_teardown();
+    else if (argc > 1 && std::strcmp(argv[1], "reuse_policies") == 0)
+      main_reuse_policies();
+    else if (argc > 1 && std::strcmp(argv[1], "budgets") == 0)
+      main_budgets();
+    else if (argc > 1 && std::strcmp(argv[1], "snapshot") == 0)
+      main_snapshot();
+    else if (argc > 1 && std::strcmp(argv[1], "per_cpu") == 0)
+      main_per_cpu();
+    else if (argc > 1 && std::strcmp(argv[1], "page_map") == 0)
+      main_page_map();
+    else if (argc > 1 && std::strcmp(argv[1], "ring") == 0)
+      main_ring();
+    else if (argc > 1 && std::strcmp(argv[1], "scratch") == 0)
+      main_scratch();
+    else if (argc > 1 && std::strcmp(argv[1], "reclaimer") == 0)
+      main_reclaimer();
+    else if (argc > 1 && std::strcmp(argv[1], "ingest") == 0)
+      main_ingest();
+    else if (argc > 1 && std::strcmp(argv[1], "heap_map") == 0)
+      main_heap_map(argc, argv);
+    else if (argc > 1 && std::strcmp(argv[1], "batch") == 0)
+      main_batch();
+    else if (argc > 1 && std::strcmp(argv[1], "intern") == 0)
+      main_intern();
+    else
+      main_speed_test();
 
     return 0;
 }
\ No newline at end of file
@@ -8,8 +8,14 @@ void * operator new(std::size_t size)
 {
     namespace gm = gaos::memory;
 
+    if (gm::forbid_malloc_current.depth != 0)
+      gm::on_forbidden_malloc(size);
+
     void * p = malloc(size);
 
+    if (!gm::enable_logging)
+      return p;
+
     gm::ptr_buffer buffer;
     gm::fill_buffer_from_ptr(buffer, p);
     std::cout << "#    new " << &buffer.front() << " " << size << std::endl;
@@ -22,9 +28,11 @@ void operator delete(void * p)
 {
     namespace gm = gaos::memory;
 
-    gm::ptr_buffer buffer;
-    gm::fill_buffer_from_ptr(buffer, p);
-    std::cout << "# delete " << &buffer.front() << std::endl;
+    if (gm::enable_logging) {
+        gm::ptr_buffer buffer;
+        gm::fill_buffer_from_ptr(buffer, p);
+        std::cout << "# delete " << &buffer.front() << std::endl;
+    }
 
     free(p);
 }
\ No newline at end of file
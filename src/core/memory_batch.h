@@ -0,0 +1,47 @@
+#pragma once
+
+#include "core/allocator_traits.h"
+
+#include <cstddef>
+
+
+namespace gaos::allocators {
+
+
+    // Allocate count blocks of alloc_size bytes from any allocator in
+    // this project into out; those which can do it in one go do, for the
+    // others we allocate one by one. Returns how many were allocated,
+    // which is less than count only when the allocator ran out
+    template<typename allocator_t>
+    inline auto allocate_batch(allocator_t &allocator, std::size_t alloc_size, std::size_t count, void **out) -> std::size_t
+    {
+        if constexpr (has_allocate_batch_v<allocator_t>) {
+            return allocator.allocate_batch(alloc_size, count, out);
+        }
+        else {
+            std::size_t done = 0;
+            for (; done < count; ++done) {
+                out[done] = (void*)allocator.allocate(alloc_size);
+                if (out[done] == nullptr)
+                  break;
+            }
+            return done;
+        }
+    }
+
+
+    // Deallocate count blocks of alloc_size bytes, in one go where the
+    // allocator can
+    template<typename allocator_t>
+    inline void deallocate_batch(allocator_t &allocator, void *const *ptrs, std::size_t count, std::size_t alloc_size)
+    {
+        if constexpr (has_allocate_batch_v<allocator_t>) {
+            allocator.deallocate_batch(ptrs, count, alloc_size);
+        }
+        else {
+            for (std::size_t i = 0; i < count; ++i)
+              allocator.deallocate((decltype(allocator.allocate(alloc_size)))ptrs[i], alloc_size);
+        }
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "core/memory_trim.h"
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+
+
+namespace gaos::memory {
+
+
+    // How many bytes a part of the program may take, as one node of a
+    // tree: a tenant's budget can hold the budgets of its requests, which
+    // in turn hold those of their arenas -- whatever is charged to a
+    // budget is charged to every budget above it as well
+    // - hard_limit: a charge which would take any budget up the tree past
+    //   it is refused as a whole, and the allocation fails
+    // - soft_limit: a charge which takes a budget past it goes through,
+    //   but asks the owners in trim_target (if any) to trim back down to
+    //   it, and calls on_soft_limit (if set) on the charging thread
+    // Charging is a fetch_add per level, so it is lock-free, but every
+    // thread charging the same tree contends on it; the budgeted
+    // allocator charges in batches to keep that rare
+    class budget
+    {
+      public:
+      // -- Types
+
+        static constexpr std::size_t unlimited = std::numeric_limits<std::size_t>::max();
+
+        using callback_t = void(*)(budget &over, std::size_t used, void *context);
+
+      // -- Members
+
+        budget       *parent;
+        std::size_t   hard_limit;
+        std::size_t   soft_limit;
+
+        std::atomic<std::size_t> used          { 0 };
+        std::atomic<std::size_t> peak          { 0 };
+        std::atomic<std::size_t> soft_count    { 0 };
+        std::atomic<std::size_t> refused_count { 0 };
+
+        trim_registry *trim_target   = nullptr;
+        callback_t     on_soft_limit = nullptr;
+        void          *context       = nullptr;
+
+      // -- Construction
+
+        budget(std::size_t hard_limit = unlimited, std::size_t soft_limit = unlimited, budget *parent = nullptr) noexcept
+        : parent(parent), hard_limit(hard_limit), soft_limit(soft_limit) {}
+
+        budget(budget const&) = delete;
+        auto operator=(budget const&) -> budget& = delete;
+
+      // -- Accounting
+
+        // Charge size bytes here and to every budget above; returns false,
+        // having charged nothing, when that would break any hard limit
+        // The charge goes up the tree first; only once every level has let
+        // it through do the peaks move and the soft limits fire, on the
+        // way back down, so a refused charge never asks anyone to trim
+        bool charge(std::size_t size) noexcept
+        {
+            std::size_t before = used.fetch_add(size, std::memory_order_relaxed);
+            std::size_t after  = before + size;
+
+            if (after > hard_limit) {
+                refused_count.fetch_add(1, std::memory_order_relaxed);
+                used.fetch_sub(size, std::memory_order_relaxed);
+                return false;
+            }
+
+            if (parent != nullptr && !parent->charge(size)) {
+                used.fetch_sub(size, std::memory_order_relaxed);
+                return false;
+            }
+
+            std::size_t peak_before = peak.load(std::memory_order_relaxed);
+            while (peak_before < after && !peak.compare_exchange_weak(peak_before, after, std::memory_order_relaxed))
+              ;
+
+            if (before <= soft_limit && after > soft_limit)
+              over_soft_limit(after);
+            return true;
+        }
+
+
+        void release(std::size_t size) noexcept
+        {
+            for (budget *level = this; level != nullptr; level = level->parent)
+              level->used.fetch_sub(size, std::memory_order_relaxed);
+        }
+
+
+        // How much could still be charged here before a hard limit, here
+        // or anywhere above, is reached
+        auto available() const noexcept -> std::size_t
+        {
+            std::size_t least = unlimited;
+            for (budget const *level = this; level != nullptr; level = level->parent) {
+                std::size_t level_used = level->used.load(std::memory_order_relaxed);
+                std::size_t left       = level_used < level->hard_limit ? level->hard_limit - level_used : 0;
+                least = left < least ? left : least;
+            }
+            return least;
+        }
+
+      protected:
+        void over_soft_limit(std::size_t now_used) noexcept
+        {
+            soft_count.fetch_add(1, std::memory_order_relaxed);
+
+            if (trim_target != nullptr)
+              trim_target->request(now_used - soft_limit);
+            if (on_soft_limit != nullptr)
+              on_soft_limit(*this, now_used, context);
+        }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace gaos::memory {
+
+
+    // What an allocator looks like inside, as its snapshot() wrote it
+    // down: the regions it hands memory out of (blobs, chunks, buffers)
+    // with how much of each is handed out, and which of them the next
+    // allocation goes to (the count of regions when none), and the
+    // blocks it holds on to for later (free lists, cached slots) in the
+    // order it keeps them
+    // Taking a snapshot only reads; like anything else on an allocator,
+    // do not take one while another thread uses it
+
+    enum class heap_kind : std::uint32_t {
+        linear_pushpop = 1,
+        reuse          = 2,
+        stack          = 3,
+        per_cpu        = 4
+    };
+
+
+    struct heap_region {
+        std::uint64_t address;
+        std::uint64_t size;
+        std::uint64_t used;
+    };
+
+
+    struct heap_block {
+        std::uint64_t address;
+        std::uint64_t size;
+    };
+
+
+    struct heap_allocator {
+        heap_kind                 kind;
+        std::string               name;
+        std::uint64_t             block_size = 0;
+        std::uint64_t             dead_bytes = 0;
+        std::uint64_t             current    = 0;
+        std::vector<heap_region>  regions;
+        std::vector<heap_block>   free_blocks;
+    };
+
+
+    // Snapshots of any number of allocators, which can be written to a
+    // compact binary file for the heap_analyzer tool; all in the byte
+    // order of the machine that wrote it:
+    //   "GHM1", allocator count (u32), then per allocator
+    //   kind (u32), name size (u32), name, block size, dead bytes,
+    //   current region, region count, regions (address, size, used),
+    //   free block count, free blocks (address, size) -- all u64
+    class heap_map
+    {
+      public:
+      // -- Members
+
+        std::vector<heap_allocator> allocators;
+
+      // -- Adding
+
+        auto add(heap_kind kind, std::string name, std::size_t block_size = 0) -> heap_allocator & {
+            allocators.push_back({ kind, std::move(name), block_size, 0, 0, {}, {} });
+            return allocators.back();
+        }
+
+      // -- Files
+
+        bool write(char const *path) const {
+            std::FILE *file = std::fopen(path, "wb");
+            if (file == nullptr)
+              return false;
+
+            bool ok = std::fwrite("GHM1", 1, 4, file) == 4 && put(file, (std::uint32_t)allocators.size());
+            for (heap_allocator const &a : allocators) {
+                ok = ok && put(file, (std::uint32_t)a.kind) && put(file, (std::uint32_t)a.name.size())
+                        && put_all(file, a.name.data(), a.name.size())
+                        && put(file, a.block_size) && put(file, a.dead_bytes) && put(file, a.current)
+                        && put(file, (std::uint64_t)a.regions.size())
+                        && put_all(file, a.regions.data(), a.regions.size())
+                        && put(file, (std::uint64_t)a.free_blocks.size())
+                        && put_all(file, a.free_blocks.data(), a.free_blocks.size());
+            }
+
+            return std::fclose(file) == 0 && ok;
+        }
+
+
+        // Replaces whatever we held; false when the file is not a heap map
+        // Every count is checked against what is left of the file before
+        // anything is sized by it, so a damaged file cannot ask for more
+        bool read(char const *path) {
+            allocators.clear();
+
+            std::FILE *file = std::fopen(path, "rb");
+            if (file == nullptr)
+              return false;
+
+            char          magic[4];
+            std::uint32_t count = 0;
+            bool          ok    = std::fread(magic, 1, 4, file) == 4 && std::memcmp(magic, "GHM1", 4) == 0 && get(file, count);
+
+            for (std::uint32_t i = 0; ok && i < count; ++i) {
+                heap_allocator a;
+                std::uint32_t  kind = 0, name_size = 0;
+                std::uint64_t  region_count = 0, free_count = 0;
+
+                ok = get(file, kind) && get(file, name_size) && fits(file, name_size, 1);
+                if (ok) {
+                    a.kind = (heap_kind)kind;
+                    a.name.resize(name_size);
+                    ok = get_all(file, a.name.data(), name_size)
+                      && get(file, a.block_size) && get(file, a.dead_bytes) && get(file, a.current)
+                      && get(file, region_count) && fits(file, region_count, sizeof(heap_region));
+                }
+                if (ok) {
+                    a.regions.resize(region_count);
+                    ok = get_all(file, a.regions.data(), region_count)
+                      && get(file, free_count) && fits(file, free_count, sizeof(heap_block));
+                }
+                if (ok) {
+                    a.free_blocks.resize(free_count);
+                    ok = get_all(file, a.free_blocks.data(), free_count);
+                }
+                if (ok)
+                  allocators.push_back(std::move(a));
+            }
+
+            std::fclose(file);
+            return ok;
+        }
+
+      protected:
+        template<typename T>
+        static bool put(std::FILE *file, T value) {
+            return std::fwrite(&value, sizeof(T), 1, file) == 1;
+        }
+
+
+        // An empty vector may have no data to point at, so nothing is
+        // written for it at all
+        template<typename T>
+        static bool put_all(std::FILE *file, T const *values, std::size_t count) {
+            return count == 0 || std::fwrite(values, sizeof(T), count, file) == count;
+        }
+
+
+        template<typename T>
+        static bool get(std::FILE *file, T &value) {
+            return std::fread(&value, sizeof(T), 1, file) == 1;
+        }
+
+
+        template<typename T>
+        static bool get_all(std::FILE *file, T *values, std::size_t count) {
+            return count == 0 || std::fread(values, sizeof(T), count, file) == count;
+        }
+
+
+        // Whether count items of item_size bytes are left in the file
+        static bool fits(std::FILE *file, std::uint64_t count, std::size_t item_size) {
+            long at = std::ftell(file);
+            if (at < 0 || std::fseek(file, 0, SEEK_END) != 0)
+              return false;
+            long end = std::ftell(file);
+            if (end < at || std::fseek(file, at, SEEK_SET) != 0)
+              return false;
+            return count <= std::uint64_t(end - at) / item_size;
+        }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+#if defined(__GLIBC__)
+  #include <execinfo.h>
+#endif
+
+
+namespace gaos::memory {
+
+
+    // A sampling heap profiler in the style of tcmalloc: roughly every
+    // sample_period bytes allocated (Poisson distributed, so every byte
+    // is equally likely to be sampled) we take a stack trace, and keep
+    // track of it until that allocation is freed again
+    // Live samples are attributed to their allocation site, and can be
+    // written as a (legacy text) pprof heap profile at any time, or as
+    // it was when the sampled live heap was at its peak
+    // Stack traces are only available with glibc; elsewhere all samples
+    // end up at the same (empty) site
+    // Note the tables are fixed size and large, so keep this off the stack
+    class heap_profiler
+    {
+      public:
+      // -- Types
+
+        static constexpr std::size_t max_depth   = 32;
+        static constexpr std::size_t max_sites   = 1024;
+        static constexpr std::size_t max_samples = 1 << 14;
+
+        // Everything allocated from the same stack trace
+        struct site {
+            std::uint64_t  hash;
+            std::size_t    depth;
+            void          *frames[max_depth];
+            std::size_t    live_count;
+            std::size_t    live_bytes;
+            std::size_t    total_count;
+            std::size_t    total_bytes;
+        };
+
+        // Live site stats as they were at the peak
+        struct site_peak {
+            std::size_t live_count;
+            std::size_t live_bytes;
+        };
+
+        // A sampled allocation which is still alive
+        struct sample {
+            std::size_t   size;
+            std::uint32_t site_index;
+        };
+
+      // -- Members
+
+        std::size_t sample_period;
+
+        // Sampled addresses are kept in an open-addressing table which
+        // deallocations can probe without taking the lock
+        std::array<std::atomic<void*>, max_samples> sample_address;
+        std::array<sample,             max_samples> samples;
+        std::atomic<std::size_t>                    live_samples = 0;
+
+        std::mutex                          mutex;
+        std::array<site, max_sites>         sites;
+        std::size_t                         site_count     = 0;
+        std::size_t                         live_bytes     = 0;
+        std::size_t                         peak_bytes     = 0;
+        std::size_t                         dropped_count  = 0;
+        std::array<site_peak, max_sites>    peak_sites;
+        std::size_t                         peak_site_count = 0;
+
+      // -- Construction
+
+        heap_profiler(std::size_t sample_period = 1 << 19) noexcept
+        : sample_period(sample_period) {
+            for (auto &address : sample_address)
+              address.store(nullptr, std::memory_order_relaxed);
+        }
+
+      // -- Sampling
+
+        // The only cost on the fast path: one thread-local decrement
+        // Note the countdown is shared by all profilers on a thread
+        auto should_sample(std::size_t alloc_size) noexcept -> bool {
+            std::int64_t &countdown = bytes_until_sample();
+            countdown -= (std::int64_t)alloc_size;
+            return countdown < 0;
+        }
+
+
+        // Deallocations only need to look for their address when
+        // there is anything sampled at all
+        auto may_be_sampled() const noexcept -> bool {
+            return live_samples.load(std::memory_order_relaxed) != 0;
+        }
+
+
+        // Called when should_sample said so; take a stack trace
+        // and record the allocation at its site
+        void record_allocation(void *ptr, std::size_t alloc_size) noexcept {
+            bytes_until_sample() = next_sample_distance();
+
+            if (ptr == nullptr)
+              return;
+
+            void *frames[max_depth + 1];
+            std::size_t depth = capture_stack(frames, max_depth + 1);
+
+            // Skip the frame that took the trace
+            std::size_t skip = std::min<std::size_t>(depth, 1);
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            std::size_t site_index = find_site(frames + skip, depth - skip);
+            std::size_t slot       = find_free_slot(ptr);
+            if (site_index == max_sites || slot == max_samples) {
+                ++dropped_count;
+                return;
+            }
+
+            site &s = sites[site_index];
+            s.live_count  += 1;
+            s.live_bytes  += alloc_size;
+            s.total_count += 1;
+            s.total_bytes += alloc_size;
+
+            samples[slot] = { alloc_size, (std::uint32_t)site_index };
+            sample_address[slot].store(ptr, std::memory_order_release);
+            live_samples.fetch_add(1, std::memory_order_relaxed);
+
+            live_bytes += alloc_size;
+            note_peak();
+        }
+
+
+        // Called on deallocation when may_be_sampled; cheap if ptr
+        // was not sampled, as the probe does not lock
+        void record_deallocation(void *ptr) noexcept {
+            std::size_t slot = find_sample(ptr);
+            if (slot == max_samples)
+              return;
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            // Someone may have beaten us to it
+            if (sample_address[slot].load(std::memory_order_relaxed) != ptr)
+              return;
+
+            sample &smp = samples[slot];
+            site   &s   = sites[smp.site_index];
+            s.live_count -= 1;
+            s.live_bytes -= smp.size;
+            live_bytes   -= smp.size;
+
+            // Tombstone the slot, so probe sequences running through it
+            // stay intact -- unless it ends its probe sequence, in which
+            // case it and any tombstones right before it can be emptied
+            if (sample_address[(slot + 1) & (max_samples - 1)].load(std::memory_order_relaxed) != nullptr) {
+                sample_address[slot].store(tombstone(), std::memory_order_release);
+            }
+            else {
+                while (sample_address[slot].load(std::memory_order_relaxed) != nullptr) {
+                    sample_address[slot].store(nullptr, std::memory_order_release);
+                    slot = (slot - 1) & (max_samples - 1);
+                    if (sample_address[slot].load(std::memory_order_relaxed) != tombstone())
+                      break;
+                }
+            }
+            live_samples.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+      // -- Profiles
+
+        // Write the live samples as a pprof heap profile; the counts are the
+        // sampled ones, pprof scales them using the sample period
+        void write_profile(std::ostream &out) {
+            std::lock_guard<std::mutex> lock(mutex);
+            write_profile_locked(out, false);
+        }
+
+
+        // Write the live samples as they were at the peak
+        void write_peak_profile(std::ostream &out) {
+            std::lock_guard<std::mutex> lock(mutex);
+            write_profile_locked(out, true);
+        }
+
+
+        bool write_profile(char const *path, bool at_peak = false) {
+            std::ofstream out(path);
+            if (!out)
+              return false;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            write_profile_locked(out, at_peak);
+            return true;
+        }
+
+      protected:
+        static auto tombstone() noexcept -> void * {
+            return (void*)std::uintptr_t(1);
+        }
+
+
+        static auto bytes_until_sample() noexcept -> std::int64_t & {
+            thread_local std::int64_t countdown = 0;
+            return countdown;
+        }
+
+
+        // Exponentially distributed distance to the next sample, with
+        // a cheap thread-local xorshift for the randomness
+        auto next_sample_distance() const noexcept -> std::int64_t {
+            thread_local std::uint64_t state = 0x9E3779B97F4A7C15ull ^ (std::uint64_t)(std::uintptr_t)&state;
+
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            std::uint64_t random = state * 0x2545F4914F6CDD1Dull;
+
+            double uniform = (double)((random >> 11) + 1) * (1.0 / 9007199254740993.0);
+            return (std::int64_t)(-std::log(uniform) * (double)sample_period) + 1;
+        }
+
+
+        static auto capture_stack(void **frames, std::size_t max_frames) noexcept -> std::size_t {
+          #if defined(__GLIBC__)
+            return (std::size_t)backtrace(frames, (int)max_frames);
+          #else
+            (void)frames;
+            (void)max_frames;
+            return 0;
+          #endif
+        }
+
+
+        static auto address_slot(void *ptr) noexcept -> std::size_t {
+            std::uint64_t hash = (std::uint64_t)(std::uintptr_t)ptr * 0x9E3779B97F4A7C15ull;
+            return (std::size_t)(hash >> 32) & (max_samples - 1);
+        }
+
+
+        // Probe for a live sample; we can stop at the first empty slot,
+        // as slots are only emptied at the end of a probe sequence
+        auto find_sample(void *ptr) const noexcept -> std::size_t {
+            std::size_t slot = address_slot(ptr);
+            for (std::size_t probe = 0; probe < max_samples; ++probe) {
+                void *address = sample_address[slot].load(std::memory_order_acquire);
+                if (address == ptr)
+                  return slot;
+                if (address == nullptr)
+                  return max_samples;
+                slot = (slot + 1) & (max_samples - 1);
+            }
+            return max_samples;
+        }
+
+
+        // Find an empty or tombstoned slot for a new sample
+        auto find_free_slot(void *ptr) const noexcept -> std::size_t {
+            std::size_t slot = address_slot(ptr);
+            for (std::size_t probe = 0; probe < max_samples; ++probe) {
+                void *address = sample_address[slot].load(std::memory_order_relaxed);
+                if (address == nullptr || address == tombstone())
+                  return slot;
+                slot = (slot + 1) & (max_samples - 1);
+            }
+            return max_samples;
+        }
+
+
+        // Find (or add) the site for a stack trace
+        auto find_site(void **frames, std::size_t depth) noexcept -> std::size_t {
+            depth = std::min(depth, max_depth);
+
+            std::uint64_t hash = 0xCBF29CE484222325ull;
+            for (std::size_t i = 0; i < depth; ++i)
+              hash = (hash ^ (std::uint64_t)(std::uintptr_t)frames[i]) * 0x100000001B3ull;
+
+            for (std::size_t i = 0; i < site_count; ++i) {
+                if (sites[i].hash == hash && sites[i].depth == depth && std::equal(frames, frames + depth, sites[i].frames))
+                  return i;
+            }
+
+            if (site_count == max_sites)
+              return max_sites;
+
+            site &s = sites[site_count];
+            s = {};
+            s.hash  = hash;
+            s.depth = depth;
+            std::copy(frames, frames + depth, s.frames);
+            return site_count++;
+        }
+
+
+        // Keep a copy of the live site stats whenever the sampled live heap
+        // grows well past its previous peak (so we do not copy every sample)
+        void note_peak() noexcept {
+            if (live_bytes <= peak_bytes + peak_bytes / 8)
+              return;
+
+            peak_bytes      = live_bytes;
+            peak_site_count = site_count;
+            for (std::size_t i = 0; i < site_count; ++i)
+              peak_sites[i] = { sites[i].live_count, sites[i].live_bytes };
+        }
+
+
+        void write_profile_locked(std::ostream &out, bool at_peak) {
+            std::size_t count = at_peak ? peak_site_count : site_count;
+
+            auto live_of = [&](std::size_t i) -> site_peak {
+                return at_peak ? peak_sites[i] : site_peak{ sites[i].live_count, sites[i].live_bytes };
+            };
+
+            std::size_t total_live_count = 0, total_live_bytes = 0;
+            std::size_t total_count      = 0, total_bytes      = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                total_live_count += live_of(i).live_count;
+                total_live_bytes += live_of(i).live_bytes;
+                total_count      += sites[i].total_count;
+                total_bytes      += sites[i].total_bytes;
+            }
+
+            out
+              << "heap profile: "
+              << total_live_count << ": " << total_live_bytes << " ["
+              << total_count << ": " << total_bytes << "] @ heap_v2/" << sample_period << "\n";
+
+            for (std::size_t i = 0; i < count; ++i) {
+                site_peak live = live_of(i);
+                if (live.live_count == 0 && sites[i].total_count == 0)
+                  continue;
+
+                out
+                  << live.live_count << ": " << live.live_bytes << " ["
+                  << sites[i].total_count << ": " << sites[i].total_bytes << "] @";
+
+                for (std::size_t f = 0; f < sites[i].depth; ++f)
+                  out << " " << sites[i].frames[f];
+                out << "\n";
+            }
+
+            // pprof needs the mappings to symbolize the addresses
+          #if defined(__linux__)
+            out << "\nMAPPED_LIBRARIES:\n";
+            std::ifstream maps("/proc/self/maps");
+            out << maps.rdbuf();
+          #endif
+        }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+
+namespace gaos::memory {
+
+
+    // How ingest_file reads: buffered goes through the page cache, direct
+    // (O_DIRECT) goes from the device straight into our memory -- for
+    // files read once, which would only push everything else out of the
+    // cache; where the file system does not do O_DIRECT, direct reads
+    // buffered instead
+    enum class ingest_mode {
+        buffered,
+        direct
+    };
+
+
+    // Read a whole file into memory from an allocator, usually an arena
+    // like linear_pushpop, and return a view of it: a parser can then keep
+    // string_views into the arena rather than copy what it keeps out of a
+    // read buffer, and the bytes are only ever copied once, by the read
+    // itself. The view has no data when the file could not be read
+    // For direct reads the allocation is padded to whole pages at both
+    // ends, as O_DIRECT wants aligned memory, offsets and lengths
+    template<typename allocator_t>
+    auto ingest_file(allocator_t &allocator, char const *path, ingest_mode mode = ingest_mode::buffered) -> std::string_view
+    {
+      #if defined(__unix__) || defined(__APPLE__)
+        int flags = O_RDONLY | O_CLOEXEC;
+      #if defined(O_DIRECT)
+        if (mode == ingest_mode::direct)
+          flags |= O_DIRECT;
+      #else
+        mode = ingest_mode::buffered;
+      #endif
+
+        int fd = open(path, flags);
+        if (fd < 0 && mode == ingest_mode::direct) {
+            mode = ingest_mode::buffered;
+            fd   = open(path, O_RDONLY | O_CLOEXEC);
+        }
+        if (fd < 0)
+          return {};
+
+        struct stat status;
+        if (fstat(fd, &status) != 0) {
+            close(fd);
+            return {};
+        }
+
+        std::size_t size       = (std::size_t)status.st_size;
+        std::size_t page       = (std::size_t)sysconf(_SC_PAGESIZE);
+        std::size_t padding    = (mode == ingest_mode::direct) ? page : 0;
+        std::size_t alloc_size = (mode == ingest_mode::direct) ? (size + page - 1) / page * page + padding : size;
+
+        std::byte *allocated = (std::byte*)allocator.allocate(alloc_size == 0 ? 1 : alloc_size);
+        if (allocated == nullptr) {
+            close(fd);
+            return {};
+        }
+
+        std::byte *data = allocated;
+        if (padding != 0)
+          data = (std::byte*)(((std::uintptr_t)allocated + page - 1) / page * page);
+
+        // Direct reads ask for whole pages, and the last one comes back
+        // short; a file system which turns O_DIRECT down only says so on
+        // the first read, after which we read it buffered
+        std::size_t done = 0;
+        while (done < size) {
+            std::size_t wanted = (mode == ingest_mode::direct) ? (size - done + page - 1) / page * page : size - done;
+            ssize_t     got    = pread(fd, data + done, wanted, (off_t)done);
+
+            if (got < 0 && errno == EINTR)
+              continue;
+            if (got < 0 && errno == EINVAL && mode == ingest_mode::direct) {
+                close(fd);
+                mode = ingest_mode::buffered;
+                fd   = open(path, O_RDONLY | O_CLOEXEC);
+                if (fd < 0)
+                  break;
+                continue;
+            }
+            if (got <= 0)
+              break;
+            done += (std::size_t)got;
+        }
+
+        if (fd >= 0)
+          close(fd);
+
+        if (done < size) {
+            allocator.deallocate(allocated, alloc_size == 0 ? 1 : alloc_size);
+            return {};
+        }
+
+        return std::string_view((char const*)data, size);
+      #else
+        (void)mode;
+
+        std::FILE *file = std::fopen(path, "rb");
+        if (file == nullptr)
+          return {};
+
+        std::fseek(file, 0, SEEK_END);
+        long size = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+
+        char *data = size >= 0 ? (char*)allocator.allocate(size == 0 ? 1 : (std::size_t)size) : nullptr;
+        bool  read = data != nullptr && std::fread(data, 1, (std::size_t)size, file) == (std::size_t)size;
+        std::fclose(file);
+
+        if (!read) {
+            if (data != nullptr)
+              allocator.deallocate(data, size == 0 ? 1 : (std::size_t)size);
+            return {};
+        }
+        return std::string_view(data, (std::size_t)size);
+      #endif
+    }
+
+}
\ No newline at end of file
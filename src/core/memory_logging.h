@@ -1,7 +1,9 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <cstddef>
+#include <cstdlib>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
@@ -15,15 +17,17 @@ namespace gaos::memory {
     constexpr std::size_t ptr_byte_count = sizeof(void*);
     using ptr_buffer = std::array<char, ptr_byte_count*2 + 3>;
     auto int_hex(std::size_t v) -> char;
-    void fill_buffer_from_ptr(ptr_buffer &out_buffer, void const *ptr);
+    void fill_buffer_from_ptr(ptr_buffer &out_buffer, void *ptr);
 
   // -- Meta stats
 
-    // Global memory allocation stats
-    static std::size_t count_malloc     = 0;
-    static std::size_t count_free       = 0;
-    static std::size_t size_malloc_cur  = 0;
-    static std::size_t size_malloc_peak = 0;
+    // Global memory allocation stats; backing allocators (like libc) are
+    // called from many threads at once, so these are atomic -- relaxed,
+    // as they are only read once the threads are done
+    static std::atomic<std::size_t> count_malloc     = 0;
+    static std::atomic<std::size_t> count_free       = 0;
+    static std::atomic<std::size_t> size_malloc_cur  = 0;
+    static std::atomic<std::size_t> size_malloc_peak = 0;
 
     inline void log_meta_stats()
     {
@@ -43,9 +47,65 @@ namespace gaos::memory {
         size_malloc_peak = 0;
     }
 
+  // -- Forbidding backing allocations
+
+    // While a forbid_malloc scope is alive on a thread, every allocation
+    // on that thread which reaches a backing allocator is a violation --
+    // which is how we check that a warmed-up steady state never falls
+    // through to malloc
+    // That is anything which ends up in log_malloc (libc, large_object,
+    // ring, io_buffers, shared_arena) or in the global operator new; code
+    // calling std::malloc itself (like the page map) is not seen
+    struct forbid_malloc_state {
+        int         depth      = 0;
+        bool        abort      = true;
+        std::size_t violations = 0;
+    };
+
+    inline thread_local forbid_malloc_state forbid_malloc_current;
+
+    inline void on_forbidden_malloc(std::size_t size)
+    {
+        forbid_malloc_current.violations += 1;
+        if (!forbid_malloc_current.abort)
+          return;
+
+        std::cerr << "backing allocation of " << size << "B while forbidden" << std::endl;
+        std::abort();
+    }
+
+
+    // Scopes nest; by default a violation aborts, otherwise it is counted
+    class forbid_malloc
+    {
+      public:
+        bool        previous_abort;
+        std::size_t violations_at_start;
+
+        forbid_malloc(bool abort_on_violation = true) noexcept
+        : previous_abort(forbid_malloc_current.abort), violations_at_start(forbid_malloc_current.violations) {
+            forbid_malloc_current.depth += 1;
+            forbid_malloc_current.abort  = abort_on_violation;
+        }
+
+        forbid_malloc(forbid_malloc const&) = delete;
+        auto operator=(forbid_malloc const&) -> forbid_malloc& = delete;
+
+        ~forbid_malloc() noexcept {
+            forbid_malloc_current.depth -= 1;
+            forbid_malloc_current.abort  = previous_abort;
+        }
+
+        auto violations() const noexcept -> std::size_t {
+            return forbid_malloc_current.violations - violations_at_start;
+        }
+    };
+
   // -- Main logging
 
-    static bool enable_logging = false;
+    // Shared by all translation units, so the global operators
+    // in memory.cpp follow what main sets
+    inline bool enable_logging = false;
 
     // For logging purposes, the different types of allocations
     enum class allocation_type {
@@ -183,9 +243,14 @@ namespace gaos::memory {
 
     inline void log_malloc(void * addr, std::size_t size)
     {
-        count_malloc     += 1;
-        size_malloc_cur  += size;
-        size_malloc_peak  = std::max(size_malloc_peak, size_malloc_cur);
+        if (forbid_malloc_current.depth != 0)
+          on_forbidden_malloc(size);
+
+        count_malloc.fetch_add(1, std::memory_order_relaxed);
+        std::size_t cur  = size_malloc_cur.fetch_add(size, std::memory_order_relaxed) + size;
+        std::size_t peak = size_malloc_peak.load(std::memory_order_relaxed);
+        while (peak < cur && !size_malloc_peak.compare_exchange_weak(peak, cur, std::memory_order_relaxed))
+          ;
 
         if (!enable_logging)
           return;
@@ -203,8 +268,8 @@ namespace gaos::memory {
 
     inline void log_free(void * addr, std::size_t size)
     {
-        count_free      += 1;
-        size_malloc_cur -= size;
+        count_free.fetch_add(1, std::memory_order_relaxed);
+        size_malloc_cur.fetch_sub(size, std::memory_order_relaxed);
 
         if (!enable_logging)
           return;
@@ -261,7 +326,9 @@ namespace gaos::memory {
 
 
     // Fill a buffer with a 0x-- ptr address
-    inline void fill_buffer_from_ptr(ptr_buffer &out_buffer, void const * ptr)
+    // Note the ptr is not const, as compilers then assume we read the
+    // memory it points to, and warn it is uninitialised after a malloc
+    inline void fill_buffer_from_ptr(ptr_buffer &out_buffer, void * ptr)
     {
         char *write = &out_buffer.front();
 
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+
+namespace gaos::memory {
+
+
+    // A pointer which stores where it points relative to its own address,
+    // so a structure full of these stays valid wherever it is mapped --
+    // which is what lets several processes map the same memory at different
+    // addresses and all read the same containers in place
+    // Copying one recomputes the offset for the new location, so these
+    // behave like plain pointers as long as both ends are in the same
+    // mapping (or both are in the same process)
+    // Null is stored as an offset of 1, which can never be a real target
+    // The target is never part of the same object as the pointer, while
+    // the compiler would assume it is when it can follow the arithmetic;
+    // so the address of the pointer is hidden from it before the offset
+    // is applied
+    template<typename T>
+    class offset_ptr
+    {
+      public:
+      // -- Types
+
+        using element_type      = T;
+        using value_type        = std::remove_cv_t<T>;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = T*;
+        using reference         = std::add_lvalue_reference_t<T>;
+        using iterator_category = std::random_access_iterator_tag;
+
+        template<typename U>
+        using rebind = offset_ptr<U>;
+
+      // -- Members
+
+        std::ptrdiff_t offset = 1;
+
+      // -- Construction
+
+        offset_ptr() noexcept = default;
+
+        offset_ptr(std::nullptr_t) noexcept {}
+
+        offset_ptr(T *ptr) noexcept {
+            set(ptr);
+        }
+
+        offset_ptr(offset_ptr const &rh) noexcept {
+            set(rh.get());
+        }
+
+        template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+        offset_ptr(offset_ptr<U> const &rh) noexcept {
+            set(rh.get());
+        }
+
+        // Containers cast between void and typed pointers
+        template<typename U, typename = std::enable_if_t<!std::is_convertible_v<U*, T*>>, typename = void>
+        explicit offset_ptr(offset_ptr<U> const &rh) noexcept {
+            set(static_cast<T*>(rh.get()));
+        }
+
+
+        auto operator=(offset_ptr const &rh) noexcept -> offset_ptr& {
+            set(rh.get());
+            return *this;
+        }
+
+
+        auto operator=(T *ptr) noexcept -> offset_ptr& {
+            set(ptr);
+            return *this;
+        }
+
+
+        auto operator=(std::nullptr_t) noexcept -> offset_ptr& {
+            offset = 1;
+            return *this;
+        }
+
+
+        template<typename U = T>
+        static auto pointer_to(U &ref) noexcept -> offset_ptr {
+            return offset_ptr(&ref);
+        }
+
+      // -- Access
+
+        auto get() const noexcept -> T* {
+            if (offset == 1)
+              return nullptr;
+            return (T*)(opaque_address() + (std::uintptr_t)offset);
+        }
+
+
+        explicit operator T*() const noexcept {
+            return get();
+        }
+
+
+        explicit operator bool() const noexcept {
+            return offset != 1;
+        }
+
+
+        template<typename U = T>
+        auto operator*() const noexcept -> U& {
+            return *get();
+        }
+
+
+        auto operator->() const noexcept -> T* {
+            return get();
+        }
+
+
+        template<typename U = T>
+        auto operator[](std::ptrdiff_t i) const noexcept -> U& {
+            return get()[i];
+        }
+
+      // -- Arithmetic
+
+        auto operator++() noexcept -> offset_ptr& {
+            offset += sizeof(T);
+            return *this;
+        }
+
+
+        auto operator--() noexcept -> offset_ptr& {
+            offset -= sizeof(T);
+            return *this;
+        }
+
+
+        auto operator++(int) noexcept -> offset_ptr {
+            offset_ptr old(*this);
+            ++*this;
+            return old;
+        }
+
+
+        auto operator--(int) noexcept -> offset_ptr {
+            offset_ptr old(*this);
+            --*this;
+            return old;
+        }
+
+
+        auto operator+=(std::ptrdiff_t n) noexcept -> offset_ptr& {
+            offset += n * (std::ptrdiff_t)sizeof(T);
+            return *this;
+        }
+
+
+        auto operator-=(std::ptrdiff_t n) noexcept -> offset_ptr& {
+            offset -= n * (std::ptrdiff_t)sizeof(T);
+            return *this;
+        }
+
+
+        friend auto operator+(offset_ptr const &lh, std::ptrdiff_t n) noexcept -> offset_ptr {
+            return offset_ptr(lh.get() + n);
+        }
+
+
+        friend auto operator+(std::ptrdiff_t n, offset_ptr const &rh) noexcept -> offset_ptr {
+            return offset_ptr(rh.get() + n);
+        }
+
+
+        friend auto operator-(offset_ptr const &lh, std::ptrdiff_t n) noexcept -> offset_ptr {
+            return offset_ptr(lh.get() - n);
+        }
+
+
+        friend auto operator-(offset_ptr const &lh, offset_ptr const &rh) noexcept -> std::ptrdiff_t {
+            return lh.get() - rh.get();
+        }
+
+      // -- Comparison
+
+        friend bool operator==(offset_ptr const &lh, offset_ptr const &rh) noexcept { return lh.get() == rh.get(); }
+        friend bool operator!=(offset_ptr const &lh, offset_ptr const &rh) noexcept { return lh.get() != rh.get(); }
+        friend bool operator< (offset_ptr const &lh, offset_ptr const &rh) noexcept { return lh.get() <  rh.get(); }
+        friend bool operator<=(offset_ptr const &lh, offset_ptr const &rh) noexcept { return lh.get() <= rh.get(); }
+        friend bool operator> (offset_ptr const &lh, offset_ptr const &rh) noexcept { return lh.get() >  rh.get(); }
+        friend bool operator>=(offset_ptr const &lh, offset_ptr const &rh) noexcept { return lh.get() >= rh.get(); }
+
+        friend bool operator==(offset_ptr const &lh, std::nullptr_t) noexcept { return !lh; }
+        friend bool operator!=(offset_ptr const &lh, std::nullptr_t) noexcept { return (bool)lh; }
+        friend bool operator==(std::nullptr_t, offset_ptr const &rh) noexcept { return !rh; }
+        friend bool operator!=(std::nullptr_t, offset_ptr const &rh) noexcept { return (bool)rh; }
+
+      protected:
+        void set(T const volatile *ptr) noexcept {
+            if (ptr == nullptr)
+              offset = 1;
+            else
+              offset = (std::ptrdiff_t)((std::uintptr_t)ptr - opaque_address());
+        }
+
+
+        auto opaque_address() const noexcept -> std::uintptr_t {
+            std::uintptr_t address = (std::uintptr_t)this;
+          #if defined(__GNUC__)
+            asm("" : "+r"(address));
+          #endif
+            return address;
+        }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+
+namespace gaos::memory {
+
+
+    // Who to give memory in a range back to, without knowing its size:
+    // the allocator instance, the size of every block in the range if
+    // they are all the same (0 if not), and how to call its deallocate
+    struct page_owner {
+        void        *allocator;
+        std::size_t  block_size;
+        void       (*release)(void *allocator, void *ptr, std::size_t size) noexcept;
+    };
+
+
+    // Which allocator owns a pointer, answered from its address alone: a
+    // radix tree over the (48 bit) address space with an entry per page,
+    // like the page map of tcmalloc. Allocators add the ranges they hand
+    // out memory from (blobs, chunks, buffers) and remove them again when
+    // they give them back
+    // Ranges need not be page aligned and may be nested, so each page has
+    // a short list of the ranges on it, newest first: a nested range (a
+    // reuse chunk in a linear_pushpop blob) is found before the one
+    // around it, and a page two blobs share finds either
+    // Lookups take no locks: they announce themselves on one of two
+    // counters, and removing a range waits until every lookup which may
+    // still see it has finished before freeing it; adding and removing
+    // ranges is serialised with a mutex, as it is rare
+    class page_map
+    {
+      public:
+      // -- Types
+
+        static constexpr std::size_t page_bits    = 12;
+        static constexpr std::size_t level_bits   = 12;
+        static constexpr std::size_t address_bits = 48;
+        static constexpr std::size_t level_size   = std::size_t(1) << level_bits;
+
+        static_assert(page_bits + 3 * level_bits == address_bits);
+
+        struct range;
+
+        // A range's place in the list of one of its pages
+        struct link {
+            std::atomic<link*>  next { nullptr };
+            range              *owner;
+        };
+
+        // Allocated with a link for each of its pages right after it
+        struct range {
+            std::uintptr_t begin;
+            std::uintptr_t end;
+            page_owner     owner;
+            std::size_t    page_count;
+
+            auto links() noexcept -> link * {
+                return (link*)(this + 1);
+            }
+        };
+
+        struct leaf_node {
+            std::atomic<link*> pages[level_size];
+        };
+
+        struct mid_node {
+            std::atomic<leaf_node*> leaves[level_size];
+        };
+
+      // -- Members
+
+        std::atomic<mid_node*>     root[level_size] = {};
+        std::mutex                 mutex;
+        std::atomic<std::uint32_t> epoch { 0 };
+        std::atomic<std::size_t>   readers[2] = {};
+
+      // -- Construction
+
+        // The map all allocators in this project add their ranges to
+        static auto global() noexcept -> page_map& {
+            static page_map map;
+            return map;
+        }
+
+      // -- Ranges
+
+        // Start owning [begin, begin + size); returns nullptr when the
+        // bookkeeping could not be allocated, in which case the range is
+        // simply not known to the map
+        // The nodes of the tree, and the ranges, come from the C heap, so
+        // they do not show up in the stats of the allocators
+        auto add(void const *begin, std::size_t size, page_owner owner) noexcept -> range *
+        {
+            if (size == 0 || ((std::uintptr_t)begin + size - 1) >> address_bits != 0)
+              return nullptr;
+
+            std::uintptr_t first_page = (std::uintptr_t)begin >> page_bits;
+            std::uintptr_t last_page  = ((std::uintptr_t)begin + size - 1) >> page_bits;
+            std::size_t    page_count = last_page - first_page + 1;
+
+            void *memory = std::malloc(sizeof(range) + page_count * sizeof(link));
+            if (memory == nullptr)
+              return nullptr;
+
+            range *added = new (memory) range{ (std::uintptr_t)begin, (std::uintptr_t)begin + size, owner, page_count };
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            for (std::size_t i = 0; i < page_count; ++i) {
+                link               *page_link = new (added->links() + i) link;
+                std::atomic<link*> *slot      = slot_of(first_page + i, true);
+
+                page_link->owner = added;
+                if (slot == nullptr) {
+                    page_count = i;
+                    break;
+                }
+
+                page_link->next.store(slot->load(std::memory_order_relaxed), std::memory_order_relaxed);
+                slot->store(page_link, std::memory_order_release);
+            }
+
+            // Out of memory for the tree halfway: take back what we added
+            if (page_count != added->page_count) {
+                added->page_count = page_count;
+                remove_locked(added);
+                return nullptr;
+            }
+
+            return added;
+        }
+
+
+        void remove(range *removed) noexcept
+        {
+            if (removed == nullptr)
+              return;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            remove_locked(removed);
+        }
+
+      // -- Lookup
+
+        // Call found(range const&) with the range ptr is in, if any, while
+        // it cannot be removed; returns whether there was one
+        template<typename found_t>
+        bool find(void const *ptr, found_t found) noexcept
+        {
+            std::uint32_t side = enter();
+
+            std::uintptr_t address = (std::uintptr_t)ptr;
+            range const   *owner   = nullptr;
+
+            if (address >> address_bits == 0) {
+                std::atomic<link*> *slot = slot_of(address >> page_bits, false);
+                for (link *at = (slot != nullptr) ? slot->load(std::memory_order_acquire) : nullptr; at != nullptr; at = at->next.load(std::memory_order_acquire)) {
+                    if (address >= at->owner->begin && address < at->owner->end) {
+                        owner = at->owner;
+                        break;
+                    }
+                }
+            }
+
+            if (owner != nullptr)
+              found(*owner);
+
+            leave(side);
+            return owner != nullptr;
+        }
+
+
+        bool owns(void const *ptr) noexcept {
+            return find(ptr, [](range const&) {});
+        }
+
+
+        // The allocator instance which owns ptr, or nullptr
+        auto owner_of(void const *ptr) noexcept -> void * {
+            void *allocator = nullptr;
+            find(ptr, [&](range const &r) { allocator = r.owner.allocator; });
+            return allocator;
+        }
+
+
+        // The size of the block at ptr, where its range has only one size
+        // of block; 0 otherwise, or when nobody owns ptr
+        auto size_of(void const *ptr) noexcept -> std::size_t {
+            std::size_t size = 0;
+            find(ptr, [&](range const &r) { size = r.owner.block_size; });
+            return size;
+        }
+
+
+        // Give ptr back to whichever allocator owns it; returns false when
+        // no allocator we know of does
+        bool deallocate(void *ptr) noexcept {
+            page_owner owner {};
+            if (!find(ptr, [&](range const &r) { owner = r.owner; }))
+              return false;
+
+            owner.release(owner.allocator, ptr, owner.block_size);
+            return true;
+        }
+
+      protected:
+        auto slot_of(std::uintptr_t page, bool create) noexcept -> std::atomic<link*> *
+        {
+            std::size_t root_index = (page >> (2 * level_bits)) & (level_size - 1);
+            std::size_t mid_index  = (page >> level_bits) & (level_size - 1);
+            std::size_t leaf_index = page & (level_size - 1);
+
+            mid_node *mid = root[root_index].load(std::memory_order_acquire);
+            if (mid == nullptr) {
+                if (!create || (mid = new_node<mid_node>()) == nullptr)
+                  return nullptr;
+                root[root_index].store(mid, std::memory_order_release);
+            }
+
+            leaf_node *leaf = mid->leaves[mid_index].load(std::memory_order_acquire);
+            if (leaf == nullptr) {
+                if (!create || (leaf = new_node<leaf_node>()) == nullptr)
+                  return nullptr;
+                mid->leaves[mid_index].store(leaf, std::memory_order_release);
+            }
+
+            return &leaf->pages[leaf_index];
+        }
+
+
+        // Nodes are never freed, so lookups can always walk them
+        template<typename node_t>
+        static auto new_node() noexcept -> node_t * {
+            void *memory = std::calloc(1, sizeof(node_t));
+            return (memory == nullptr) ? nullptr : new (memory) node_t;
+        }
+
+
+        void remove_locked(range *removed) noexcept
+        {
+            std::uintptr_t first_page = removed->begin >> page_bits;
+
+            for (std::size_t i = 0; i < removed->page_count; ++i) {
+                link               *page_link = removed->links() + i;
+                std::atomic<link*> *at        = slot_of(first_page + i, false);
+
+                while (at->load(std::memory_order_relaxed) != page_link)
+                  at = &at->load(std::memory_order_relaxed)->next;
+                at->store(page_link->next.load(std::memory_order_relaxed), std::memory_order_release);
+            }
+
+            // Lookups which started before this may still be on our links
+            std::uint32_t side = epoch.fetch_add(1) & 1;
+            while (readers[side].load() != 0)
+              ;
+
+            std::free(removed);
+        }
+
+
+        // Lookups count themselves on the side of the current epoch; when
+        // the epoch moves on while we sign up, we may have been missed by
+        // a removal waiting on our side, so we try again
+        auto enter() noexcept -> std::uint32_t {
+            for (;;) {
+                std::uint32_t side = epoch.load() & 1;
+                readers[side].fetch_add(1);
+                if ((epoch.load() & 1) == side)
+                  return side;
+                readers[side].fetch_sub(1);
+            }
+        }
+
+
+        void leave(std::uint32_t side) noexcept {
+            readers[side].fetch_sub(1, std::memory_order_release);
+        }
+    };
+
+
+    // free() for memory from anywhere: what an allocator in the page map
+    // owns goes back to it, anything else is taken to be from malloc
+    inline void routed_free(void *ptr) noexcept
+    {
+        if (ptr != nullptr && !page_map::global().deallocate(ptr))
+          std::free(ptr);
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+  #include <sched.h>
+#endif
+
+
+namespace gaos::memory {
+
+
+    // A background thread which frees memory for others, so a request
+    // does not pay for tearing down a large container, or for handing a
+    // long list back to an allocator, while someone waits on it
+    // Any thread can defer a job (a batch of frees, a container to be
+    // destroyed); jobs go on a lock-free stack, which the reclaimer takes
+    // whole and runs in the order they came in. Whatever a job frees
+    // into is then used from the reclaimer as well, so it has to be
+    // thread-safe itself (libc with logging off, or anything under a
+    // locked)
+    // The thread runs at idle priority where we can (SCHED_IDLE on Linux),
+    // so it only takes time no request wants; to keep the queue bounded
+    // while it waits, once max_pending jobs are queued the job is run
+    // right away by whoever deferred it instead
+    class reclaimer
+    {
+      public:
+      // -- Types
+
+        struct job {
+            job   *next;
+            void (*run)(job *self) noexcept;
+        };
+
+        // Runs the callable and frees itself
+        template<typename callable_t>
+        struct job_of : job {
+            callable_t callable;
+
+            job_of(callable_t &&callable)
+            : job{ nullptr, &job_of::run_and_free }, callable(std::move(callable)) {}
+
+            static void run_and_free(job *self) noexcept {
+                job_of *typed = (job_of*)self;
+                typed->callable();
+                delete typed;
+            }
+        };
+
+      // -- Members
+
+        std::atomic<job*>          head          { nullptr };
+        std::atomic<std::size_t>   pending       { 0 };
+        std::atomic<std::uint64_t> submitted     { 0 };
+        std::atomic<std::uint64_t> completed     { 0 };
+        std::atomic<std::uint64_t> inline_count  { 0 };
+        std::size_t                max_pending;
+        std::chrono::milliseconds  interval;
+        std::mutex                 mutex;
+        std::condition_variable    wake;
+        std::atomic<bool>          stopping      { false };
+        std::thread                thread;
+
+      // -- Construction
+
+        reclaimer(std::size_t max_pending = 1024, std::chrono::milliseconds interval = std::chrono::milliseconds(10))
+        : max_pending(max_pending), interval(interval), thread([this] { run(); }) {}
+
+        reclaimer(reclaimer const&) = delete;
+        auto operator=(reclaimer const&) -> reclaimer& = delete;
+
+        // Runs whatever is still queued before it returns
+        ~reclaimer() noexcept {
+            stopping.store(true, std::memory_order_release);
+            wake.notify_one();
+            thread.join();
+        }
+
+      // -- Deferring
+
+        // Run callable() on the reclaimer, or right here when too many jobs
+        // are waiting already (or the job cannot be allocated)
+        template<typename callable_t>
+        void defer(callable_t callable) noexcept {
+            job_of<callable_t> *deferred = nullptr;
+            if (pending.load(std::memory_order_relaxed) < max_pending)
+              deferred = new (std::nothrow) job_of<callable_t>(std::move(callable));
+
+            if (deferred == nullptr) {
+                inline_count.fetch_add(1, std::memory_order_relaxed);
+                callable();
+                return;
+            }
+
+            pending.fetch_add(1, std::memory_order_relaxed);
+            submitted.fetch_add(1, std::memory_order_relaxed);
+
+            // Only the first job on an empty queue needs to wake the thread
+            job *top = head.load(std::memory_order_relaxed);
+            do {
+                deferred->next = top;
+            } while (!head.compare_exchange_weak(top, deferred, std::memory_order_release, std::memory_order_relaxed));
+
+            if (top == nullptr)
+              wake.notify_one();
+        }
+
+
+        // Destroy a container (or anything else) on the reclaimer: it is
+        // moved into the job, and its destructor runs when the job does
+        template<typename T>
+        void defer_destroy(T object) noexcept {
+            defer([owned = std::move(object)]() mutable {
+                T dropped(std::move(owned));
+            });
+        }
+
+
+        // Wait until every job deferred before this call has run
+        void drain() noexcept {
+            std::uint64_t target = submitted.load(std::memory_order_relaxed);
+            while (completed.load(std::memory_order_acquire) < target) {
+                wake.notify_one();
+                std::this_thread::yield();
+            }
+        }
+
+      protected:
+        void run() noexcept {
+          #if defined(__linux__) && defined(SCHED_IDLE)
+            sched_param idle {};
+            sched_setscheduler(0, SCHED_IDLE, &idle);
+          #endif
+
+            for (;;) {
+                job *taken = head.exchange(nullptr, std::memory_order_acquire);
+
+                if (taken == nullptr) {
+                    if (stopping.load(std::memory_order_acquire))
+                      return;
+
+                    // A wake which comes in before we wait costs us at most
+                    // one interval
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait_for(lock, interval);
+                    continue;
+                }
+
+                // The stack has the newest job on top
+                job *ordered = nullptr;
+                while (taken != nullptr) {
+                    job *next = taken->next;
+                    taken->next = ordered;
+                    ordered     = taken;
+                    taken       = next;
+                }
+
+                std::size_t count = 0;
+                while (ordered != nullptr) {
+                    job *next = ordered->next;
+                    ordered->run(ordered);
+                    ordered = next;
+                    ++count;
+                }
+
+                pending.fetch_sub(count, std::memory_order_relaxed);
+                completed.fetch_add(count, std::memory_order_release);
+            }
+        }
+    };
+
+}
\ No newline at end of file
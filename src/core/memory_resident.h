@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+
+namespace gaos::memory {
+
+
+    // How resident memory we reserve up front should be: lazy leaves it
+    // to page faults on first use, populate faults it in right away, and
+    // lock also keeps it from being swapped out (mlock, which is subject
+    // to RLIMIT_MEMLOCK)
+    enum class residency {
+        lazy,
+        populate,
+        lock
+    };
+
+
+    // Fault in the pages of [ptr, ptr + size) for writing, without
+    // changing what is in them: MADV_POPULATE_WRITE where the kernel has
+    // it, otherwise by writing every page's first byte back to itself
+    // Note the latter is not safe while others may write to the memory
+    inline void prefault(void *ptr, std::size_t size) noexcept
+    {
+        if (size == 0)
+          return;
+
+      #if defined(__unix__) || defined(__APPLE__)
+        static const std::uintptr_t page_size = (std::uintptr_t)sysconf(_SC_PAGESIZE);
+
+        #if defined(MADV_POPULATE_WRITE)
+          std::uintptr_t begin = (std::uintptr_t)ptr / page_size * page_size;
+          std::uintptr_t end   = ((std::uintptr_t)ptr + size + page_size - 1) / page_size * page_size;
+          if (madvise((void*)begin, end - begin, MADV_POPULATE_WRITE) == 0)
+            return;
+        #endif
+      #else
+        constexpr std::uintptr_t page_size = 4096;
+      #endif
+
+        volatile std::byte *bytes = (volatile std::byte*)ptr;
+        for (std::size_t offset = 0; offset < size; offset += page_size)
+          bytes[offset] = bytes[offset];
+        bytes[size - 1] = bytes[size - 1];
+    }
+
+
+    // Make [ptr, ptr + size) resident as asked; returns false when
+    // locking fails (the memory is then still populated)
+    inline bool make_resident(void *ptr, std::size_t size, residency mode) noexcept
+    {
+        if (mode == residency::lazy || size == 0)
+          return true;
+
+      #if defined(__unix__) || defined(__APPLE__)
+        if (mode == residency::lock && mlock(ptr, size) == 0)
+          return true;
+      #endif
+
+        prefault(ptr, size);
+        return mode != residency::lock;
+    }
+
+
+    // Undo make_resident with residency::lock
+    inline void unlock_resident(void *ptr, std::size_t size) noexcept
+    {
+      #if defined(__unix__) || defined(__APPLE__)
+        munlock(ptr, size);
+      #else
+        (void)ptr;
+        (void)size;
+      #endif
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "core/memory_zeroed.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+
+namespace gaos::memory {
+
+
+    // A recorded sequence of allocations, deallocations and scopes, as
+    // a traced allocator saw them; replaying it against another
+    // allocator repeats exactly the same requests, which is how we
+    // compare configurations without running the original program
+    // Allocations are numbered in the order they were made, so a
+    // replay keeps its live pointers in a plain vector
+    struct allocation_trace
+    {
+      // -- Types
+
+        enum class operation : std::uint8_t {
+            allocate,
+            allocate_zeroed,
+            deallocate,
+            push,
+            pop
+        };
+
+        struct event {
+            operation     op;
+            std::uint32_t id;
+            std::size_t   size;
+        };
+
+      // -- Members
+
+        std::vector<event> events;
+        std::uint32_t      allocation_count = 0;
+
+      // -- Recording
+
+        auto record_allocate(std::size_t size, bool zeroed) -> std::uint32_t {
+            events.push_back({ zeroed ? operation::allocate_zeroed : operation::allocate, allocation_count, size });
+            return allocation_count++;
+        }
+
+
+        void record_deallocate(std::uint32_t id, std::size_t size) {
+            events.push_back({ operation::deallocate, id, size });
+        }
+
+
+        void record_push() {
+            events.push_back({ operation::push, 0, 0 });
+        }
+
+
+        void record_pop() {
+            events.push_back({ operation::pop, 0, 0 });
+        }
+
+      // -- Storage
+
+        // As text, one event per line: a line of 'a', 'z' (zeroed) or
+        // 'd' with an id and a size, or '+' and '-' for scopes
+        bool write(char const *path) const {
+            std::FILE *file = std::fopen(path, "w");
+            if (file == nullptr)
+              return false;
+
+            std::fprintf(file, "gaos-trace 1 %u\n", (unsigned)allocation_count);
+            for (event const &e : events) {
+                switch (e.op) {
+                    case operation::allocate:        std::fprintf(file, "a %u %zu\n", (unsigned)e.id, e.size); break;
+                    case operation::allocate_zeroed: std::fprintf(file, "z %u %zu\n", (unsigned)e.id, e.size); break;
+                    case operation::deallocate:      std::fprintf(file, "d %u %zu\n", (unsigned)e.id, e.size); break;
+                    case operation::push:            std::fprintf(file, "+\n"); break;
+                    case operation::pop:             std::fprintf(file, "-\n"); break;
+                }
+            }
+
+            return std::fclose(file) == 0;
+        }
+
+
+        bool read(char const *path) {
+            std::FILE *file = std::fopen(path, "r");
+            if (file == nullptr)
+              return false;
+
+            events.clear();
+
+            unsigned count = 0;
+            bool     valid = std::fscanf(file, "gaos-trace 1 %u", &count) == 1;
+            allocation_count = count;
+
+            char op;
+            while (valid && std::fscanf(file, " %c", &op) == 1) {
+                unsigned    id   = 0;
+                std::size_t size = 0;
+
+                switch (op) {
+                    case 'a':
+                    case 'z':
+                    case 'd':
+                        valid = std::fscanf(file, "%u %zu", &id, &size) == 2 && id < count;
+                        events.push_back({ op == 'a' ? operation::allocate : op == 'z' ? operation::allocate_zeroed : operation::deallocate, id, size });
+                        break;
+                    case '+': record_push(); break;
+                    case '-': record_pop();  break;
+                    default:  valid = false;
+                }
+            }
+
+            std::fclose(file);
+            return valid;
+        }
+    };
+
+
+    // Send the events of a trace to an allocator; scopes become scoped
+    // pushpops, so they nest just as they did when the trace was taken
+    // Every allocation gets its first byte written, as it would be by
+    // whoever asked for it; an allocation which fails (say, over a
+    // budget) is counted in failed, and is not deallocated later
+    template<typename allocator_t>
+    inline auto replay_scope(allocation_trace const &trace, allocator_t &allocator, std::vector<void*> &live, std::size_t index, std::size_t &failed) -> std::size_t
+    {
+        using operation = allocation_trace::operation;
+
+        while (index < trace.events.size()) {
+            allocation_trace::event const &e = trace.events[index++];
+
+            switch (e.op) {
+                case operation::allocate:
+                    live[e.id] = allocator.allocate(e.size);
+                    if (live[e.id] == nullptr)
+                      ++failed;
+                    else if (e.size != 0)
+                      *(volatile std::byte*)live[e.id] = std::byte(0);
+                    break;
+                case operation::allocate_zeroed:
+                    live[e.id] = gaos::allocators::allocate_zeroed(allocator, e.size);
+                    if (live[e.id] == nullptr)
+                      ++failed;
+                    break;
+                case operation::deallocate:
+                    if (live[e.id] != nullptr)
+                      allocator.deallocate((std::byte*)live[e.id], e.size);
+                    break;
+                case operation::push: {
+                    [[maybe_unused]] auto scope_pushpop = allocator.get_scoped_pushpop();
+                    index = replay_scope(trace, allocator, live, index, failed);
+                    break;
+                }
+                case operation::pop:
+                    return index;
+            }
+        }
+
+        return index;
+    }
+
+
+    // Replay a whole trace, returning how long it took; how many of its
+    // allocations failed goes to failed_count, when given
+    template<typename allocator_t>
+    inline auto replay(allocation_trace const &trace, allocator_t &allocator, std::size_t *failed_count = nullptr) -> std::chrono::nanoseconds
+    {
+        std::vector<void*> live(trace.allocation_count, nullptr);
+        std::size_t        failed = 0;
+
+        auto time_start = std::chrono::steady_clock::now();
+        replay_scope(trace, allocator, live, 0, failed);
+        auto time_end   = std::chrono::steady_clock::now();
+
+        if (failed_count != nullptr)
+          *failed_count = failed;
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time_end - time_start);
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+
+namespace gaos::memory {
+
+
+    // Let the OS take back the whole pages within [ptr, ptr + size), while
+    // the memory stays ours: MADV_FREE where we have it (the pages are only
+    // reclaimed if there is pressure, and writing to them cancels that),
+    // MADV_DONTNEED otherwise; the contents are undefined afterwards
+    // Returns how many bytes were handed back
+    inline auto release_pages(void *ptr, std::size_t size) noexcept -> std::size_t
+    {
+      #if defined(__unix__) || defined(__APPLE__)
+        static const std::uintptr_t page_size = (std::uintptr_t)sysconf(_SC_PAGESIZE);
+
+        std::uintptr_t begin = ((std::uintptr_t)ptr + page_size - 1) / page_size * page_size;
+        std::uintptr_t end   = ((std::uintptr_t)ptr + size) / page_size * page_size;
+        if (end <= begin)
+          return 0;
+
+        #if defined(MADV_FREE)
+          if (madvise((void*)begin, end - begin, MADV_FREE) == 0)
+            return end - begin;
+        #endif
+        if (madvise((void*)begin, end - begin, MADV_DONTNEED) == 0)
+          return end - begin;
+      #else
+        (void)ptr;
+        (void)size;
+      #endif
+        return 0;
+    }
+
+
+    // Resident set size of this process, or 0 where we cannot tell
+    inline auto resident_bytes() noexcept -> std::size_t
+    {
+      #if defined(__linux__)
+        std::FILE *file = std::fopen("/proc/self/statm", "r");
+        if (file == nullptr)
+          return 0;
+
+        unsigned long long size = 0, resident = 0;
+        int read = std::fscanf(file, "%llu %llu", &size, &resident);
+        std::fclose(file);
+
+        return (read == 2) ? (std::size_t)resident * (std::size_t)sysconf(_SC_PAGESIZE) : 0;
+      #else
+        return 0;
+      #endif
+    }
+
+
+    // Allocators which cache memory (reuse lists, popped blobs) can give
+    // it back with trim(target_bytes); the registry is how a background
+    // thread asks them to, without ever touching an allocator itself
+    // Each owner registers a handle and polls it at a point where it is
+    // safe to trim, which costs a single relaxed load when nothing is asked
+    class trim_registry
+    {
+      public:
+      // -- Types
+
+        static constexpr std::size_t max_entries = 64;
+
+        struct entry {
+            std::atomic<bool>        in_use   { false };
+            std::atomic<std::size_t> pending  { 0 };
+            std::atomic<std::size_t> released { 0 };
+        };
+
+        // An owner's registration; move-only, unregisters when destroyed
+        class handle
+        {
+          public:
+            entry *registered = nullptr;
+
+            handle() noexcept = default;
+
+            explicit handle(entry *registered) noexcept
+            : registered(registered) {}
+
+            handle(handle const&) = delete;
+            auto operator=(handle const&) -> handle& = delete;
+
+            handle(handle &&rh) noexcept
+            : registered(rh.registered) {
+                rh.registered = nullptr;
+            }
+
+            auto operator=(handle &&rh) noexcept -> handle& {
+                std::swap(registered, rh.registered);
+                return *this;
+            }
+
+            ~handle() noexcept {
+                if (registered != nullptr)
+                  registered->in_use.store(false, std::memory_order_release);
+            }
+
+
+            bool pending() const noexcept {
+                return registered != nullptr && registered->pending.load(std::memory_order_relaxed) != 0;
+            }
+
+
+            // Trim the allocator if we were asked to; returns bytes released
+            template<typename allocator_t>
+            auto poll(allocator_t &allocator) noexcept -> std::size_t {
+                if (!pending())
+                  return 0;
+
+                std::size_t target   = registered->pending.exchange(0, std::memory_order_relaxed);
+                std::size_t released = allocator.trim(target);
+                registered->released.fetch_add(released, std::memory_order_relaxed);
+                return released;
+            }
+        };
+
+      // -- Members
+
+        std::array<entry, max_entries> entries;
+        std::atomic<std::size_t>       request_count { 0 };
+
+      // -- Construction
+
+        // The registry the trim threads use by default
+        static auto global() noexcept -> trim_registry& {
+            static trim_registry registry;
+            return registry;
+        }
+
+      // -- Registration
+
+        // Returns an empty handle when all entries are taken
+        auto add() noexcept -> handle {
+            for (entry &e : entries) {
+                bool expected = false;
+                if (e.in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    e.pending.store(0, std::memory_order_relaxed);
+                    e.released.store(0, std::memory_order_relaxed);
+                    return handle(&e);
+                }
+            }
+            return handle();
+        }
+
+      // -- Trimming
+
+        // Ask every owner to give back up to target_bytes; a request which
+        // has not been picked up yet is raised rather than added to
+        void request(std::size_t target_bytes) noexcept {
+            request_count.fetch_add(1, std::memory_order_relaxed);
+            for (entry &e : entries) {
+                if (!e.in_use.load(std::memory_order_acquire))
+                  continue;
+
+                std::size_t pending = e.pending.load(std::memory_order_relaxed);
+                while (pending < target_bytes && !e.pending.compare_exchange_weak(pending, target_bytes, std::memory_order_relaxed))
+                  ;
+            }
+        }
+
+
+        auto total_released() const noexcept -> std::size_t {
+            std::size_t released = 0;
+            for (entry const &e : entries)
+              released += e.released.load(std::memory_order_relaxed);
+            return released;
+        }
+    };
+
+
+    // Pressure sources: poll() returns how many bytes to trim, or 0
+
+    // A source a test (or anything else) can trigger by hand
+    struct simulated_pressure
+    {
+        std::atomic<std::size_t> requested { 0 };
+
+        void request(std::size_t target_bytes) noexcept {
+            requested.store(target_bytes, std::memory_order_relaxed);
+        }
+
+        auto poll() noexcept -> std::size_t {
+            return requested.exchange(0, std::memory_order_relaxed);
+        }
+    };
+
+
+    // The cgroup v2 memory.events counters: every poll in which the
+    // cgroup went over memory.high, or ran into memory.max, asks for
+    // trim_bytes; the counters are read once up front, so only new
+    // events count
+    struct cgroup_events_pressure
+    {
+        char const    *path;
+        std::size_t    trim_bytes;
+        std::uint64_t  last_high = 0;
+        std::uint64_t  last_max  = 0;
+
+        cgroup_events_pressure(std::size_t trim_bytes = std::size_t(64) << 20, char const *path = "/sys/fs/cgroup/memory.events") noexcept
+        : path(path), trim_bytes(trim_bytes) {
+            read(last_high, last_max);
+        }
+
+        auto poll() noexcept -> std::size_t {
+            std::uint64_t high = last_high, max = last_max;
+            if (!read(high, max))
+              return 0;
+
+            bool pressure = high != last_high || max != last_max;
+            last_high = high;
+            last_max  = max;
+            return pressure ? trim_bytes : 0;
+        }
+
+      protected:
+        auto read(std::uint64_t &high, std::uint64_t &max) noexcept -> bool {
+            std::FILE *file = std::fopen(path, "r");
+            if (file == nullptr)
+              return false;
+
+            char               key[32];
+            unsigned long long value;
+            while (std::fscanf(file, "%31s %llu", key, &value) == 2) {
+                if (std::strcmp(key, "high") == 0)
+                  high = value;
+                else if (std::strcmp(key, "max") == 0)
+                  max = value;
+            }
+
+            std::fclose(file);
+            return true;
+        }
+    };
+
+
+    // Pressure stall information: when tasks spent more than threshold
+    // percent of the last 10 seconds stalled on memory, ask for trim_bytes
+    // Point it at a cgroup's memory.pressure to watch just that cgroup
+    struct psi_pressure
+    {
+        char const  *path;
+        std::size_t  trim_bytes;
+        double       threshold;
+
+        psi_pressure(std::size_t trim_bytes = std::size_t(64) << 20, double threshold = 10.0, char const *path = "/proc/pressure/memory") noexcept
+        : path(path), trim_bytes(trim_bytes), threshold(threshold) {}
+
+        auto poll() noexcept -> std::size_t {
+            std::FILE *file = std::fopen(path, "r");
+            if (file == nullptr)
+              return 0;
+
+            double some_avg10 = 0.0;
+            int    read       = std::fscanf(file, "some avg10=%lf", &some_avg10);
+            std::fclose(file);
+
+            return (read == 1 && some_avg10 > threshold) ? trim_bytes : 0;
+        }
+    };
+
+
+    // Poll a pressure source on a background thread, and pass any trim
+    // it asks for on to the owners in a registry
+    template<typename source_t>
+    class trim_thread
+    {
+      public:
+      // -- Members
+
+        source_t                  &source;
+        trim_registry             &registry;
+        std::chrono::milliseconds  interval;
+        std::mutex                 mutex;
+        std::condition_variable    wake;
+        bool                       stopping = false;
+        std::thread                thread;
+
+      // -- Construction
+
+        trim_thread(source_t &source, trim_registry &registry = trim_registry::global(), std::chrono::milliseconds interval = std::chrono::milliseconds(100))
+        : source(source), registry(registry), interval(interval), thread([this] { run(); }) {}
+
+        trim_thread(trim_thread const&) = delete;
+        auto operator=(trim_thread const&) -> trim_thread& = delete;
+
+        ~trim_thread() noexcept {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+
+      protected:
+        void run() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!wake.wait_for(lock, interval, [this] { return stopping; })) {
+                std::size_t target = source.poll();
+                if (target != 0)
+                  registry.request(target);
+            }
+        }
+    };
+
+}
\ No newline at end of file
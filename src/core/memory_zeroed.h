@@ -0,0 +1,122 @@
+#pragma once
+
+#include "core/allocator_traits.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX__)
+  #include <immintrin.h>
+  #define GAOS_CLEAR_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define GAOS_CLEAR_SSE2
+#endif
+
+
+namespace gaos::memory {
+
+
+    // Below this size we expect cleared memory to be used while it is
+    // still in cache, and a plain memset wins; above it we clear with
+    // non-temporal stores, which go around the cache instead of
+    // evicting everything else from it
+    constexpr std::size_t streaming_clear_size = 1 << 18;
+
+
+    // Zero a range of (recycled) memory
+    inline void clear(void *ptr, std::size_t size) noexcept
+    {
+      #if defined(GAOS_CLEAR_AVX) || defined(GAOS_CLEAR_SSE2)
+        if (size >= streaming_clear_size) {
+          #if defined(GAOS_CLEAR_AVX)
+            using vector_t = __m256i;
+          #else
+            using vector_t = __m128i;
+          #endif
+            constexpr std::size_t vector_size = sizeof(vector_t);
+
+            std::byte *write = (std::byte*)ptr;
+            std::byte *end   = write + size;
+
+            // Streaming stores need alignment, so memset up to it
+            std::size_t head = (vector_size - ((std::uintptr_t)write & (vector_size - 1))) & (vector_size - 1);
+            std::memset(write, 0, head);
+            write += head;
+
+            for (; write + vector_size * 4 <= end; write += vector_size * 4) {
+              #if defined(GAOS_CLEAR_AVX)
+                __m256i zero = _mm256_setzero_si256();
+                _mm256_stream_si256((__m256i*)write + 0, zero);
+                _mm256_stream_si256((__m256i*)write + 1, zero);
+                _mm256_stream_si256((__m256i*)write + 2, zero);
+                _mm256_stream_si256((__m256i*)write + 3, zero);
+              #else
+                __m128i zero = _mm_setzero_si128();
+                _mm_stream_si128((__m128i*)write + 0, zero);
+                _mm_stream_si128((__m128i*)write + 1, zero);
+                _mm_stream_si128((__m128i*)write + 2, zero);
+                _mm_stream_si128((__m128i*)write + 3, zero);
+              #endif
+            }
+
+            // Non-temporal stores are weakly ordered; fence them
+            // before anyone gets to see the memory
+            _mm_sfence();
+
+            std::memset(write, 0, (std::size_t)(end - write));
+            return;
+        }
+      #endif
+
+        std::memset(ptr, 0, size);
+    }
+
+}
+
+
+namespace gaos::allocators {
+
+
+    // Allocate zeroed memory from any allocator in this project; those
+    // which know when their memory is zero already can skip clearing it,
+    // for the others we clear it ourselves
+    template<typename allocator_t>
+    inline auto allocate_zeroed(allocator_t &allocator, std::size_t alloc_size) -> std::byte *
+    {
+        if constexpr (has_allocate_zeroed_v<allocator_t>) {
+            return (std::byte*)allocator.allocate_zeroed(alloc_size);
+        }
+        else {
+            std::byte *ptr = (std::byte*)allocator.allocate(alloc_size);
+            if (ptr != nullptr)
+              gaos::memory::clear(ptr, alloc_size);
+            return ptr;
+        }
+    }
+
+
+    // Allocate memory with the given alignment from any allocator in this
+    // project; those which bump byte by byte are asked for it, the others
+    // align for any fundamental type by themselves
+    template<typename allocator_t>
+    inline auto allocate_aligned(allocator_t &allocator, std::size_t alloc_size, std::size_t alignment) -> std::byte *
+    {
+        if constexpr (has_allocate_aligned_v<allocator_t>)
+          return (std::byte*)allocator.allocate_aligned(alloc_size, alignment);
+        else
+          return (std::byte*)allocator.allocate(alloc_size);
+    }
+
+
+    template<typename allocator_t>
+    inline auto allocate_zeroed(allocator_t &allocator, std::size_t alloc_size, std::size_t alignment) -> std::byte *
+    {
+        if constexpr (has_allocate_aligned_v<allocator_t>)
+          return (std::byte*)allocator.allocate_zeroed(alloc_size, alignment);
+        else
+          return gaos::allocators::allocate_zeroed(allocator, alloc_size);
+    }
+
+}
\ No newline at end of file
@@ -1,4 +1,18 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 
@@ -41,6 +55,113 @@ namespace gaos::tests {
         }
     }
 
+
+
+    // Build many short-lived small vectors; most fit inline, some
+    // spill to the allocator and are then shrunk back inline
+    template<typename allocator_t>
+    inline void test_small_vector(allocator_t& allocator)
+    {
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "gaos::containers::small_vector<int, 32>"
+              << std::endl;
+        }
+
+        for (int round = 0; round < 500; ++round) {
+            gaos::containers::small_vector<int, 32, allocator_t> test(allocator);
+
+            for (int i = 0; i < round % 64; ++i)
+              test.push_back(i);
+
+            while (test.size() > 8)
+              test.pop_back();
+
+            test.shrink_to_fit();
+        }
+
+        gaos::memory::log_flush(true);
+        
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "done"
+              << std::endl;
+        }
+    }
+
+
+
+    // Grow a single buffer by doubling until it is max_size bytes --
+    // every step of growth has to move everything we have so far
+    template<typename allocator_t>
+    inline void test_grow_buffer(allocator_t& allocator, std::size_t max_size)
+    {
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "grow gaos::containers::small_vector<std::uint64_t> to " << max_size << "B"
+              << std::endl;
+        }
+
+        gaos::containers::small_vector<std::uint64_t, 1, allocator_t> test(allocator);
+
+        for (std::size_t count = 1024; count * sizeof(std::uint64_t) <= max_size; count *= 2) {
+            test.resize(count);
+            test.back() = count;
+        }
+
+        gaos::memory::log_flush(true);
+        
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "done"
+              << std::endl;
+        }
+    }
+
+
+
+    // Get a large zeroed table and touch only a few entries in it -- the
+    // pattern of a big sparse table, where clearing it all up front
+    // faults in every one of its pages before we even start
+    template<typename allocator_t>
+    inline void test_sparse_table(allocator_t& allocator, std::size_t size, bool use_allocate_zeroed)
+    {
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "sparse table of " << size << "B"
+              << std::endl;
+        }
+
+        std::byte *table;
+
+        if (use_allocate_zeroed) {
+            table = gaos::allocators::allocate_zeroed(allocator, size);
+        }
+        else {
+            table = (std::byte*)allocator.allocate(size);
+            std::memset(table, 0, size);
+        }
+
+        for (std::size_t i = 0; i < size; i += size / 64)
+          table[i] = std::byte(1);
+
+        allocator.deallocate(table, size);
+
+        gaos::memory::log_flush(true);
+        
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "done"
+              << std::endl;
+        }
+    }
+
     
     // Over multiple loops, fill an unordered_map with values,
     // then remove multiples of N, add multiples of N+1, etc
@@ -100,7 +221,7 @@ namespace gaos::tests {
                       << std::endl;
                 }
 
-                for (const auto elem : test)
+                for (const auto &elem : test)
                   accumulate[elem.second] += 1;
 
                 accumulate.clear();
@@ -117,4 +238,513 @@ namespace gaos::tests {
         }
     }
 
+
+    // The same pattern as test_map, but on a flat_map, which puts
+    // all its entries in one allocation instead of one per node
+    template<typename allocator_t>
+    inline void test_flat_map(allocator_t& allocator)
+    {
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "gaos::containers::flat_map<int, int>"
+              << std::endl;
+        }
+
+        gaos::containers::flat_map<int, int, allocator_t> test(allocator);
+
+        gaos::memory::log_flush(true);
+
+        for (std::size_t step_size = 1; step_size <= 10; ++step_size) {
+            if (step_size % 2 == 1) {
+                if (gaos::memory::enable_logging) {
+                    std::cout
+                      << std::endl
+                      << "increment multiples of " << step_size
+                      << std::endl;
+                }
+
+                for (std::size_t i = 0; i < 1000; i += step_size)
+                  test[(int)i] += (int)i;
+            }
+            else {
+                if (gaos::memory::enable_logging) {
+                    std::cout
+                      << std::endl
+                      << "remove multiples of " << step_size
+                      << std::endl;
+                }
+
+                for (std::size_t i = 0; i < 1000; i += step_size)
+                  test.erase((int)i);
+            }
+
+            gaos::memory::log_flush(true);
+
+            {
+                [[maybe_unused]] auto scope_pushpop = allocator.get_scoped_pushpop();
+
+                gaos::containers::flat_map<int, int, allocator_t> accumulate(allocator);
+                
+                if (gaos::memory::enable_logging) {
+                    std::cout
+                      << std::endl
+                      << "accumulate frequencies"
+                      << std::endl;
+                }
+
+                for (const auto &elem : test)
+                  accumulate[elem.second] += 1;
+
+                accumulate.clear();
+            }
+
+            gaos::memory::log_flush(true);
+        }
+        
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "done"
+              << std::endl;
+        }
+    }
+
+
+    // The workloads below scale with data_size, roughly the bytes they
+    // keep live at once, so they can be run from cache-sized up to sizes
+    // well beyond the TLB's reach; they take any allocator the std
+    // containers take, and rebind it to whatever they need
+
+    // A small deterministic generator, so every allocator sees the
+    // exact same sequence of requests
+    inline auto test_random(std::uint64_t &state) -> std::uint64_t
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+
+    template<typename allocator_t, typename T>
+    using test_rebind = typename std::allocator_traits<allocator_t>::template rebind_alloc<T>;
+
+
+    // Churn through the nodes of a std::map and a std::set: insert keys
+    // at random, then erase every other one in order, a few times over
+    template<typename allocator_t>
+    inline void test_tree(allocator_t& allocator, std::size_t data_size)
+    {
+        using map_allocator = test_rebind<allocator_t, std::pair<const int, int>>;
+        using set_allocator = test_rebind<allocator_t, int>;
+
+        std::size_t   count = std::max<std::size_t>(data_size / 128, 16);
+        std::uint64_t state = 0x9e3779b97f4a7c15;
+
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "std::map<int, int> and std::set<int> with " << count << " keys"
+              << std::endl;
+        }
+
+        std::map<int, int, std::less<int>, map_allocator> tree{ map_allocator(allocator) };
+        std::set<int, std::less<int>, set_allocator>      keys{ set_allocator(allocator) };
+
+        for (int round = 0; round < 4; ++round) {
+            for (std::size_t i = 0; i < count; ++i) {
+                int key = (int)(test_random(state) % (count * 2));
+                tree[key] += 1;
+                keys.insert(key);
+            }
+
+            for (auto it = keys.begin(); it != keys.end();) {
+                tree.erase(*it);
+                it = keys.erase(it);
+                if (it != keys.end())
+                  ++it;
+            }
+
+            gaos::memory::log_flush(true);
+        }
+        
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "done"
+              << std::endl;
+        }
+    }
+
+
+    // Use a std::list and a std::deque as FIFO queues: fill them, then
+    // keep them at that length while everything passes through, then
+    // drain them
+    template<typename allocator_t>
+    inline void test_queue(allocator_t& allocator, std::size_t data_size)
+    {
+        using int_allocator = test_rebind<allocator_t, int>;
+
+        std::size_t count = std::max<std::size_t>(data_size / 48, 16);
+
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "std::list<int> and std::deque<int> queues of " << count
+              << std::endl;
+        }
+
+        std::list<int, int_allocator>  list{ int_allocator(allocator) };
+        std::deque<int, int_allocator> deque{ int_allocator(allocator) };
+
+        for (std::size_t i = 0; i < count; ++i) {
+            list.push_back((int)i);
+            deque.push_back((int)i);
+        }
+
+        for (std::size_t i = 0; i < count * 4; ++i) {
+            int value = list.front() + deque.front();
+            list.pop_front();
+            deque.pop_front();
+            list.push_back(value);
+            deque.push_back(value);
+        }
+
+        gaos::memory::log_flush(true);
+
+        while (!list.empty()) {
+            list.pop_front();
+            deque.pop_front();
+        }
+
+        gaos::memory::log_flush(true);
+        
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "done"
+              << std::endl;
+        }
+    }
+
+
+    // Generate a comma separated text of data_size bytes, then parse it
+    // line by line: every field becomes a string (long enough not to fit
+    // inline), and the first field of every line is kept as a record
+    // The fields are only needed while we look at their line, which
+    // makes every line a candidate for a push-pop
+    template<typename allocator_t>
+    inline void test_strings(allocator_t& allocator, std::size_t data_size)
+    {
+        using char_allocator   = test_rebind<allocator_t, char>;
+        using string_t         = std::basic_string<char, std::char_traits<char>, char_allocator>;
+        using string_allocator = test_rebind<allocator_t, string_t>;
+
+        std::uint64_t state = 0x2545f4914f6cdd1d;
+
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "parse " << data_size << "B of text into std::basic_string"
+              << std::endl;
+        }
+
+        string_t text{ char_allocator(allocator) };
+        while (text.size() < data_size) {
+            for (int field = 0; field < 6; ++field) {
+                text += "field_value_number_";
+                text += std::to_string(test_random(state) % 1000000);
+                text += (field == 5) ? '\n' : ',';
+            }
+        }
+
+        gaos::memory::log_flush(true);
+
+        std::vector<string_t, string_allocator> records{ string_allocator(allocator) };
+        std::size_t                             longest = 0;
+
+        std::string_view remaining(text);
+        while (!remaining.empty()) {
+            std::size_t      line_end = std::min(remaining.find('\n'), remaining.size());
+            std::string_view line     = remaining.substr(0, line_end);
+            remaining.remove_prefix(std::min(line_end + 1, remaining.size()));
+
+            {
+                [[maybe_unused]] auto scope_pushpop = allocator.get_scoped_pushpop();
+
+                std::vector<string_t, string_allocator> fields{ string_allocator(allocator) };
+                for (std::size_t start = 0; start <= line.size();) {
+                    std::size_t end = std::min(line.find(',', start), line.size());
+                    fields.emplace_back(line.substr(start, end - start), char_allocator(allocator));
+                    start = end + 1;
+                }
+
+                for (string_t const &field : fields)
+                  longest = std::max(longest, field.size());
+            }
+
+            records.emplace_back(line.substr(0, line.find(',')), char_allocator(allocator));
+        }
+
+        gaos::memory::log_flush(true);
+        
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "kept " << records.size() << " records, longest field " << longest
+              << std::endl;
+        }
+    }
+
+
+    // Build a random graph as adjacency vectors, edge by edge, so every
+    // node's vector grows in steps; then walk it breadth first
+    template<typename allocator_t>
+    inline void test_graph(allocator_t& allocator, std::size_t data_size)
+    {
+        using int_allocator   = test_rebind<allocator_t, int>;
+        using edges_t         = std::vector<int, int_allocator>;
+        using edges_allocator = test_rebind<allocator_t, edges_t>;
+
+        std::size_t   node_count = std::max<std::size_t>(data_size / 96, 16);
+        std::uint64_t state      = 0xda942042e4dd58b5;
+
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "graph of " << node_count << " nodes"
+              << std::endl;
+        }
+
+        std::vector<edges_t, edges_allocator> nodes{ edges_allocator(allocator) };
+        for (std::size_t i = 0; i < node_count; ++i)
+          nodes.emplace_back(int_allocator(allocator));
+
+        for (std::size_t i = 0; i < node_count * 4; ++i) {
+            std::size_t from = test_random(state) % node_count;
+            std::size_t to   = test_random(state) % node_count;
+            nodes[from].push_back((int)to);
+            nodes[to].push_back((int)from);
+        }
+
+        gaos::memory::log_flush(true);
+
+        std::vector<int, int_allocator> distance(node_count, -1, int_allocator(allocator));
+        std::deque<int, int_allocator>  frontier{ int_allocator(allocator) };
+
+        distance[0] = 0;
+        frontier.push_back(0);
+        while (!frontier.empty()) {
+            int node = frontier.front();
+            frontier.pop_front();
+
+            for (int next : nodes[node]) {
+                if (distance[next] < 0) {
+                    distance[next] = distance[node] + 1;
+                    frontier.push_back(next);
+                }
+            }
+        }
+
+        gaos::memory::log_flush(true);
+        
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "done"
+              << std::endl;
+        }
+    }
+
+
+    // Allocate blocks of 16B to 16KB with mixed lifetimes -- most live
+    // a few steps, some a thousand, a few until the end -- keeping about
+    // data_size bytes alive; over time this scatters the long-lived
+    // blocks through memory, which is what fragments a heap
+    template<typename allocator_t>
+    inline void test_fragmentation(allocator_t& allocator, std::size_t data_size)
+    {
+        using byte_allocator = test_rebind<allocator_t, std::byte>;
+
+        struct block {
+            std::size_t  expires;
+            std::byte   *ptr;
+            std::size_t  size;
+
+            bool operator<(block const &rh) const noexcept {
+                return expires > rh.expires;
+            }
+        };
+
+        byte_allocator bytes(allocator);
+        std::priority_queue<block> live;
+        std::size_t                live_size  = 0;
+        std::size_t                step_count = std::max<std::size_t>(data_size / 128, 1024);
+        std::uint64_t              state      = 0x8c3f2a91b7d45e07;
+
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "fragment with " << step_count << " blocks"
+              << std::endl;
+        }
+
+        for (std::size_t step = 0; step < step_count; ++step) {
+            while (!live.empty() && (live.top().expires <= step || live_size > data_size)) {
+                block done = live.top();
+                live.pop();
+                live_size -= done.size;
+                bytes.deallocate(done.ptr, done.size);
+            }
+
+            std::uint64_t random   = test_random(state);
+            std::size_t   size     = (std::size_t(16) << (random % 11)) + (random >> 32) % 16;
+            std::size_t   lifetime = (random >> 40) % 100;
+            std::size_t   expires  = (lifetime < 70) ? step + 1 + lifetime % 16
+                                   : (lifetime < 95) ? step + 1000
+                                   : step_count;
+
+            block fresh { expires, bytes.allocate(size), size };
+            std::memset(fresh.ptr, 0, std::min<std::size_t>(size, 64));
+            live.push(fresh);
+            live_size += size;
+        }
+
+        gaos::memory::log_flush(true);
+
+        while (!live.empty()) {
+            bytes.deallocate(live.top().ptr, live.top().size);
+            live.pop();
+        }
+
+        gaos::memory::log_flush(true);
+        
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "done"
+              << std::endl;
+        }
+    }
+
+
+    // Producers allocate messages and hand them to consumers on other
+    // threads, which read and free them -- so most memory is freed on a
+    // different thread than the one which allocated it
+    // The allocator is shared between all threads, so it has to be safe
+    // to use from several at once (see allocators::locked)
+    template<typename allocator_t>
+    inline void test_producer_consumer(allocator_t& allocator, std::size_t data_size, int thread_pairs = 2)
+    {
+        using byte_allocator = test_rebind<allocator_t, std::byte>;
+
+        struct message {
+            std::byte   *ptr;
+            std::size_t  size;
+        };
+
+        std::size_t message_count = std::max<std::size_t>(data_size / 512, 64);
+        std::size_t in_flight_max = 1024;
+
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << thread_pairs << " producers and consumers passing " << message_count << " messages each"
+              << std::endl;
+        }
+
+        std::mutex              mutex;
+        std::condition_variable changed;
+        std::deque<message>     queue;
+        int                     producers_left = thread_pairs;
+
+        auto produce = [&](std::uint64_t state) {
+            byte_allocator bytes(allocator);
+            for (std::size_t i = 0; i < message_count; ++i) {
+                std::size_t size = 64 + test_random(state) % 4032;
+                message     m { bytes.allocate(size), size };
+                std::memset(m.ptr, (int)(i & 0xff), size);
+
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return queue.size() < in_flight_max; });
+                queue.push_back(m);
+                changed.notify_all();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            producers_left -= 1;
+            changed.notify_all();
+        };
+
+        auto consume = [&]() {
+            byte_allocator bytes(allocator);
+            std::size_t    checksum = 0;
+            for (;;) {
+                message m;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&] { return !queue.empty() || producers_left == 0; });
+                    if (queue.empty())
+                      break;
+                    m = queue.front();
+                    queue.pop_front();
+                    changed.notify_all();
+                }
+
+                checksum += (std::size_t)m.ptr[m.size - 1];
+                bytes.deallocate(m.ptr, m.size);
+            }
+            return checksum;
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < thread_pairs; ++i) {
+            threads.emplace_back(produce, 0x9e3779b97f4a7c15 + (std::uint64_t)i);
+            threads.emplace_back(consume);
+        }
+        for (std::thread &thread : threads)
+          thread.join();
+
+        gaos::memory::log_flush(true);
+        
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "done"
+              << std::endl;
+        }
+    }
+
+
+    // A tree of coroutines: every task awaits two children, so
+    // running one creates and destroys 2^(depth+1)-1 frames
+    template<typename frame_t>
+    inline auto test_coroutine_tree(int depth) -> gaos::coroutines::task<std::size_t, frame_t>
+    {
+        if (depth == 0)
+          co_return 1;
+
+        std::size_t left  = co_await test_coroutine_tree<frame_t>(depth - 1);
+        std::size_t right = co_await test_coroutine_tree<frame_t>(depth - 1);
+        co_return left + right + 1;
+    }
+
+
+    // Churn through coroutine frames by running a tree of tasks
+    template<typename frame_t>
+    inline auto test_coroutines(int depth) -> std::size_t
+    {
+        std::size_t frame_count = test_coroutine_tree<frame_t>(depth).run();
+
+        if (gaos::memory::enable_logging) {
+            std::cout
+              << std::endl
+              << "ran " << frame_count << " coroutines"
+              << std::endl;
+        }
+
+        return frame_count;
+    }
+
 }
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "core/memory_heap_map.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+
+// Read a heap map written by the snapshots of allocators (core heap_map
+// writes one) and report where the memory goes: per allocator how much
+// of what it holds is handed out, live or dead, how much is stranded
+// where it cannot be used, and how scattered its free lists are -- per
+// region, and as a histogram of how full its regions are
+
+
+using gaos::memory::heap_allocator;
+using gaos::memory::heap_kind;
+using gaos::memory::heap_region;
+
+
+constexpr std::uint64_t page_size = 4096;
+
+
+auto kind_text(heap_kind kind) -> char const *
+{
+    switch (kind) {
+        case heap_kind::linear_pushpop: return "linear_pushpop";
+        case heap_kind::reuse:          return "reuse";
+        case heap_kind::stack:          return "stack";
+        case heap_kind::per_cpu:        return "per_cpu";
+    }
+    return "unknown";
+}
+
+
+auto percent(std::uint64_t part, std::uint64_t whole) -> std::string
+{
+    if (whole == 0)
+      return "-";
+    return std::to_string((part * 1000 / whole) / 10) + "." + std::to_string((part * 1000 / whole) % 10) + "%";
+}
+
+
+// How full the regions are, in tenths
+void print_utilisation(std::vector<heap_region> const &regions)
+{
+    std::size_t buckets[10] = {};
+    for (heap_region const &r : regions) {
+        std::size_t tenth = r.size == 0 ? 0 : (std::size_t)std::min<std::uint64_t>(r.used * 10 / r.size, 9);
+        ++buckets[tenth];
+    }
+
+    std::size_t widest = *std::max_element(std::begin(buckets), std::end(buckets));
+    std::cout << "  utilisation of " << regions.size() << " regions" << std::endl;
+    for (std::size_t tenth = 0; tenth < 10; ++tenth) {
+        std::size_t bar = widest == 0 ? 0 : (buckets[tenth] * 40 + widest - 1) / widest;
+        std::cout
+          << "    " << std::setw(3) << tenth * 10 << "-" << std::setw(3) << (tenth + 1) * 10 << "% "
+          << std::setw(6) << buckets[tenth] << " " << std::string(bar, '#') << std::endl;
+    }
+}
+
+
+// The regions one by one, the first and last few when there are many
+void print_regions(std::vector<heap_region> const &regions)
+{
+    constexpr std::size_t shown = 8;
+
+    std::cout << "  regions" << std::endl;
+    for (std::size_t i = 0; i < regions.size(); ++i) {
+        if (regions.size() > 2 * shown && i == shown) {
+            std::cout << "    ... " << regions.size() - 2 * shown << " more" << std::endl;
+            i = regions.size() - shown;
+        }
+
+        heap_region const &r = regions[i];
+        std::cout
+          << "    0x" << std::hex << std::setw(12) << std::setfill('0') << r.address << std::dec << std::setfill(' ')
+          << " " << std::setw(10) << r.size << "B"
+          << " | used " << std::setw(10) << r.used << "B"
+          << " | " << std::setw(6) << percent(r.used, r.size) << std::endl;
+    }
+}
+
+
+// The arena kinds: handed out is what their regions gave out, dead what
+// of that came back through a deallocate they cannot act on; free space
+// behind the current region is stranded until a pop, the rest of the
+// current one is headroom, and regions past it are spare
+void analyse_arena(heap_allocator const &a)
+{
+    std::uint64_t capacity = 0, handed_out = 0;
+    for (heap_region const &r : a.regions) {
+        capacity   += r.size;
+        handed_out += r.used;
+    }
+
+    std::uint64_t stranded = 0, headroom = 0, spare = 0;
+    for (std::size_t i = 0; i < a.regions.size(); ++i) {
+        std::uint64_t unused = a.regions[i].size - a.regions[i].used;
+        if (i < a.current)
+          stranded += unused;
+        else if (i == a.current)
+          headroom += unused;
+        else
+          spare += unused;
+    }
+
+    std::uint64_t dead = std::min(a.dead_bytes, handed_out);
+
+    std::cout
+      << "  capacity       " << std::setw(12) << capacity << "B" << std::endl
+      << "  handed out     " << std::setw(12) << handed_out << "B | " << percent(handed_out, capacity) << " of capacity" << std::endl
+      << "  live           " << std::setw(12) << handed_out - dead << "B" << std::endl
+      << "  dead           " << std::setw(12) << dead << "B | internal fragmentation " << percent(dead, handed_out) << std::endl
+      << "  stranded tails " << std::setw(12) << stranded << "B | external fragmentation " << percent(stranded, stranded + headroom + spare) << std::endl
+      << "  headroom       " << std::setw(12) << headroom << "B" << std::endl
+      << "  spare regions  " << std::setw(12) << spare << "B" << std::endl;
+
+    print_regions(a.regions);
+    print_utilisation(a.regions);
+}
+
+
+// The free list kinds: how much is cached, and how well the order it is
+// handed out in follows memory -- adjacent when the next block is at
+// most a block further on (allowing for headers of the memory below),
+// near when it is on the same page -- and how many
+// more pages the free blocks are spread over than they would fill
+void analyse_free_list(heap_allocator const &a)
+{
+    std::uint64_t free_bytes = 0;
+    for (auto const &b : a.free_blocks)
+      free_bytes += b.size;
+
+    std::size_t                adjacent = 0, near = 0;
+    std::vector<std::uint64_t> strides;
+    for (std::size_t i = 1; i < a.free_blocks.size(); ++i) {
+        std::uint64_t from = a.free_blocks[i - 1].address, to = a.free_blocks[i].address;
+        adjacent   += to > from && to - from <= 2 * a.free_blocks[i - 1].size;
+        near       += to / page_size == from / page_size;
+        strides.push_back(to > from ? to - from : from - to);
+    }
+
+    std::set<std::uint64_t> pages;
+    for (auto const &b : a.free_blocks) {
+        for (std::uint64_t page = b.address / page_size; page <= (b.address + b.size - 1) / page_size; ++page)
+          pages.insert(page);
+    }
+    std::uint64_t fewest_pages = (free_bytes + page_size - 1) / page_size;
+
+    std::uint64_t median_stride = 0;
+    if (!strides.empty()) {
+        std::nth_element(strides.begin(), strides.begin() + strides.size() / 2, strides.end());
+        median_stride = strides[strides.size() / 2];
+    }
+
+    std::size_t links = a.free_blocks.empty() ? 0 : a.free_blocks.size() - 1;
+
+    std::cout
+      << "  free blocks    " << std::setw(12) << a.free_blocks.size() << " | " << free_bytes << "B" << std::endl
+      << "  adjacent       " << std::setw(12) << percent(adjacent, links) << " of steps" << std::endl
+      << "  same page      " << std::setw(12) << percent(near, links) << " of steps" << std::endl
+      << "  median stride  " << std::setw(12) << median_stride << "B" << std::endl
+      << "  pages touched  " << std::setw(12) << pages.size() << " | could fit in " << fewest_pages
+        << ", external fragmentation " << percent(pages.size() - std::min<std::uint64_t>(fewest_pages, pages.size()), pages.size()) << std::endl;
+
+    // Batched lists carve their nodes out of chunks, which we know
+    if (!a.regions.empty()) {
+        std::uint64_t carved = 0;
+        for (heap_region const &r : a.regions)
+          carved += r.size;
+
+        std::vector<heap_region> chunks = a.regions;
+        for (heap_region &r : chunks) {
+            std::uint64_t free_in_chunk = 0;
+            for (auto const &b : a.free_blocks) {
+                if (b.address >= r.address && b.address < r.address + r.size)
+                  free_in_chunk += b.size;
+            }
+            r.used = r.size - std::min(free_in_chunk, r.size);
+        }
+
+        std::cout
+          << "  carved         " << std::setw(12) << carved << "B | live " << percent(carved - std::min(free_bytes, carved), carved) << std::endl;
+        print_utilisation(chunks);
+    }
+}
+
+
+void analyse_buffer(heap_allocator const &a)
+{
+    for (heap_region const &r : a.regions) {
+        std::uint64_t dead = std::min(a.dead_bytes, r.used);
+        std::cout
+          << "  capacity       " << std::setw(12) << r.size << "B" << std::endl
+          << "  handed out     " << std::setw(12) << r.used << "B | " << percent(r.used, r.size) << " of capacity" << std::endl
+          << "  dead           " << std::setw(12) << dead << "B | internal fragmentation " << percent(dead, r.used) << std::endl;
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        std::cout << "heap_analyzer <heap map file>" << std::endl;
+        return 1;
+    }
+
+    gaos::memory::heap_map map;
+    if (!map.read(argv[1])) {
+        std::cerr << "could not read heap map " << argv[1] << std::endl;
+        return 1;
+    }
+
+    for (heap_allocator const &a : map.allocators) {
+        std::cout
+          << std::endl
+          << a.name << " (" << kind_text(a.kind);
+        if (a.block_size != 0)
+          std::cout << ", block " << a.block_size << "B";
+        std::cout << ")" << std::endl;
+
+        switch (a.kind) {
+            case heap_kind::linear_pushpop: analyse_arena(a);     break;
+            case heap_kind::reuse:          analyse_free_list(a); break;
+            case heap_kind::per_cpu:        analyse_free_list(a); break;
+            case heap_kind::stack:          analyse_buffer(a);    break;
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file